@@ -99,14 +99,16 @@
 
 // test setup
 uint16_t loopCnt = 0;
-wrkTime_t telemetry_intvl;
-wrkTime_t alert_intvl;
+lqcTimer_t telemetryTimer;                  // periodic work is scheduled with LQCloud, fired from lqc_doWork()
+lqcTimer_t alertTimer;
 
 // LTEm variables
 mqttCtrl_t mqttCtrl;                        // MQTT control, data to manage MQTT connection to server
 uint8_t receiveBuffer[640];                 // Data buffer where received information is returned (can be local, global, or dynamic... your call)
 char mqttTopic[200];                        // application buffer to craft TX MQTT topic
 char mqttMessage[200];                      // application buffer to craft TX MQTT publish content (body)
+char actionQueue[LQC__actionQueue_bufferSz];    // received actions held for lqc_doWork(), actions are performed outside the MQTT receive callback
+char sendQueue[2048];                       // messages sent while (re)connecting wait here, required with the connection manager
 resultCode_t result;
 
 
@@ -142,10 +144,16 @@ const int buttonPin = 9;                    // double duty with battery sense, s
 const int debouncePeriod = 10;
 const int onboardLed = 13;
 
+/* Button presses are captured by interrupt, the ISR only records the event; lqc_doWork() sends the alert. */
+#define EVNT_BUTTON 1
+volatile uint32_t buttonPressCnt;
+volatile uint32_t buttonLastAt;
+
 /* CloudTest EXAMPLE action doLedFlash: has a worker function to do the work without blocking
  * and a counter shared by the "start" function and the "do work" function. */
 wrkTime_t ledFlash_intvl;
 uint8_t flashesRemaining;
+lqcActionHandle_t ledFlash_actn;            // handle to respond to the set-ledflash action when flashing completes
 
 
 /* setup() 
@@ -182,6 +190,11 @@ void setup()
     mqtt_initControl(&mqttCtrl, dataCntxt_0, receiveBuffer, sizeof(receiveBuffer), mqttRecv);
     lqc_create(lqcDeviceType_ctrllr, &lqcDeviceConfig, cloudTrySend, applEvntNotifyCB, applInfoRequestCB, yieldCB, VALIDATION_KEY);
     lqc_enableDiagnostics(lqDiag_getDiagnosticsBlock());
+    lqc_setActionQueue(actionQueue, sizeof(actionQueue));
+    lqc_enableConnectionManager(&mqttCtrl, PDP_DATA_CONTEXT);   // LQCloud connects (and reconnects) MQTT from lqc_doWork()
+    lqc_setSendQueue(sendQueue, sizeof(sendQueue));                 // hold sends until connected
+    lqc_enableSessionResume(true);                                  // reconnects resume MQTT session, C2D queued while offline delivered
+    // lqc_enableHttpFallback(&httpCtrl, 0);                        // optional: D2C by HTTPS when MQTT can't connect (httpCtrl on its own dataCntxt)
 
     /*
      * Create and Initialize Complete.
@@ -208,9 +221,16 @@ void setup()
     lqc_registerApplicationAction("get-status", &LQCACTION_getStatus, getStatus_params);
     lqc_registerApplicationAction("set-ledstate", &LQCACTION_setLedState ,setLedState_params);
     lqc_registerApplicationAction("set-ledflash", &LQCACTION_setLedFlash ,setLedState_params);
+    lqc_setActionBudget("get-status", 100);                     // get-status should be quick, notify (ACTNBUDGET event) if not
+
+    lqc_registerIsrEvent(EVNT_BUTTON, lqcIsrEventType_alert, "cloudTest-user-alert", "pressCnt");
+    pinMode(buttonPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(buttonPin), buttonISR, FALLING);
 
-    telemetry_intvl = wrkTime_create(PERIOD_FROM_SECONDS(60));
-    alert_intvl = wrkTime_create(PERIOD_FROM_MINUTES(5));
+    lqc_timerInit(&telemetryTimer, sendTestTelemetry, NULL);
+    lqc_timerStart(&telemetryTimer, PERIOD_FROM_SECONDS(60), PERIOD_FROM_SECONDS(60));
+    lqc_timerInit(&alertTimer, sendTestAlert, NULL);
+    lqc_timerStart(&alertTimer, PERIOD_FROM_MINUTES(5), PERIOD_FROM_MINUTES(5));
 
     #ifdef WATCHDOG
     /* setup has already registered yield callback with LTEmC to handle longer running network actions 
@@ -223,66 +243,19 @@ void setup()
 /* loop() --------------------------------------------------------------------------------------- */
 void loop() 
 {
-    #define SUMMARY_SZ 80
-    #define BODY_SZ 100
-
-    char summary[SUMMARY_SZ] = {0};
-    char body[BODY_SZ] = {0};
-    lqcSendResult_t sendRslt;
     loopCnt++;
     SHOW_PIXEL(CRGB::Blue);
 
+    /* Periodic telemetry and alert: telemetryTimer/alertTimer fire from lqc_doWork(), see sendTestTelemetry()
+    */ 
 
-    if (wrkTime_doNow(&telemetry_intvl))
-    {
-        snprintf(summary, SUMMARY_SZ, "LQCloud-Test telemetry loop=%d", loopCnt);
-        strcpy(body, "LQCloud-Test telemetry");
-
-        lqcSendResult_t sendRslt = lqc_sendTelemetry("LQC-Test-telemetry", summary, body);
-        if (sendRslt == lqcSendResult_sent)
-        {
-            PRINTF(dbgColor__info, "telemetry sent\r");
-            SHOW_PIXEL(CRGB::Green);
-        }
-        else
-        {
-            PRINTF(dbgColor__warn, "telemetry send failed result=%d\r", sendRslt);
-            SHOW_PIXEL(CRGB::Yellow);
-        }
-    }
-
-    if (wrkTime_doNow(&alert_intvl))
-    {
-        snprintf(summary, SUMMARY_SZ, "LQCloud-Test alert loop=%d", loopCnt);
-        strcpy(body, "LQCloud-Test periodic alert");
-
-        sendRslt = lqc_sendAlert("LQC-PeriodicAlert", summary, body);
-        if (sendRslt == lqcSendResult_sent)
-            PRINTF(dbgColor__info, "periodic alert sent\r");
-        else
-            PRINTF(dbgColor__warn, "periodic alert send failed result=%d\r", sendRslt);
-    }
-
-
-    /* Device Events
+    /* Device Events: button is captured by buttonISR(), alert sent from lqc_doWork()
     */ 
-    pinMode(buttonPin, INPUT);
-    if (digitalRead(buttonPin) == LOW)
-    {
-        PRINTF(dbgColor__cyan, "Button=%d\r", digitalRead(buttonPin));
-        delay(debouncePeriod);
-        int bttn = digitalRead(buttonPin);
-        if (digitalRead(buttonPin) == LOW)
-        {
-            PRINTF(dbgColor__info, "\rUser ReqstAlert Button Pressed\r");
-            lqc_sendAlert("cloudTest-user-alert", "UserAlert", "\"User signaled\"");
-        }
-    }
 
     // Do LQ Cloud and application background tasks
     lqc_doWork();
     applWork_doFlashLed();
-    pDelay(PERIOD_FROM_SECONDS(5));
+    pDelay(MIN(lqc_nextWakeupMs(), PERIOD_FROM_SECONDS(5)));                        // sleep until LQCloud has work, app loop at least every 5 secs
 
     #ifdef WATCHDOG
         // IMPORTANT! pet the dog to keep dog happy and app alive
@@ -358,45 +331,10 @@ bool startNetwork(bool displayStatusOLED)
 
 
     networkFault = !STRCMP(lqcDeviceConfig.packageId, "LQCC");                                      // Check LQCloud settings for expected pkg ID
-    while (!networkFault)
-    {
-        char userId[101];
-        char sasToken[201];
-        lqc_composeIothUserId(userId, sizeof(userId), lqcDeviceConfig.hostUrl, lqcDeviceConfig.deviceId);
-        lqc_composeIothSasToken(sasToken, sizeof(sasToken), lqcDeviceConfig.hostUrl, lqcDeviceConfig.deviceId, lqcDeviceConfig.signature);
-        mqtt_setConnection(&mqttCtrl, lqcDeviceConfig.hostUrl, 8883, true, mqttVersion_311, lqcDeviceConfig.deviceId,  userId, sasToken);
-
-        resultCode_t rslt = mqtt_open(&mqttCtrl);
-        if (rslt != resultCode__success)
-        {
-            networkFault = true;
-            PRINTF(dbgColor__warn, "Open fail status=%d\r", rslt);
-            break;
-        }
-        PRINTF(dbgColor__dCyan, "MQTT Opened\r");
 
-        rslt = mqtt_connect(&mqttCtrl, true);
-        if (rslt != resultCode__success)
-        {
-            networkFault = true;
-            PRINTF(dbgColor__warn, "Connect fail status=%d\r", rslt);
-            break;
-        }
-        PRINTF(dbgColor__dCyan, "MQTT Connected\r");
-
-        char recvTopic[80];
-        snprintf(recvTopic, sizeof(recvTopic), "devices/%s/messages/devicebound/#", mqttCtrl.clientId);
-        // at+qmtsub=0,1,"devices/864508030074113/messages/devicebound/#",1
-        rslt = mqtt_subscribe(&mqttCtrl, recvTopic, mqttQos_1);
-        if (rslt != resultCode__success)
-        {
-            networkFault = true;
-            PRINTF(dbgColor__warn, "Subscribe fail status=%d\r", rslt);
-            break;
-        }
-        PRINTF(dbgColor__dCyan, "MQTT Subscribed\r");
-        break;
-    }
+    /* MQTT open, connect and subscribe are performed by the LQCloud connection manager from lqc_doWork(), 
+     * see lqc_enableConnectionManager() in setup(). Reconnects are also handled there, without blocking loop().
+     */
 
     if (networkFault)
     {
@@ -410,18 +348,8 @@ resultCode_t cloudTrySend(const char *topic, const char* message, uint8_t timeou
 {
     resultCode_t pubResult = mqtt_publish(&mqttCtrl, topic, mqttQos_1, message, timeoutSec);
     if (pubResult != resultCode__success)
-    {
-        PRINTF(dbgColor__warn, "LQC Send Failed, Result=%d (%s)\r", pubResult, atcmd_getValue());
+        PRINTF(dbgColor__warn, "LQC Send Failed, Result=%d (%s)\r", pubResult, atcmd_getValue());  // connection manager reconnects on repeated failures
 
-        if (startNetwork(false))
-        {
-            PRINTF(dbgColor__info, "Successfully Restarted Network.\r");
-            // retry once and return whatever happens
-            pubResult = mqtt_publish(&mqttCtrl, topic, mqttQos_1, message, timeoutSec);
-        }
-        else
-            PRINTF(dbgColor__warn, "Failed to Restart Network.\r");
-    }
     return pubResult;
 }
 
@@ -437,16 +365,8 @@ void mqttRecv(dataCntxt_t dataCntxt, uint16_t msgId, const char *topic, char *to
     PRINTF(dbgColor__cyan, " message: %s\r", message);
 
     // Azure IoTHub appends properties collection to the topic 
-    // That is why Azure requires wildcard topic
-    keyValueDict_t mqttProps = lq_createQryStrDictionary(topicVar, strlen(topicVar));
-    PRINTF(dbgColor__info, "Props(%d)\r", mqttProps.count);
-    for (size_t i = 0; i < mqttProps.count; i++)
-    {
-        PRINTF(dbgColor__cyan, "%s=%s\r", mqttProps.keys[i], mqttProps.values[i]);
-    }
-    PRINTF(0, "\r");
-
-    lqc_receiveMsg(message, messageSz, topic);
+    // That is why Azure requires wildcard topic; props are passed intact (not parsed) to LQCloud
+    lqc_receiveMsg(message, messageSz, topicVar);
 }
 
 
@@ -497,6 +417,49 @@ const char *applInfoRequestCB(const char *infoRqst)
     return infoRequestResponse;
 }
 
+#define SUMMARY_SZ 80
+#define BODY_SZ 100
+
+/* Scheduler timer callbacks, invoked from lqc_doWork() 
+ * --------------------------------------------------------------------------------------------- */
+void sendTestTelemetry(void *userData)
+{
+    char summary[SUMMARY_SZ] = {0};
+    char body[BODY_SZ] = {0};
+
+    snprintf(summary, SUMMARY_SZ, "LQCloud-Test telemetry loop=%d", loopCnt);
+    strcpy(body, "LQCloud-Test telemetry");
+
+    lqcSendResult_t sendRslt = lqc_sendTelemetry("LQC-Test-telemetry", summary, body);
+    if (sendRslt == lqcSendResult_sent)
+    {
+        PRINTF(dbgColor__info, "telemetry sent\r");
+        SHOW_PIXEL(CRGB::Green);
+    }
+    else
+    {
+        PRINTF(dbgColor__warn, "telemetry send failed result=%d\r", sendRslt);
+        SHOW_PIXEL(CRGB::Yellow);
+    }
+}
+
+
+void sendTestAlert(void *userData)
+{
+    char summary[SUMMARY_SZ] = {0};
+    char body[BODY_SZ] = {0};
+
+    snprintf(summary, SUMMARY_SZ, "LQCloud-Test alert loop=%d", loopCnt);
+    strcpy(body, "LQCloud-Test periodic alert");
+
+    lqcSendResult_t sendRslt = lqc_sendAlert("LQC-PeriodicAlert", summary, body);
+    if (sendRslt == lqcSendResult_sent)
+        PRINTF(dbgColor__info, "periodic alert sent\r");
+    else
+        PRINTF(dbgColor__warn, "periodic alert send failed result=%d\r", sendRslt);
+}
+
+
 void yieldCB()
 {
     lqSAMD_wdReset();
@@ -531,6 +494,7 @@ uint16_t getBatteryVoltage()
         vbatAnalog = analogRead(VBAT_PIN);
         // detach pin from analog mux, req'd for shared digital input use
         pinMode(VBAT_PIN, INPUT);
+        attachInterrupt(digitalPinToInterrupt(buttonPin), buttonISR, FALLING);     // pin mux back to interrupt controller
         // vbatAnalog *= (VBAT_DIVIDER * AD_VREF / AD_SCALE);
         vbatAnalog = vbatAnalog * VBAT_DIVIDER * AD_VREF / AD_SCALE;
 
@@ -539,6 +503,20 @@ uint16_t getBatteryVoltage()
 }
 
 
+/**
+ *	\brief Button press interrupt, debounced by time since last press. Records the event only (no blocking calls in ISR).
+ */
+void buttonISR()
+{
+    uint32_t now = millis();
+
+    if (now - buttonLastAt < debouncePeriod)
+        return;
+    buttonLastAt = now;
+    lqc_isrRecordEvent(EVNT_BUTTON, ++buttonPressCnt, 0, 0);
+}
+
+
 /* Check free memory SAMD tested (stack-to-heap) 
  * ---------------------------------------------------------------------------------
 */
@@ -651,6 +629,7 @@ static void LQCACTION_setLedFlash(keyValueDict_t params)
     {
         ledFlash_intvl = wrkTime_create(cycleMillis);
         flashesRemaining = flashes;                     // this will count down, 0 = complete
+        ledFlash_actn = lqc_deferActionResponse(10);    // respond when flashing completes (or LQCloud responds with timeout at 10 secs)
     }
 
     PRINTF(dbgColor__cyan, "doLampFlash: flashes=%i, cycleMs=%i\r", flashes, cycleMillis);
@@ -683,7 +662,7 @@ void applWork_doFlashLed()
         if (flashesRemaining == 0)
         {
             PRINTF(dbgColor__cyan, "doLampFlash Completed\r");
-            lqc_sendActionResponse(resultCode__success, "");   // flash action completed sucessfully
+            lqc_completeAction(ledFlash_actn, resultCode__success, "");    // flash action completed sucessfully
         }
     }
 }
@@ -0,0 +1,245 @@
+/******************************************************************************
+ *  \file cnfgStoreStartup.c
+ *  \brief Linux host timing of device startup through first publish, settings from the config store file backend.
+ *
+ *  Each run is the startup path of a device: open the config store (select the newest valid slot, CRC and index it),
+ *  read the device config from it, create and start LQCloud and time until the boot message reaches the send callback
+ *  (first publish, the application manages the connection so the send is not held for a connect). The same path is
+ *  timed with the settings read as the legacy raw lqcDeviceConfig_t record, validated by magicFlag/packageId compare.
+ *
+ *  The store is written once before the runs (A/B slots <basePath>.a/.b, legacy record <basePath>.raw), slot reads
+ *  are from the page cache: the times are the library's cost, not the storage device's.
+ *
+ *  Build (from this directory, LTEmC and LooUQ common sources on the include path as for any Linux build):
+ *      gcc -O2 -std=gnu99 -I../../src -I<ltemc>/src cnfgStoreStartup.c ../../src/lq*.c <ltemc sources> -lpthread -o cnfgStoreStartup
+ *  Run:
+ *      ./cnfgStoreStartup [basePath=/tmp/lqcCnfgStore] [runs=1000]
+ *
+ *  Prints median and 99th percentile microseconds for each phase, exit code 0 if every run published the stored identity.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lqc-internal.h"
+#include "lqc-cnfgstore.h"
+
+#define RUNS_MAX 100000
+
+enum startupPhase
+{
+    phase_open = 0,                                             /// store opened, or raw record read and validated
+    phase_config,                                               /// device config filled from store
+    phase_publish,                                              /// create, start through first send callback
+    phase_total,
+    phase_cnt
+};
+
+static const char *S__phaseNames[phase_cnt] = { "open", "readConfig", "toPublish", "total" };
+static lqcDeviceConfig_t S__storedCnfg =
+{
+    .magicFlag = "LQCC", .packageId = "0001", .deviceLabel = "startup", .deviceId = "cnfgStoreStartup-0001",
+    .hostUrl = "iothub-dev-pelogical.azure-devices.net", .hostPort = 8883,
+    .signature = "SharedAccessSignature sr=hub%2Fdevices%2Fdvc0001&sig=00000000%3D&se=1999999999"
+};
+static lqcDeviceConfig_t S__deviceCnfg;                         // as read at startup, LQCloud holds a pointer
+static struct timespec S__publishedAt;
+static uint32_t S__publishCnt;
+static uint32_t S__errorCnt;
+static uint32_t *S__samples[phase_cnt];
+
+static bool S__writeStore(const lqcCnfgStoreBackend_t *backend, const char *rawPath);
+static bool S__startupFromStore(const lqcCnfgStoreBackend_t *backend, uint32_t run);
+static bool S__startupFromRaw(const char *rawPath, uint32_t run);
+static bool S__startThroughPublish();
+static void S__report(const char *source, uint32_t runs);
+static int S__compareU32(const void *a, const void *b);
+static resultCode_t S__recordPublish(const char *topic, const char *message, uint8_t timeoutSec);
+static void S__appEvent(const char *eventTag, const char *eventMsg);
+static uint32_t S__elapsedMicros(struct timespec *start, struct timespec *end);
+
+
+int main(int argc, char *argv[])
+{
+    const char *basePath = (argc > 1) ? argv[1] : "/tmp/lqcCnfgStore";
+    uint32_t runs = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000;
+    lqcCnfgStoreBackend_t backend;
+    lqcCnfgStoreFile_t fileCntxt;
+    char rawPath[80];
+
+    if (runs == 0 || runs > RUNS_MAX)
+    {
+        fprintf(stderr, "runs must be 1..%d\n", RUNS_MAX);
+        return 2;
+    }
+    for (uint8_t p = 0; p < phase_cnt; p++)
+        S__samples[p] = calloc(runs, sizeof(uint32_t));
+
+    lqcCnfgStore_fileBackend(&backend, &fileCntxt, basePath);
+    snprintf(rawPath, sizeof(rawPath), "%s.raw", basePath);
+    if (!S__writeStore(&backend, rawPath))
+    {
+        fprintf(stderr, "unable to write store at %s\n", basePath);
+        return 2;
+    }
+
+    printf("runs=%lu store=%s.a/.b\n", (unsigned long)runs, basePath);
+    printf("source       phase        median(us)  p99(us)\n");
+
+    for (uint32_t run = 0; run < runs; run++)
+    {
+        if (!S__startupFromStore(&backend, run))
+            S__errorCnt++;
+    }
+    S__report("cnfgStore", runs);
+
+    for (uint32_t run = 0; run < runs; run++)
+    {
+        if (!S__startupFromRaw(rawPath, run))
+            S__errorCnt++;
+    }
+    S__report("raw struct", runs);
+
+    if (S__errorCnt > 0)
+        printf("FAILED: %lu runs did not publish the stored identity\n", (unsigned long)S__errorCnt);
+    return (S__errorCnt == 0) ? 0 : 1;
+}
+
+
+/**
+ *	\brief Store the device config and application tuning tags (two updates: both slots valid), and the legacy raw record.
+ */
+static bool S__writeStore(const lqcCnfgStoreBackend_t *backend, const char *rawPath)
+{
+    lqcCnfgStore_t store;
+    uint8_t sendInterval[2] = { 60, 0 };
+    uint8_t batchCnt = 8;
+    lqcCnfgStoreItem_t tuning[] =
+    {
+        { lqcCnfgTag_appBase + 0, sizeof(sendInterval), sendInterval },
+        { lqcCnfgTag_appBase + 1, sizeof(batchCnt), &batchCnt }
+    };
+
+    lqcCnfgStore_open(&store, backend);
+    if (!lqcCnfgStore_writeDeviceConfig(&store, &S__storedCnfg) || !lqcCnfgStore_update(&store, tuning, sizeof(tuning) / sizeof(tuning[0])))
+        return false;
+
+    FILE *rawFile = fopen(rawPath, "wb");
+    if (rawFile == NULL)
+        return false;
+    bool written = fwrite(&S__storedCnfg, sizeof(lqcDeviceConfig_t), 1, rawFile) == 1;
+    return fclose(rawFile) == 0 && written;
+}
+
+
+/**
+ *	\brief Startup with settings from the config store: open, read device config, create/start through first publish.
+ */
+static bool S__startupFromStore(const lqcCnfgStoreBackend_t *backend, uint32_t run)
+{
+    lqcCnfgStore_t store;
+    struct timespec start, opened, configured;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!lqcCnfgStore_open(&store, backend))
+        return false;
+    clock_gettime(CLOCK_MONOTONIC, &opened);
+    memset(&S__deviceCnfg, 0, sizeof(lqcDeviceConfig_t));
+    if (!lqcCnfgStore_readDeviceConfig(&store, &S__deviceCnfg))
+        return false;
+    clock_gettime(CLOCK_MONOTONIC, &configured);
+
+    if (!S__startThroughPublish())
+        return false;
+    S__samples[phase_open][run] = S__elapsedMicros(&start, &opened);
+    S__samples[phase_config][run] = S__elapsedMicros(&opened, &configured);
+    S__samples[phase_publish][run] = S__elapsedMicros(&configured, &S__publishedAt);
+    S__samples[phase_total][run] = S__elapsedMicros(&start, &S__publishedAt);
+    return true;
+}
+
+
+/**
+ *	\brief Startup with the legacy raw struct record: read whole record, validate by string compare.
+ */
+static bool S__startupFromRaw(const char *rawPath, uint32_t run)
+{
+    struct timespec start, opened;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    FILE *rawFile = fopen(rawPath, "rb");
+    if (rawFile == NULL)
+        return false;
+    bool readOk = fread(&S__deviceCnfg, sizeof(lqcDeviceConfig_t), 1, rawFile) == 1;
+    fclose(rawFile);
+    if (!readOk || strcmp(S__deviceCnfg.magicFlag, S__storedCnfg.magicFlag) != 0 || strcmp(S__deviceCnfg.packageId, S__storedCnfg.packageId) != 0)
+        return false;
+    clock_gettime(CLOCK_MONOTONIC, &opened);
+
+    if (!S__startThroughPublish())
+        return false;
+    S__samples[phase_open][run] = S__elapsedMicros(&start, &opened);
+    S__samples[phase_config][run] = 0;                                          // struct is the config
+    S__samples[phase_publish][run] = S__elapsedMicros(&opened, &S__publishedAt);
+    S__samples[phase_total][run] = S__elapsedMicros(&start, &S__publishedAt);
+    return true;
+}
+
+
+/**
+ *	\brief Create and start LQCloud with S__deviceCnfg, the boot message is the first publish.
+ *  \return True if published, with the device ID read at startup in its topic.
+ */
+static bool S__startThroughPublish()
+{
+    uint32_t publishCnt = S__publishCnt;
+
+    lqc_create(lqcDeviceType_ctrllr, &S__deviceCnfg, S__recordPublish, S__appEvent, NULL, NULL, "000000000000");
+    lqc_start(0);
+    for (uint8_t pass = 0; pass < 10 && S__publishCnt == publishCnt; pass++)
+        lqc_doWork();
+    return S__publishCnt == publishCnt + 1;
+}
+
+
+static void S__report(const char *source, uint32_t runs)
+{
+    for (uint8_t p = 0; p < phase_cnt; p++)
+    {
+        qsort(S__samples[p], runs, sizeof(uint32_t), S__compareU32);
+        printf("%-11s  %-11s  %10lu  %7lu\n", source, S__phaseNames[p], (unsigned long)S__samples[p][runs / 2], (unsigned long)S__samples[p][runs * 99 / 100]);
+    }
+}
+
+
+static int S__compareU32(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return (left > right) - (left < right);
+}
+
+
+/**
+ *	\brief Send callback: timestamp the first publish, check it carries the device ID read at startup.
+ */
+static resultCode_t S__recordPublish(const char *topic, const char *message, uint8_t timeoutSec)
+{
+    clock_gettime(CLOCK_MONOTONIC, &S__publishedAt);
+    if (strstr(topic, S__storedCnfg.deviceId) != NULL)
+        S__publishCnt++;
+    return resultCode__success;
+}
+
+
+static void S__appEvent(const char *eventTag, const char *eventMsg)
+{
+}
+
+
+static uint32_t S__elapsedMicros(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+}
@@ -0,0 +1,533 @@
+/******************************************************************************
+ *  \file coapStandIn.c
+ *  \brief Linux host stand-in for the LQCloud CoAP endpoint, exercises the lqc-coap transport (RFC 7252 subset).
+ *
+ *  The stand-in accepts POST /<deviceId>/e?<properties> with JSON content, confirmable or non-confirmable. Confirmable
+ *  requests get a piggybacked ACK; Block1 (RFC 7959) requests are reassembled, each block answered 2.31 Continue and the
+ *  final block 2.04 Changed. A retransmitted request (same message ID) is answered from the response cache without being
+ *  processed again, as a server must for confirmable deduplication. Requests and/or responses can be dropped to force
+ *  the client's retransmit path.
+ *
+ *  serve:    stand-in on a UDP port for a device (or any CoAP client), each request and reassembled body is printed.
+ *  selftest: stand-in on a loopback port and the library's CoAP transport as client, runs the exchanges below and
+ *            verifies the result code, the body the stand-in received and its retransmit/duplicate counts:
+ *              CON single datagram, NON single datagram, CON Block1, CON with the request lost (retransmit),
+ *              CON Block1 with a block's ACK lost (retransmit answered from the response cache).
+ *
+ *  Build (from this directory, LTEmC and LooUQ common sources on the include path as for any Linux build):
+ *      gcc -O2 -std=gnu99 -I../../src -I<ltemc>/src coapStandIn.c ../../src/lq*.c <ltemc sources> -lpthread -o coapStandIn
+ *  Run:
+ *      ./coapStandIn serve [port=5683] [dropRqstEvery=0] [dropRspEvery=0]
+ *      ./coapStandIn selftest
+ *
+ *  Selftest prints one line per exchange, exit code 0 if all verify. Drops force ACK timeouts, selftest takes ~5 seconds.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "lqc-internal.h"
+
+#define STANDIN_BODY_MAXSZ 4096
+#define STANDIN_RSPCACHE_CNT 16
+#define STANDIN_DGRAM_MAXSZ 1500
+
+enum coap_constants                                             // as lqc-coap.c
+{
+    coap__version = 1,
+
+    coapType_con = 0,
+    coapType_non = 1,
+    coapType_ack = 2,
+
+    coapCode_post = 0x02,
+
+    coapOption_uriPath = 11,
+    coapOption_uriQuery = 15,
+    coapOption_block1 = 27
+};
+
+typedef struct coapRqst_tag
+{
+    uint8_t type;
+    uint8_t code;
+    uint16_t msgId;
+    uint8_t token[8];
+    uint8_t tokenSz;
+    char uri[256];                                              /// /path/path?query&query
+    bool hasBlock1;
+    uint32_t block1Num;
+    bool block1More;
+    uint8_t block1Szx;
+    const uint8_t *payload;
+    uint16_t payloadSz;
+} coapRqst_t;
+
+typedef struct rspCacheEntry_tag
+{
+    bool inUse;
+    uint16_t msgId;
+    uint8_t rsp[32];
+    uint16_t rspSz;                                             /// 0: non-confirmable, nothing to resend
+} rspCacheEntry_t;
+
+static int S__socket = -1;                                      // stand-in (server)
+static int S__clientSocket = -1;                                // selftest: library transport, connected to stand-in
+static volatile bool S__stop;
+static uint32_t S__dropRqstEvery;                               // serve: drop every Nth request received
+static uint32_t S__dropRspEvery;                                // serve: drop every Nth response
+static uint32_t S__dropRqstNext;                                // selftest: drop next N requests
+static uint32_t S__dropRspNext;                                 // selftest: drop next N responses
+static uint32_t S__rqstCnt;
+static uint32_t S__rspCnt;
+static uint32_t S__dupCnt;                                      // retransmits answered from cache
+static uint32_t S__bodyCnt;                                     // complete bodies received
+static rspCacheEntry_t S__rspCache[STANDIN_RSPCACHE_CNT];
+static uint8_t S__rspCacheNext;
+static uint8_t S__body[STANDIN_BODY_MAXSZ + 1];                 // reassembled (or single datagram) body, last completed
+static uint32_t S__bodySz;
+static uint32_t S__block1Next;                                  // next Block1 number expected
+static bool S__verbose;
+
+static int S__serve(uint16_t port);
+static int S__selftest();
+static int S__openSocket(uint16_t port);
+static void *S__serverThread(void *arg);
+static void S__serveDatagram(const uint8_t *dgram, uint16_t dgramSz, struct sockaddr_in *from);
+static bool S__parseRequest(const uint8_t *dgram, uint16_t dgramSz, coapRqst_t *rqst);
+static uint8_t S__processRequest(coapRqst_t *rqst);
+static uint16_t S__composeResponse(uint8_t *rsp, coapRqst_t *rqst, uint8_t code);
+static rspCacheEntry_t *S__findCached(uint16_t msgId);
+static bool S__checkExchange(const char *name, const char *body, bool confirmable, uint32_t expectedRetransmits, uint32_t expectedDups);
+static resultCode_t S__clientSend(const uint8_t *datagram, uint16_t datagramSz);
+static void S__clientYield();
+static void S__clientEvent(const char *eventTag, const char *eventMsg);
+
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "serve") == 0)
+    {
+        S__dropRqstEvery = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+        S__dropRspEvery = (argc > 4) ? strtoul(argv[4], NULL, 10) : 0;
+        S__verbose = true;
+        setvbuf(stdout, NULL, _IOLBF, 0);                                       // log as received, when piped
+        return S__serve((argc > 2) ? atoi(argv[2]) : 5683);
+    }
+    if (argc > 1 && strcmp(argv[1], "selftest") == 0)
+        return S__selftest();
+
+    fprintf(stderr, "usage: coapStandIn serve [port=5683] [dropRqstEvery=0] [dropRspEvery=0]\n       coapStandIn selftest\n");
+    return 2;
+}
+
+
+/**
+ *	\brief Serve requests on the port until interrupted.
+ */
+static int S__serve(uint16_t port)
+{
+    if ((S__socket = S__openSocket(port)) < 0)
+        return 2;
+    printf("CoAP stand-in on udp/%d, dropRqstEvery=%lu dropRspEvery=%lu\n", port, (unsigned long)S__dropRqstEvery, (unsigned long)S__dropRspEvery);
+    S__serverThread(NULL);
+    return 0;
+}
+
+
+/**
+ *	\brief Stand-in on a loopback port, the library CoAP transport sends to it over a connected client socket.
+ */
+static int S__selftest()
+{
+    static lqcDeviceConfig_t deviceCnfg = { .deviceId = "coapStandIn" };
+    struct sockaddr_in serverAddr;
+    socklen_t addrLen = sizeof(serverAddr);
+    pthread_t server;
+    char blockBody[1000];
+
+    if ((S__socket = S__openSocket(0)) < 0)
+        return 2;
+    getsockname(S__socket, (struct sockaddr *)&serverAddr, &addrLen);
+    serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    S__clientSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (S__clientSocket < 0 || connect(S__clientSocket, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0)
+    {
+        perror("client socket");
+        return 2;
+    }
+    pthread_create(&server, NULL, S__serverThread, NULL);
+
+    lqc_create(lqcDeviceType_sensor, &deviceCnfg, lqcCoap_sendMessage, S__clientEvent, NULL, S__clientYield, "000000000000");
+    for (uint16_t i = 0; i < sizeof(blockBody) - 1; i++)
+        blockBody[i] = 'a' + i % 26;
+    memcpy(blockBody, "{\"v\":\"", 6);
+    memcpy(blockBody + sizeof(blockBody) - 3, "\"}", 2);
+    blockBody[sizeof(blockBody) - 1] = '\0';
+
+    printf("exchange                      result  bodySz  retransmits  dups  verify\n");
+    bool allPassed = true;
+
+    lqcCoap_initTransport(S__clientSend, true);
+    allPassed &= S__checkExchange("CON", "{\"temp\":21.5}", true, 0, 0);
+
+    lqcCoap_initTransport(S__clientSend, false);
+    allPassed &= S__checkExchange("NON", "{\"temp\":21.6}", false, 0, 0);
+
+    lqcCoap_initTransport(S__clientSend, true);
+    allPassed &= S__checkExchange("CON Block1", blockBody, true, 0, 0);
+
+    __atomic_store_n(&S__dropRqstNext, 1, __ATOMIC_RELEASE);                    // request lost: client retransmits after ACK timeout
+    allPassed &= S__checkExchange("CON request lost", "{\"temp\":21.7}", true, 1, 0);
+
+    __atomic_store_n(&S__dropRspNext, 1, __ATOMIC_RELEASE);                     // first block's ACK lost: retransmit, answered from cache
+    allPassed &= S__checkExchange("CON Block1 ACK lost", blockBody, true, 1, 1);
+
+    S__stop = true;
+    pthread_join(server, NULL);
+    close(S__clientSocket);
+    close(S__socket);
+    return allPassed ? 0 : 1;
+}
+
+
+static int S__openSocket(uint16_t port)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    struct timeval rcvTimeout = { .tv_sec = 0, .tv_usec = 100000 };             // server thread checks S__stop
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("stand-in socket");
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &rcvTimeout, sizeof(rcvTimeout));
+    return sock;
+}
+
+
+/**
+ *	\brief Receive and answer datagrams until S__stop.
+ */
+static void *S__serverThread(void *arg)
+{
+    (void)arg;
+    uint8_t dgram[STANDIN_DGRAM_MAXSZ];
+    struct sockaddr_in from;
+
+    while (!S__stop)
+    {
+        socklen_t fromLen = sizeof(from);
+        ssize_t dgramSz = recvfrom(S__socket, dgram, sizeof(dgram), 0, (struct sockaddr *)&from, &fromLen);
+        if (dgramSz > 0)
+            S__serveDatagram(dgram, dgramSz, &from);
+    }
+    return NULL;
+}
+
+
+/**
+ *	\brief Parse, dedupe, process and answer one request datagram; request/response drops applied here.
+ */
+static void S__serveDatagram(const uint8_t *dgram, uint16_t dgramSz, struct sockaddr_in *from)
+{
+    coapRqst_t rqst;
+    uint8_t rsp[32];
+    uint16_t rspSz = 0;
+
+    S__rqstCnt++;
+    if (__atomic_load_n(&S__dropRqstNext, __ATOMIC_ACQUIRE) > 0 || (S__dropRqstEvery > 0 && S__rqstCnt % S__dropRqstEvery == 0))
+    {
+        if (S__dropRqstNext > 0)
+            S__dropRqstNext--;
+        if (S__verbose)
+            printf("  dropped request #%lu\n", (unsigned long)S__rqstCnt);
+        return;
+    }
+    if (!S__parseRequest(dgram, dgramSz, &rqst))
+    {
+        printf("  malformed datagram, %d bytes\n", dgramSz);
+        return;
+    }
+
+    rspCacheEntry_t *cached = S__findCached(rqst.msgId);
+    if (cached != NULL)                                                         // retransmit: same response, not processed again
+    {
+        S__dupCnt++;
+        if (S__verbose)
+            printf("  duplicate mId=%d\n", rqst.msgId);
+        memcpy(rsp, cached->rsp, cached->rspSz);
+        rspSz = cached->rspSz;
+    }
+    else
+    {
+        uint8_t code = S__processRequest(&rqst);
+        if (rqst.type == coapType_con)
+            rspSz = S__composeResponse(rsp, &rqst, code);
+
+        cached = &S__rspCache[S__rspCacheNext];
+        S__rspCacheNext = (S__rspCacheNext + 1) % STANDIN_RSPCACHE_CNT;
+        *cached = (rspCacheEntry_t){ .inUse = true, .msgId = rqst.msgId, .rspSz = rspSz };
+        memcpy(cached->rsp, rsp, rspSz);
+    }
+
+    if (rspSz == 0)
+        return;
+    S__rspCnt++;
+    if (__atomic_load_n(&S__dropRspNext, __ATOMIC_ACQUIRE) > 0 || (S__dropRspEvery > 0 && S__rspCnt % S__dropRspEvery == 0))
+    {
+        if (S__dropRspNext > 0)
+            S__dropRspNext--;
+        if (S__verbose)
+            printf("  dropped response #%lu\n", (unsigned long)S__rspCnt);
+        return;
+    }
+    sendto(S__socket, rsp, rspSz, 0, (struct sockaddr *)from, sizeof(*from));
+}
+
+
+/**
+ *	\brief Parse header, token, options (Uri-Path, Uri-Query, Block1) and payload.
+ */
+static bool S__parseRequest(const uint8_t *dgram, uint16_t dgramSz, coapRqst_t *rqst)
+{
+    uint16_t pos = 4;
+    uint16_t option = 0;
+    uint16_t uriLen = 0;
+    bool queryStarted = false;
+
+    memset(rqst, 0, sizeof(coapRqst_t));
+    if (dgramSz < 4 || (dgram[0] >> 6) != coap__version)
+        return false;
+    rqst->type = (dgram[0] >> 4) & 0x03;
+    rqst->tokenSz = dgram[0] & 0x0F;
+    rqst->code = dgram[1];
+    rqst->msgId = (dgram[2] << 8) | dgram[3];
+    if (rqst->tokenSz > 8 || dgramSz < pos + rqst->tokenSz)
+        return false;
+    memcpy(rqst->token, dgram + pos, rqst->tokenSz);
+    pos += rqst->tokenSz;
+
+    while (pos < dgramSz && dgram[pos] != 0xFF)
+    {
+        uint16_t delta = dgram[pos] >> 4;
+        uint16_t len = dgram[pos] & 0x0F;
+        pos++;
+        if (delta == 15 || len == 15)
+            return false;
+        if (delta == 13)
+            delta = 13 + dgram[pos++];
+        else if (delta == 14)
+        {
+            delta = 269 + (dgram[pos] << 8 | dgram[pos + 1]);
+            pos += 2;
+        }
+        if (len == 13)
+            len = 13 + dgram[pos++];
+        else if (len == 14)
+        {
+            len = 269 + (dgram[pos] << 8 | dgram[pos + 1]);
+            pos += 2;
+        }
+        if (pos + len > dgramSz)
+            return false;
+
+        option += delta;
+        const uint8_t *value = dgram + pos;
+        pos += len;
+
+        if ((option == coapOption_uriPath || option == coapOption_uriQuery) && uriLen + len + 2u < sizeof(rqst->uri))
+        {
+            char separator = (option == coapOption_uriPath) ? '/' : (queryStarted ? '&' : '?');
+            queryStarted = queryStarted || option == coapOption_uriQuery;
+            rqst->uri[uriLen++] = separator;
+            memcpy(rqst->uri + uriLen, value, len);
+            uriLen += len;
+        }
+        else if (option == coapOption_block1)
+        {
+            uint32_t block1 = 0;
+            for (uint16_t i = 0; i < len; i++)
+                block1 = block1 << 8 | value[i];
+            rqst->hasBlock1 = true;
+            rqst->block1Num = block1 >> 4;
+            rqst->block1More = (block1 >> 3) & 0x01;
+            rqst->block1Szx = block1 & 0x07;
+        }
+    }
+    rqst->uri[uriLen] = '\0';
+
+    if (pos < dgramSz)                                                          // payload marker
+    {
+        rqst->payload = dgram + pos + 1;
+        rqst->payloadSz = dgramSz - pos - 1;
+    }
+    return true;
+}
+
+
+/**
+ *	\brief Accept a request or Block1 block into the body buffer.
+ *  \return CoAP response code.
+ */
+static uint8_t S__processRequest(coapRqst_t *rqst)
+{
+    static const uint8_t changed = 2 << 5 | 4;                                  // 2.04
+    static const uint8_t cont = 2 << 5 | 31;                                    // 2.31
+    static const uint8_t incomplete = 4 << 5 | 8;                               // 4.08
+    static const uint8_t tooLarge = 4 << 5 | 13;                                // 4.13
+    static const uint8_t notAllowed = 4 << 5 | 5;                               // 4.05
+
+    if (rqst->code != coapCode_post)
+        return notAllowed;
+
+    if (!rqst->hasBlock1)
+    {
+        if (rqst->payloadSz > STANDIN_BODY_MAXSZ)
+            return tooLarge;
+        memcpy(S__body, rqst->payload, rqst->payloadSz);
+        S__bodySz = rqst->payloadSz;
+        S__body[S__bodySz] = '\0';
+        S__bodyCnt++;
+        if (S__verbose)
+            printf("POST %s %s, %lu bytes\n  %s\n", rqst->uri, rqst->type == coapType_con ? "CON" : "NON", (unsigned long)S__bodySz, S__body);
+        return changed;
+    }
+
+    uint32_t blockSz = 16 << rqst->block1Szx;
+    uint32_t offset = rqst->block1Num * blockSz;
+    if (rqst->block1Num == 0)
+        S__block1Next = 0;
+    if (rqst->block1Num != S__block1Next)
+    {
+        printf("  Block1 %lu out of order, expected %lu\n", (unsigned long)rqst->block1Num, (unsigned long)S__block1Next);
+        return incomplete;
+    }
+    if (offset + rqst->payloadSz > STANDIN_BODY_MAXSZ)
+        return tooLarge;
+
+    memcpy(S__body + offset, rqst->payload, rqst->payloadSz);
+    S__block1Next++;
+    if (S__verbose)
+        printf("  Block1 %lu%s, %d bytes\n", (unsigned long)rqst->block1Num, rqst->block1More ? "+" : "", rqst->payloadSz);
+    if (rqst->block1More)
+        return cont;
+
+    S__bodySz = offset + rqst->payloadSz;
+    S__body[S__bodySz] = '\0';
+    S__bodyCnt++;
+    if (S__verbose)
+        printf("POST %s Block1, %lu bytes\n  %s\n", rqst->uri, (unsigned long)S__bodySz, S__body);
+    return changed;
+}
+
+
+/**
+ *	\brief Piggybacked ACK: request's message ID and token, Block1 echoed for a block-wise request.
+ *  \return Response size.
+ */
+static uint16_t S__composeResponse(uint8_t *rsp, coapRqst_t *rqst, uint8_t code)
+{
+    uint16_t len = 0;
+
+    rsp[len++] = (coap__version << 6) | (coapType_ack << 4) | rqst->tokenSz;
+    rsp[len++] = code;
+    rsp[len++] = rqst->msgId >> 8;
+    rsp[len++] = rqst->msgId & 0xFF;
+    memcpy(rsp + len, rqst->token, rqst->tokenSz);
+    len += rqst->tokenSz;
+
+    if (rqst->hasBlock1 && code >> 5 == 2)
+    {
+        uint32_t block1 = rqst->block1Num << 4 | (rqst->block1More ? 0x08 : 0) | rqst->block1Szx;
+        uint8_t value[3];
+        uint8_t valueLen = (block1 > 0xFFFF) ? 3 : (block1 > 0xFF) ? 2 : (block1 > 0) ? 1 : 0;
+
+        for (uint8_t i = 0; i < valueLen; i++)
+            value[i] = block1 >> (8 * (valueLen - 1 - i));
+        rsp[len++] = (13 << 4) | valueLen;                                      // option delta 27: 13 + ext 14
+        rsp[len++] = coapOption_block1 - 13;
+        memcpy(rsp + len, value, valueLen);
+        len += valueLen;
+    }
+    return len;
+}
+
+
+static rspCacheEntry_t *S__findCached(uint16_t msgId)
+{
+    for (uint8_t i = 0; i < STANDIN_RSPCACHE_CNT; i++)
+    {
+        if (S__rspCache[i].inUse && S__rspCache[i].msgId == msgId)
+            return &S__rspCache[i];
+    }
+    return NULL;
+}
+
+
+/**
+ *	\brief Send body through the library transport, verify result, the body the stand-in holds and retransmit counts.
+ */
+static bool S__checkExchange(const char *name, const char *body, bool confirmable, uint32_t expectedRetransmits, uint32_t expectedDups)
+{
+    char topic[] = "devices/coapStandIn/messages/events/mId=~1&mV=1.0&evT=tele&evN=standIn";
+    uint32_t bodyCnt = S__bodyCnt;
+    uint32_t dupCnt = S__dupCnt;
+    uint32_t rqstCnt = S__rqstCnt;
+
+    resultCode_t rslt = lqcCoap_sendMessage(topic, body, 30);
+    if (!confirmable)                                                           // nothing to await, let the stand-in take it
+    {
+        for (uint8_t i = 0; i < 50 && __atomic_load_n(&S__bodyCnt, __ATOMIC_ACQUIRE) == bodyCnt; i++)
+            usleep(10000);
+    }
+
+    uint32_t blockCnt = (strlen(body) + LQC__coap_blockSz - 1) / LQC__coap_blockSz;
+    uint32_t retransmits = (S__rqstCnt - rqstCnt) - blockCnt;                  // datagrams received beyond one per block
+    uint32_t dups = S__dupCnt - dupCnt;
+    bool passed = rslt == resultCode__success && S__bodyCnt == bodyCnt + 1 && strcmp((char *)S__body, body) == 0 &&
+                  retransmits == expectedRetransmits && dups == expectedDups;
+
+    printf("%-28s  %6d  %6lu  %11lu  %4lu  %s\n", name, rslt, (unsigned long)S__bodySz, (unsigned long)retransmits, (unsigned long)dups, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+
+/**
+ *	\brief CoAP transport datagram send, to the client socket connected to the stand-in.
+ */
+static resultCode_t S__clientSend(const uint8_t *datagram, uint16_t datagramSz)
+{
+    return (send(S__clientSocket, datagram, datagramSz, 0) == datagramSz) ? resultCode__success : resultCode__unavailable;
+}
+
+
+/**
+ *	\brief LQCloud yield: application services UDP receive, datagrams from the stand-in go to lqcCoap_receive().
+ */
+static void S__clientYield()
+{
+    struct pollfd pollFd = { .fd = S__clientSocket, .events = POLLIN };
+    uint8_t dgram[STANDIN_DGRAM_MAXSZ];
+
+    if (poll(&pollFd, 1, 10) > 0)
+    {
+        ssize_t dgramSz = recv(S__clientSocket, dgram, sizeof(dgram), 0);
+        if (dgramSz > 0)
+            lqcCoap_receive(dgram, dgramSz);
+    }
+}
+
+
+static void S__clientEvent(const char *eventTag, const char *eventMsg)
+{
+    printf("  event %s: %s\n", eventTag, eventMsg);
+}
@@ -0,0 +1,143 @@
+/******************************************************************************
+ *  \file crcBench.c
+ *  \brief Linux host throughput benchmark for the lqc-crc implementations: nibble, table256 and slice8.
+ *
+ *  The implementation is selected when lqc-crc.c is compiled, build once per variant with the same LQC_CRC_* define
+ *  for both files. Each build first verifies the CRC-32 check value and that a split update equals a single update,
+ *  then times lqcCrc_update() over buffers of transfer fragment to firmware image sizes.
+ *
+ *  Bytes/cycle is from the x86 time stamp counter (constant rate, core clock on most hosts); on other hosts pass the
+ *  core clock in MHz and bytes/cycle is derived from elapsed time.
+ *
+ *  Build (from this directory):
+ *      for v in NIBBLE TABLE256 SLICE8; do gcc -O2 -std=gnu99 -DLQC_CRC_$v -I../../src crcBench.c ../../src/lqc-crc.c -o crcBench_$v; done
+ *  Run:
+ *      for v in NIBBLE TABLE256 SLICE8; do ./crcBench_$v [megabytes=64] [cpuMHz]; done
+ *
+ *  Prints variant, buffer size, MB/second and bytes/cycle; exit code 0 if the variant verifies.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#include "lqc-crc.h"
+
+#if defined(LQC_CRC_NIBBLE)
+    #define CRC_VARIANT "nibble"
+#elif defined(LQC_CRC_TABLE256)
+    #define CRC_VARIANT "table256"
+#elif defined(LQC_CRC_SLICE8)
+    #define CRC_VARIANT "slice8"
+#else
+    #define CRC_VARIANT "default"
+#endif
+
+#define BENCH_BUFFER_MAXSZ 65536
+
+static const uint16_t S__bufferSizes[] = { 64, 256, 1024, 4096 };
+static uint8_t S__buffer[BENCH_BUFFER_MAXSZ];
+
+static bool S__verify();
+static uint64_t S__readCycles();
+static double S__elapsedSecs(struct timespec *start);
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t megabytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : 64;
+    double cpuMHz = (argc > 2) ? atof(argv[2]) : 0;
+    bool cycleCounter = S__readCycles() != 0;
+
+    if (!S__verify())
+    {
+        printf("%-9s  verify FAILED\n", CRC_VARIANT);
+        return 1;
+    }
+    for (uint32_t i = 0; i < sizeof(S__buffer); i++)
+        S__buffer[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    if (!cycleCounter && cpuMHz == 0)
+        printf("no cycle counter, pass cpuMHz for bytes/cycle\n");
+    printf("variant    bufferSz     MB/sec  bytes/cycle\n");
+
+    for (uint8_t s = 0; s < sizeof(S__bufferSizes) / sizeof(S__bufferSizes[0]); s++)
+    {
+        uint16_t bufferSz = S__bufferSizes[s];
+        uint32_t passes = (uint32_t)((uint64_t)megabytes * 1024 * 1024 / bufferSz);
+        volatile uint32_t sink;
+        struct timespec start;
+
+        sink = lqcCrc_compute(S__buffer, bufferSz);                             // slice8: tables built before timing
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t cyclesStart = S__readCycles();
+
+        uint32_t crc = lqcCrc_init();
+        for (uint32_t pass = 0; pass < passes; pass++)
+            crc = lqcCrc_update(crc, S__buffer + (pass * 64) % (BENCH_BUFFER_MAXSZ - bufferSz), bufferSz);
+        sink = lqcCrc_final(crc);
+        (void)sink;
+
+        uint64_t cycles = S__readCycles() - cyclesStart;
+        double elapsed = S__elapsedSecs(&start);
+        double bytes = (double)passes * bufferSz;
+        if (!cycleCounter)
+            cycles = (uint64_t)(elapsed * cpuMHz * 1e6);
+
+        if (cycles > 0)
+            printf("%-9s  %8d  %9.1f  %11.3f\n", CRC_VARIANT, bufferSz, bytes / elapsed / 1e6, bytes / cycles);
+        else
+            printf("%-9s  %8d  %9.1f  %11s\n", CRC_VARIANT, bufferSz, bytes / elapsed / 1e6, "-");
+    }
+    return 0;
+}
+
+
+/**
+ *	\brief CRC-32 check value ("123456789"), and every split of a buffer across two updates matches one update.
+ */
+static bool S__verify()
+{
+    uint8_t data[67];
+
+    if (lqcCrc_compute("123456789", 9) != 0xCBF43926)
+        return false;
+
+    for (uint8_t i = 0; i < sizeof(data); i++)
+        data[i] = i * 37 + 11;
+    uint32_t whole = lqcCrc_compute(data + 1, sizeof(data) - 1);                // unaligned start
+    for (uint8_t split = 0; split < sizeof(data) - 1; split++)
+    {
+        uint32_t crc = lqcCrc_update(lqcCrc_init(), data + 1, split);
+        crc = lqcCrc_update(crc, data + 1 + split, sizeof(data) - 1 - split);
+        if (lqcCrc_final(crc) != whole)
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ *	\brief Cycle count from the x86 TSC, 0 if the host has no counter readable from user mode.
+ */
+static uint64_t S__readCycles()
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+    #else
+    return 0;
+    #endif
+}
+
+
+static double S__elapsedSecs(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,203 @@
+/******************************************************************************
+ *  \file hmacBench.c
+ *  \brief Linux host benchmark for SAS token signing: SHA-256 throughput, HMAC-SHA256 and lqc_generateIothSasToken().
+ *
+ *  Verifies the SHA-256 and HMAC-SHA256 implementation against FIPS 180-2 and RFC 4231 vectors (including a key longer
+ *  than the block size), then times SHA-256 over message sizes, HMAC-SHA256 of an IoT Hub string-to-sign with 32 and
+ *  64 byte device keys (the key sizes IoT Hub issues) and complete SAS token generation as done at renewal.
+ *
+ *  Bytes/cycle and cycles/op are from the x86 time stamp counter (constant rate, core clock on most hosts); on other
+ *  hosts pass the core clock in MHz and cycles are derived from elapsed time.
+ *
+ *  Build (from this directory, LTEmC and LooUQ common sources on the include path as for any Linux build):
+ *      gcc -O2 -std=gnu99 -I../../src -I<ltemc>/src hmacBench.c ../../src/lq*.c <ltemc sources> -lpthread -o hmacBench
+ *  Run:
+ *      ./hmacBench [iterations=200000] [cpuMHz]
+ *
+ *  Prints ops/second, microseconds and cycles per op (bytes/cycle for SHA-256); exit code 0 if the vectors verify.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#include "lqc-internal.h"
+#include "lqc-sha256.h"
+
+#define SHA_INPUT_MAXSZ 16384
+
+typedef struct benchTiming_tag
+{
+    struct timespec start;
+    uint64_t cyclesStart;
+} benchTiming_t;
+
+static const uint16_t S__shaSizes[] = { 64, 1024, SHA_INPUT_MAXSZ };
+static const char S__hostUrl[] = "iothub-dev-pelogical.azure-devices.net";
+static const char S__deviceId[] = "hmacBench-000000000000001";
+static uint8_t S__input[SHA_INPUT_MAXSZ];
+static double S__cpuMHz;
+static bool S__cycleCounter;
+
+static bool S__verify();
+static bool S__checkHmac(const char *vectorName, const uint8_t *key, uint16_t keySz, const void *data, uint32_t dataSz, const char *expectedHex);
+static void S__startTiming(benchTiming_t *timing);
+static void S__reportOps(const char *name, uint32_t ops, uint32_t bytesPerOp, benchTiming_t *timing);
+static uint64_t S__readCycles();
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+    S__cpuMHz = (argc > 2) ? atof(argv[2]) : 0;
+    S__cycleCounter = S__readCycles() != 0;
+    volatile uint8_t sink = 0;
+    benchTiming_t timing;
+
+    if (!S__verify())
+        return 1;
+    if (!S__cycleCounter && S__cpuMHz == 0)
+        printf("no cycle counter, pass cpuMHz for cycles\n");
+    for (uint32_t i = 0; i < sizeof(S__input); i++)
+        S__input[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    printf("%-20s  %7s  %12s  %8s  %11s  %11s\n", "operation", "bytes", "ops/sec", "us/op", "cycles/op", "bytes/cycle");
+    for (uint8_t s = 0; s < sizeof(S__shaSizes) / sizeof(S__shaSizes[0]); s++)
+    {
+        uint16_t inputSz = S__shaSizes[s];
+        uint32_t ops = (uint32_t)((uint64_t)iterations * 64 / inputSz) + 1;
+        uint8_t digest[lqcSha256__digestSz];
+        lqcSha256_t sha;
+
+        S__startTiming(&timing);
+        for (uint32_t op = 0; op < ops; op++)
+        {
+            lqcSha256_init(&sha);
+            lqcSha256_update(&sha, S__input, inputSz);
+            lqcSha256_final(&sha, digest);
+            sink ^= digest[0];
+        }
+        S__reportOps("sha256", ops, inputSz, &timing);
+    }
+
+    char stringToSign[lqc__identity_hostUrlSz + lqc__identity_deviceIdSz + 26];
+    uint16_t signLen = snprintf(stringToSign, sizeof(stringToSign), "%s%%2Fdevices%%2F%s\n%lu", S__hostUrl, S__deviceId, 1999999999UL);
+    for (uint8_t keySz = 32; keySz <= 64; keySz += 32)
+    {
+        uint8_t mac[lqcSha256__digestSz];
+        char name[24];
+
+        snprintf(name, sizeof(name), "hmac key=%d", keySz);
+        S__startTiming(&timing);
+        for (uint32_t op = 0; op < iterations; op++)
+        {
+            lqcSha256_hmac(S__input + (op & 0xFF), keySz, stringToSign, signLen, mac);
+            sink ^= mac[0];
+        }
+        S__reportOps(name, iterations, signLen, &timing);
+    }
+
+    char sasToken[LQC__sas_tokenSz];
+    S__startTiming(&timing);
+    for (uint32_t op = 0; op < iterations; op++)
+    {
+        lqc_generateIothSasToken(sasToken, sizeof(sasToken), S__hostUrl, S__deviceId, S__input, 32, 1999999999UL - op);
+        sink ^= sasToken[sizeof("SharedAccessSignature sr=")];
+    }
+    S__reportOps("sasToken key=32", iterations, signLen, &timing);
+
+    (void)sink;
+    return 0;
+}
+
+
+/**
+ *	\brief FIPS 180-2 "abc" digest and RFC 4231 HMAC-SHA256 test cases 1, 2 and 6 (131 byte key, hashed first).
+ */
+static bool S__verify()
+{
+    uint8_t digest[lqcSha256__digestSz];
+    uint8_t key[131];
+    lqcSha256_t sha;
+    char hex[2 * lqcSha256__digestSz + 1];
+
+    lqcSha256_init(&sha);
+    lqcSha256_update(&sha, "abc", 3);
+    lqcSha256_final(&sha, digest);
+    for (uint8_t i = 0; i < sizeof(digest); i++)
+        sprintf(hex + 2 * i, "%02x", digest[i]);
+    if (strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") != 0)
+    {
+        printf("sha256 \"abc\" FAILED: %s\n", hex);
+        return false;
+    }
+
+    memset(key, 0x0b, 20);
+    bool passed = S__checkHmac("RFC 4231 #1", key, 20, "Hi There", 8, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    passed = passed && S__checkHmac("RFC 4231 #2", (const uint8_t *)"Jefe", 4, "what do ya want for nothing?", 28, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    memset(key, 0xaa, sizeof(key));
+    passed = passed && S__checkHmac("RFC 4231 #6", key, sizeof(key), "Test Using Larger Than Block-Size Key - Hash Key First", 54, "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    return passed;
+}
+
+
+static bool S__checkHmac(const char *vectorName, const uint8_t *key, uint16_t keySz, const void *data, uint32_t dataSz, const char *expectedHex)
+{
+    uint8_t mac[lqcSha256__digestSz];
+    char hex[2 * lqcSha256__digestSz + 1];
+
+    lqcSha256_hmac(key, keySz, data, dataSz, mac);
+    for (uint8_t i = 0; i < sizeof(mac); i++)
+        sprintf(hex + 2 * i, "%02x", mac[i]);
+    if (strcmp(hex, expectedHex) != 0)
+    {
+        printf("%s FAILED: %s\n", vectorName, hex);
+        return false;
+    }
+    return true;
+}
+
+
+static void S__startTiming(benchTiming_t *timing)
+{
+    clock_gettime(CLOCK_MONOTONIC, &timing->start);
+    timing->cyclesStart = S__readCycles();
+}
+
+
+/**
+ *	\brief Print rate, time and cycles per op since S__startTiming().
+ */
+static void S__reportOps(const char *name, uint32_t ops, uint32_t bytesPerOp, benchTiming_t *timing)
+{
+    struct timespec now;
+    uint64_t cycles = S__readCycles() - timing->cyclesStart;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - timing->start.tv_sec) + (now.tv_nsec - timing->start.tv_nsec) / 1e9;
+    if (!S__cycleCounter)
+        cycles = (uint64_t)(elapsed * S__cpuMHz * 1e6);
+
+    printf("%-20s  %7lu  %12.0f  %8.3f", name, (unsigned long)bytesPerOp, ops / elapsed, elapsed * 1e6 / ops);
+    if (cycles > 0)
+        printf("  %11.0f  %11.3f\n", (double)cycles / ops, (double)bytesPerOp * ops / cycles);
+    else
+        printf("  %11s  %11s\n", "-", "-");
+}
+
+
+/**
+ *	\brief Cycle count from the x86 TSC, 0 if the host has no counter readable from user mode.
+ */
+static uint64_t S__readCycles()
+{
+    #if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+    #else
+    return 0;
+    #endif
+}
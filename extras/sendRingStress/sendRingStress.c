@@ -0,0 +1,190 @@
+/******************************************************************************
+ *  \file sendRingStress.c
+ *  \brief Linux host stress and throughput harness for the thread-safe send ring (LQC_THREADSAFE).
+ *
+ *  Producer threads place sends with LQC_trySend(), one consumer thread drains the ring with LQC_drainSendRing() as the
+ *  network worker does in lqc_doWork(). Each body carries "<producer>:<seq>", the send callback checks every producer's
+ *  messages arrive exactly once and in order (the ring preserves per-producer order), so any lost or duplicated message
+ *  fails the run. A send dropped with the ring full is retried by its producer and counted.
+ *
+ *  Build (from this directory, LTEmC and LooUQ common sources on the include path as for any Linux build):
+ *      gcc -O2 -std=gnu99 -DLQC_THREADSAFE -I../../src -I<ltemc>/src sendRingStress.c ../../src/lq*.c <ltemc sources> -lpthread -o sendRingStress
+ *  Run:
+ *      ./sendRingStress [maxProducers=8] [msgsPerProducer=200000] [slotCnt=64]
+ *
+ *  Prints producers, messages/second and full-ring retries for 1..maxProducers, exit code 0 if all runs verify.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "lqc-internal.h"
+
+#define PRODUCERS_MAX 64
+
+typedef struct producer_tag
+{
+    pthread_t thread;
+    uint16_t producerId;
+    uint32_t msgCnt;
+    uint32_t fullRetries;
+} producer_t;
+
+static lqcDeviceConfig_t S__deviceCnfg = { .deviceId = "sendRingStress" };
+static uint32_t S__expectedSeq[PRODUCERS_MAX];                  // consumer only (drain is single threaded)
+static uint32_t S__recvCnt;
+static uint32_t S__errorCnt;
+static volatile bool S__startFlag;
+
+static void *S__producer(void *arg);
+static void *S__consumer(void *arg);
+static resultCode_t S__recordSend(const char *topic, const char *message, uint8_t timeoutSec);
+static double S__elapsedSecs(struct timespec *start);
+
+
+int main(int argc, char *argv[])
+{
+    uint16_t maxProducers = (argc > 1) ? atoi(argv[1]) : 8;
+    uint32_t msgsPerProducer = (argc > 2) ? strtoul(argv[2], NULL, 10) : 200000;
+    uint16_t slotCnt = (argc > 3) ? atoi(argv[3]) : 64;
+    producer_t producers[PRODUCERS_MAX];
+
+    if (maxProducers == 0 || maxProducers > PRODUCERS_MAX)
+    {
+        fprintf(stderr, "maxProducers must be 1..%d\n", PRODUCERS_MAX);
+        return 2;
+    }
+    lqcSendSlot_t *slots = calloc(slotCnt, sizeof(lqcSendSlot_t));
+    lqc_create(lqcDeviceType_ctrllr, &S__deviceCnfg, S__recordSend, NULL, NULL, NULL, "000000000000");
+    if (slots == NULL || !lqc_enableThreadSafeSend(slots, slotCnt))
+    {
+        fprintf(stderr, "thread-safe send not enabled: slotCnt must be a power of 2, library built with LQC_THREADSAFE\n");
+        return 2;
+    }
+
+    printf("slots=%d msgsPerProducer=%lu\n", slotCnt, (unsigned long)msgsPerProducer);
+    printf("producers      msgs/sec   fullRetries  result\n");
+
+    bool allPassed = true;
+    for (uint16_t producerCnt = 1; producerCnt <= maxProducers; producerCnt++)
+    {
+        pthread_t consumer;
+        uint32_t totalCnt = producerCnt * msgsPerProducer;
+        uint32_t fullRetries = 0;
+        struct timespec start;
+
+        lqc_enableThreadSafeSend(slots, slotCnt);                               // empty ring, a failed run may leave sends in it
+        memset(S__expectedSeq, 0, sizeof(S__expectedSeq));
+        S__recvCnt = 0;
+        S__errorCnt = 0;
+        S__startFlag = false;
+
+        for (uint16_t i = 0; i < producerCnt; i++)
+        {
+            producers[i] = (producer_t){ .producerId = i, .msgCnt = msgsPerProducer };
+            pthread_create(&producers[i].thread, NULL, S__producer, &producers[i]);
+        }
+        pthread_create(&consumer, NULL, S__consumer, &totalCnt);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        __atomic_store_n(&S__startFlag, true, __ATOMIC_RELEASE);
+        for (uint16_t i = 0; i < producerCnt; i++)
+        {
+            pthread_join(producers[i].thread, NULL);
+            fullRetries += producers[i].fullRetries;
+        }
+        pthread_join(consumer, NULL);
+        double elapsed = S__elapsedSecs(&start);
+
+        for (uint16_t i = 0; i < producerCnt; i++)
+        {
+            if (S__expectedSeq[i] != msgsPerProducer)                           // lost messages (duplicates fail at receive)
+                S__errorCnt++;
+        }
+        bool passed = S__errorCnt == 0 && S__recvCnt == totalCnt;
+        allPassed = allPassed && passed;
+        printf("%9d  %12.0f  %12lu  %s\n", producerCnt, totalCnt / elapsed, (unsigned long)fullRetries, passed ? "ok" : "FAILED");
+    }
+
+    free(slots);
+    return allPassed ? 0 : 1;
+}
+
+
+/**
+ *	\brief Producer: send msgCnt sequenced bodies, retry while the ring is full (give up if the run has failed).
+ */
+static void *S__producer(void *arg)
+{
+    producer_t *producer = (producer_t *)arg;
+    lqcHandle_t lqc = lqc_getDefaultInstance();
+    char topic[] = "devices/sendRingStress/messages/events/evT=tele&evN=stress";
+    char body[40];
+
+    while (!__atomic_load_n(&S__startFlag, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    for (uint32_t seq = 0; seq < producer->msgCnt; seq++)
+    {
+        snprintf(body, sizeof(body), "%u:%lu", producer->producerId, (unsigned long)seq);
+        while (LQC_trySend(lqc, topic, body, true, 0) == lqcSendResult_dropped)
+        {
+            if (__atomic_load_n(&S__errorCnt, __ATOMIC_RELAXED) > 0)           // consumer stopped, run failed
+                return NULL;
+            producer->fullRetries++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ *	\brief Consumer: drain the ring (as the network worker) until all messages of the run are received.
+ */
+static void *S__consumer(void *arg)
+{
+    uint32_t totalCnt = *(uint32_t *)arg;
+
+    while (S__recvCnt < totalCnt && S__errorCnt == 0)
+    {
+        uint32_t recvCnt = S__recvCnt;
+        LQC_drainSendRing();
+        if (S__recvCnt == recvCnt)
+            sched_yield();
+    }
+    return NULL;
+}
+
+
+/**
+ *	\brief Send callback, invoked from LQC_drainSendRing(): verify the message is the next expected from its producer.
+ */
+static resultCode_t S__recordSend(const char *topic, const char *message, uint8_t timeoutSec)
+{
+    char *seqPart;
+    unsigned long producerId = strtoul(message, &seqPart, 10);
+    unsigned long seq = strtoul(seqPart + 1, NULL, 10);
+
+    if (*seqPart != ':' || producerId >= PRODUCERS_MAX || seq != S__expectedSeq[producerId])
+    {
+        if (__atomic_add_fetch(&S__errorCnt, 1, __ATOMIC_RELAXED) <= 10)
+            fprintf(stderr, "unexpected message \"%s\", expected seq %lu\n", message, (unsigned long)S__expectedSeq[producerId % PRODUCERS_MAX]);
+        return resultCode__success;
+    }
+    S__expectedSeq[producerId]++;
+    S__recvCnt++;
+    return resultCode__success;
+}
+
+
+static double S__elapsedSecs(struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -189,27 +189,8 @@ lqcSendResult_t LQC_sendHttp(const char *topic, const char *body, bool queueOnFa
  */
 static void S__cloudReceiver(dataCntxt_t dataCntxt, uint16_t msgId, const char *topic, char *topicProps, char *message, uint16_t messageSz)
 {
-    keyValueDict_t mqttProps = lq_createQryStrDictionary(topicProps, strlen(topicProps));
-
-    #ifdef _DEBUG
     PRINTF(dbgColor__info, "\r**MQTT--MSG** \tick=%d\r", pMillis());
-    PRINTF(dbgColor__cyan, "\rt(%d): %s", strlen(topic), topic);
-    PRINTF(dbgColor__cyan, "\rp(%d): %s", strlen(topicProps), topicProps);
-    PRINTF(dbgColor__cyan, "\rm(%d): %s", strlen(message), message);
-    PRINTF(dbgColor__info, "\rProps(%d)\r", mqttProps.count);
-    for (size_t i = 0; i < mqttProps.count; i++)
-    {
-        PRINTF(dbgColor__cyan, "%s=%s\r", mqttProps.keys[i], mqttProps.values[i]);
-    }
-    PRINTF(0, "\r");
-    #endif
-
-    lq_getQryStrDictionaryValue("$.mid", mqttProps, g_lqCloud.actnMsgId, LQC__messageIdSz);
-    lq_getQryStrDictionaryValue("evN", mqttProps, g_lqCloud.actnName, LQC__action_nameSz);
-    // strcpy(g_lqCloud.actnMsgId, lqc_getDictValue("$.mid", mqttProps));
-    // strcpy(g_lqCloud.actnName, lqc_getDictValue("evN", mqttProps));
-    g_lqCloud.actnResult = resultCode__notFound;
-    LQC_processIncomingActionRequest(g_lqCloud.actnName, mqttProps, message);
+    lqc_receiveMsg(message, messageSz, topicProps);                       // copy only, action performed from lqc_doWork()
 }
 
 
@@ -119,7 +119,7 @@ bool LQC_connectMqtt(/*mqttState_t mqttState*/)
         snprintf(userId, sizeof(userId), IotHubTemplate_sas_userId, g_lqCloud.deviceCnfg->hostUrl, g_lqCloud.deviceCnfg->deviceId);
         lqc_composeSASToken(tokenSAS, sizeof(tokenSAS), g_lqCloud.deviceCnfg->hostUrl, g_lqCloud.deviceCnfg->deviceId, g_lqCloud.deviceCnfg->tokenSigExpiry);
 
-        connRslt = mqtt_connect(g_lqCloud.mqttCtrl, true);
+        connRslt = mqtt_connect(g_lqCloud.mqttCtrl, !g_lqCloud.connectInfo.sessionResume);   // persistent session keeps C2D subscription
         switch (connRslt)
         {
             case resultCode__success:
@@ -142,6 +142,10 @@ bool LQC_connectMqtt(/*mqttState_t mqttState*/)
 
     if (connRslt == resultCode__success)                // mqtt status agrees, verify subscribed
     {
+        if (g_lqCloud.connectInfo.sessionResume)        // subscribe regardless, no session-present flag to tell a resumed session
+            g_lqCloud.commMetrics.sessionResumes++;
+        else
+            g_lqCloud.commMetrics.sessionFullSetups++;
         char subscribeTopic[mqtt__topic_nameSz];
         snprintf(subscribeTopic, sizeof(subscribeTopic), IoTHubTemplate_C2D_recvTopic, g_lqCloud.deviceCnfg->deviceId);
 
@@ -260,27 +264,8 @@ lqcSendResult_t LQC_sendMqtt(const char *topic, const char *body, bool queueOnFa
  */
 static void S__cloudReceiver(dataCntxt_t dataCntxt, uint16_t msgId, const char *topic, char *topicProps, char *message, uint16_t messageSz)
 {
-    keyValueDict_t mqttProps = lq_createQryStrDictionary(topicProps, strlen(topicProps));
-
-    #ifdef _DEBUG
     PRINTF(dbgColor__info, "\r**MQTT--MSG** \tick=%d\r", pMillis());
-    PRINTF(dbgColor__cyan, "\rt(%d): %s", strlen(topic), topic);
-    PRINTF(dbgColor__cyan, "\rp(%d): %s", strlen(topicProps), topicProps);
-    PRINTF(dbgColor__cyan, "\rm(%d): %s", strlen(message), message);
-    PRINTF(dbgColor__info, "\rProps(%d)\r", mqttProps.count);
-    for (size_t i = 0; i < mqttProps.count; i++)
-    {
-        PRINTF(dbgColor__cyan, "%s=%s\r", mqttProps.keys[i], mqttProps.values[i]);
-    }
-    PRINTF(0, "\r");
-    #endif
-
-    lq_getQryStrDictionaryValue("$.mid", mqttProps, g_lqCloud.actnMsgId, LQC__messageIdSz);
-    lq_getQryStrDictionaryValue("evN", mqttProps, g_lqCloud.actnName, LQC__action_nameSz);
-    // strcpy(g_lqCloud.actnMsgId, lqc_getDictValue("$.mid", mqttProps));
-    // strcpy(g_lqCloud.actnName, lqc_getDictValue("evN", mqttProps));
-    g_lqCloud.actnResult = resultCode__notFound;
-    LQC_processIncomingActionRequest(g_lqCloud.actnName, mqttProps, message);
+    lqc_gatewayReceiveMsg(topic, message, messageSz, topicProps);         // copy only, action performed from lqc_doWork(); routed to gateway child by topic
 }
 
 
@@ -49,16 +49,26 @@
 #include "lqc-azure.h"
 #include <lq-SAMDutil.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #define MIN(x, y) (((x)<(y)) ? (x):(y))
 #define MAX(x, y) (((x)>(y)) ? (x):(y))
 #define SEND_RETRIES 3
 #define SEND_RETRYWAIT 2000
 
 /* ------------------------------------------------------------------------------------------------
- * GLOBAL LQCloud Client Object (one LQCloud supported)
+ * GLOBAL LQCloud Client Object (default instance, additional instances via lqc_createInstance())
  * --------------------------------------------------------------------------------------------- */
 lqCloudDevice_t g_lqCloud;
 
+static bool S__eventRspBusy;                                                    // app event request/response exchange in progress (any thread)
+static appEventResponse_t *S__eventRsp = NULL;                                  // requester's response, receives lqc_setEventResponse()
+static int S__wakeupFd = -1;                                                    // Linux hosts: eventfd from lqc_getWakeupFd()
+static lqcSendRing_t S__sendRing;                                               // thread-safe mode send ring, serves all instances
+
 
 /* Local (static/non-public) functions */
 //static bool S_ntwkConnectionManager(bool reqstConn, bool resetConn);
@@ -69,6 +79,14 @@ lqCloudDevice_t g_lqCloud;
 static void S__cloudReceiver(uint16_t msgId, const char *topic, char *topicProps, char *message, uint16_t messageSz);
 
 //static inline void S__ChangeLQCConnectState(uint8_t newState);
+static lqcSendResult_t S__transmit(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds);
+static lqcSendResult_t S__enqueueSend(lqCloudDevice_t *lqc, const char *topic, const char *body);
+static lqcSendResult_t S__trySendDirect(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds);
+static lqcSendResult_t S__enqueueSendRing(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds);
+static bool S__sendRingPending();
+static void S__clearWakeup();
+static uint32_t S__bootRetryMillis(lqCloudDevice_t *lqc);
+static void S__initInstance(lqCloudDevice_t *lqc, lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *deviceKey);
 
 
 #pragma region  Public LooUQ Cloud functions
@@ -83,19 +101,7 @@ static void S__cloudReceiver(uint16_t msgId, const char *topic, char *topicProps
  */
 void lqc_create(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *deviceKey)
 {
-    ASSERT(sendMessageCB != NULL);
-    ASSERT(deviceConfig != NULL);
-    ASSERT(strlen(deviceKey) > 0);
-    ASSERT(strlen(deviceKey) <= lqc__identity_deviceKeySz);
-
-    g_lqCloud.deviceType = deviceType;
-    g_lqCloud.sendMessageCB = sendMessageCB;
-    g_lqCloud.applEvntNotifyCB = applEvntNotifyCB;
-    g_lqCloud.applInfoRequestCB = applInfoRequestCB;
-    g_lqCloud.yieldCB = yieldCB;
-    g_lqCloud.deviceCnfg = deviceConfig;
-
-    strncpy( g_lqCloud.deviceKey, deviceKey, lqc__identity_deviceKeySz);
+    S__initInstance(&g_lqCloud, deviceType, deviceConfig, sendMessageCB, applEvntNotifyCB, applInfoRequestCB, yieldCB, deviceKey);
 
     /* **** Failed send msg recovery queue creation **** 
      ********************************************************************************** */
@@ -112,6 +118,49 @@ void lqc_create(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqc
 }
 
 
+/**
+ *	@brief Creates an additional LQCloud instance (a device identity with its own actions, queues and metrics).
+ *
+ *  Instances send through their own sendMessageCB and are serviced by lqcInst_doWork(); the connection manager and 
+ *  the alternate transports (HTTP fallback, data pump, CoAP) serve only the default instance (lqc_create()).
+ *  Parameters are as lqc_create().
+ *  @return Handle to the instance, NULL if memory is not available.
+ */
+lqcHandle_t lqc_createInstance(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *deviceKey)
+{
+    lqCloudDevice_t *lqc = calloc(1, sizeof(lqCloudDevice_t));
+    if (lqc == NULL)
+        return NULL;
+
+    S__initInstance(lqc, deviceType, deviceConfig, sendMessageCB, applEvntNotifyCB, applInfoRequestCB, yieldCB, deviceKey);
+    lqc->deviceState = lqcDeviceState_offline;
+    return lqc;
+}
+
+
+/**
+ *	@brief Release an instance created with lqc_createInstance(), the default instance is not released.
+ *  A gateway child is removed from the gateway first, the gateway holds its handle.
+ */
+void lqc_destroyInstance(lqcHandle_t lqc)
+{
+    if (lqc == NULL || lqc == &g_lqCloud)
+        return;
+    if (lqc->isGatewayChild)
+        lqc_gatewayRemoveChild(lqc->deviceCnfg->deviceId);
+    free(lqc);
+}
+
+
+/**
+ *	@brief Get the handle of the default instance, the instance the lqc_* functions operate on.
+ */
+lqcHandle_t lqc_getDefaultInstance()
+{
+    return &g_lqCloud;
+}
+
+
 /**
  *	@brief Initialize the LTEx modem.
  *
@@ -121,7 +170,10 @@ void lqc_create(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqc
 void lqc_start(uint8_t resetCause)
 {
     g_lqCloud.deviceState = lqcDeviceState_offline;
-    LQC_doStartEvents(resetCause);
+    g_lqCloud.resetCause = resetCause;
+    g_lqCloud.bootPending = true;
+    LQC_doStartEvents(&g_lqCloud);
+    LQC_startWorker();                                                      // worker mode: network work moves to worker thread
 
     // g_lqCloud.deviceCnfg = (*g_lqCloud.getDeviceCfgCB)(true);
 
@@ -188,40 +240,37 @@ void lqc_enableDiagnostics(diagnosticInfo_t *diagnosticsInfoBlock)
 }
 
 
-void lqc_setEventResponse(uint8_t requestEvent, uint16_t result, const char *response)
+void lqc_enableRecentActionsCache(lqcRecentActions_t *recentActions)
 {
-    g_lqCloud.appEventResponse.requestCode = requestEvent;
-    g_lqCloud.appEventResponse.resultCode = result;
-    strncpy(g_lqCloud.appEventResponse.message, response, sizeof(g_lqCloud.appEventResponse.message));
+    LQC_initRecentActions(&g_lqCloud, recentActions);
 }
 
 
-// /**
-//  *	@brief Sets connection mode for cloud MQTT connection. Default at LQC init is Continuous. 
-//  *
-//  *	@param [in] connMode Enum specifying the type of connection between the local device and the LQCloud.
-//  *  @param [in] interConnectMin Number of minutes between cloud connections (only applies to periodic connect mode)
-//  *  @param [in] holdConnectMin Once a periodic connection is established, the number of minutes to hold it open (only applies to periodic connect mode)
-//  */
-// void lqc_setConnectMode(lqcConnect_t connectMode, uint16_t interConnectMin, uint16_t holdConnectMin)
-// {
-//     ASSERT(connectMode < lqcConnect__invalid);
-//     g_lqCloud.connectInfo.connectMode = connectMode;
-//     g_lqCloud.odConnectInfo.odc_interConnectTicks = interConnectMin * 60000;
-//     g_lqCloud.odConnectInfo.odc_holdConnectTicks = holdConnectMin * 60000;
-//     g_lqCloud.odConnectInfo.odc_connectAt = 0;
-//     g_lqCloud.odConnectInfo.odc_disconnectAt = 0;
-// }
+void lqc_setSendQueue(char *queueBuffer, uint16_t bufferSz)
+{
+    g_lqCloud.recoveryQueue.queueBuffer = queueBuffer;
+    g_lqCloud.recoveryQueue.bufferSz = bufferSz;
+    g_lqCloud.recoveryQueue.usedSz = 0;
+    g_lqCloud.recoveryQueue.queueCnt = 0;
+}
 
 
-// /**
-//  *	@brief Query for mode of connectivity to the LQCloud.
-//  *  @return Enum representing device to cloud connection mode
-//  */
-// lqcConnect_t lqc_getConnectMode()
-// {
-//     return g_lqCloud.connectInfo.connectMode;
-// }
+void lqc_setActionDispatchBudget(uint8_t actionsPerPass)
+{
+    g_lqCloud.actnQueue.dispatchBudget = (actionsPerPass == 0) ? LQC__actionDispatchBudget : actionsPerPass;
+}
+
+
+void lqc_setEventResponse(uint8_t requestEvent, uint16_t result, const char *response)
+{
+    appEventResponse_t *eventRsp = S__eventRsp;
+
+    if (eventRsp == NULL)                                                               // not answering an LQCloud request
+        return;
+    eventRsp->requestCode = requestEvent;
+    eventRsp->resultCode = result;
+    strncpy(eventRsp->message, response, sizeof(eventRsp->message) - 1);
+}
 
 
 // /**
@@ -257,8 +306,10 @@ void lqc_setEventResponse(uint8_t requestEvent, uint16_t result, const char *res
 
 bool lqc_isOnline()
 {
-    //return g_lqCloud.connectInfo.state == lqcConnectState_messagingReady;
-    return true;
+    if (g_lqCloud.connectInfo.mqttCtrl != NULL)                                     // connection manager enabled
+        return g_lqCloud.connectInfo.state == lqcConnectState_messagingReady ||
+               (LQC_httpFallbackActive() && g_lqCloud.commMetrics.consecutiveSendFails == 0);
+    return g_lqCloud.commMetrics.consecutiveSendFails == 0;                       // application managed: last send succeeded
 }
 
 
@@ -295,31 +346,78 @@ lqcSendResult_t lqc_diagnosticsCheck(diagnosticInfo_t *diagInfo)
  */
 void lqc_doWork()
 {
-    if (!g_lqCloud.isOnline &&                                                                  // if not online
-        (pMillis() -  g_lqCloud.deviceStateChangeAt) > LQC__connection_retryIntervalSecs)       // and retry wait satisfied
+    lqcInst_doWork(&g_lqCloud);
+}
+
+
+/**
+ *	@brief Perform background processing for a specific instance, the default instance also services the connection and transports.
+ */
+void lqcInst_doWork(lqcHandle_t lqc)
+{
+    if (lqc == &g_lqCloud)
     {
-        if (g_lqCloud.deviceState == lqcDeviceState_online)
-            LQC_doStartEvents();
+        S__clearWakeup();                                                                       // before the work, a signal raised during it is kept
+        if (LQC_workerRunning())
+            LQC_deliverCompletions();                                                           // worker mode: notifications raised by network worker
+        else
+            LQC_doNetworkWork();
+        LQC_doIsrEventWork();                                                                   // expand ISR captured events into alerts/telemetry
+        LQC_doSchedulerWork();                                                                  // fire due timers, deadline order
+        LQC_doGatewayActionWork();                                                              // gateway: child actions, on the application thread
+        LQC_doTransferWork();                                                                   // ack chunked transfer windows, expire stalled transfer
     }
+    LQC_dispatchActionRequests(lqc);                                                            // perform queued cloud action requests
+    LQC_checkActionTimeouts(lqc);                                                               // respond to deferred actions that have run too long
 
+    if (lqc->bootPending && wrkTime_isElapsed(lqc->deviceStateChangeAt, S__bootRetryMillis(lqc)))   // boot message not yet accepted
+        LQC_doStartEvents(lqc);
 }
 
 
-void LQC_doStartEvents()
+/**
+ *	@brief Service the transports and connection, from lqc_doWork() or the network worker thread in worker mode.
+ */
+void LQC_doNetworkWork()
 {
-    do
-    {
-        if (LQC_sendDeviceStarted() != lqcSendResult_sent)        // sending will attempt to bring LQC online, if device is not already
-            break;
+    LQC_drainSendRing();                                                                        // thread-safe: sends placed by other threads
+    LQC_doSasWork();                                                                            // renew SAS token ahead of expiry, while idle
+    LQC_manageConnection();                                                                     // advance (re)connect one step, if LQCloud manages connection
+    LQC_doDataPumpWork();                                                                       // sensor: post batch at interval, fetch C2D
+    LQC_doGatewayWork();                                                                        // gateway: child upstream send turns
+}
+
 
-        if (LQC_sendDiagnosticsAlert(g_lqCloud.diagnosticsInfo) != lqcSendResult_sent)
-            break;
+/**
+ *	@brief Report device start: a single boot message through the send queue, application sends are not held behind it.
+ *  @details The boot message stays pending until accepted (sent or queued), lqc_doWork() retries it. Without a send queue 
+ *  buffer the connection manager can not hold it until connected, it is then sent on the first pass after messagingReady.
+ */
+void LQC_doStartEvents(lqCloudDevice_t *lqc)
+{
+    bool firstRun = lqc->bootMillis == 0;
+    if (firstRun)
+        lqc->bootMillis = MAX(pMillis(), 1);                                                    // boot to running, reported in boot message and metrics
 
-        g_lqCloud.deviceState = lqcDeviceState_running;
+    lqc->deviceStateChangeAt = pMillis();
+    if (LQC_sendBootMessage(lqc) == lqcSendResult_dropped)                                      // sending will attempt to bring LQC online, if device is not already
+    {
+        if (firstRun)
+            lqc->bootMillis = 0;                                                                // not running, latched by the attempt that reaches running
+        lqc->deviceState = lqcDeviceState_offline;
         return;
-    } while (true);
-        
-    g_lqCloud.deviceState = lqcDeviceState_offline;
+    }
+    lqc->bootPending = false;
+    lqc->deviceState = lqcDeviceState_running;
+}
+
+
+/**
+ *	@brief Wait before retrying a dropped boot message: short once the transport is up, else the connection retry interval.
+ */
+static uint32_t S__bootRetryMillis(lqCloudDevice_t *lqc)
+{
+    return lqc->isOnline ? LQC__connect_stepIntervalMillis : PERIOD_FROM_SECONDS(LQC__connection_retryIntervalSecs);
 }
 
 #pragma endregion
@@ -352,16 +450,349 @@ void LQC_doStartEvents()
 // }
 
 
-lqcSendResult_t LQC_trySend(const char *topic, const char *body, bool queueOnFail, uint8_t timeoutSeconds)
+/**
+ *	@brief Send a message, or queue it (send queue, data pump batch, thread-safe ring) when it cannot be sent now.
+ *  @return sent or queued: accepted, delivery in order follows; dropped: not accepted, caller may retry.
+ */
+lqcSendResult_t LQC_trySend(lqCloudDevice_t *lqc, const char *topic, const char *body, bool queueOnFail, uint8_t timeoutSeconds)
+{
+    if (S__sendRing.slots != NULL)                                                       // thread-safe: network worker sends from ring
+        return S__enqueueSendRing(lqc, topic, body, timeoutSeconds);
+    return S__trySendDirect(lqc, topic, body, timeoutSeconds);
+}
+
+
+/**
+ *	@brief Send on the calling thread: data pump batch, gateway child queue, send queue (not connected) or transmit.
+ */
+static lqcSendResult_t S__trySendDirect(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds)
+{
+    bool defaultLqc = lqc == &g_lqCloud;                                                        // transports serve the default instance
+
+    if (lqc->isGatewayChild)                                                                    // gateway child: queued, sent upstream in turn
+    {
+        char gwTopic[LQMQ_TOPIC_PUB_MAXSZ];
+        if (!LQC_gatewayRewriteTopic(lqc, topic, gwTopic, sizeof(gwTopic)))
+            return lqcSendResult_dropped;
+        return S__enqueueSend(lqc, gwTopic, body);
+    }
+
+    if (defaultLqc && LQC_dataPumpEnabled())                                                    // sensor: batched, sent at interval
+        return LQC_appendToBatch(topic, body);
+
+    bool transportReady = lqc->connectInfo.state == lqcConnectState_messagingReady || (defaultLqc && LQC_httpFallbackActive());
+
+    if (lqc->connectInfo.mqttCtrl != NULL &&                                                    // connection managed by LQCloud
+        (!transportReady || lqc->recoveryQueue.queueCnt > 0))
+    {
+        return S__enqueueSend(lqc, topic, body);                                                // not connected (or earlier sends waiting), send in order at connect
+    }
+    lqc->connectInfo.odc_activityAt = pMillis();
+    return S__transmit(lqc, topic, body, timeoutSeconds);
+}
+
+
+/**
+ *	@brief Send the oldest queued message, invoked by connection manager when connected.
+ *  @return True if the queue is now empty.
+ */
+bool LQC_flushSendQueue(lqCloudDevice_t *lqc)
+{
+    lqcRecoveryQueue_t *queue = &lqc->recoveryQueue;
+    uint16_t topicSz;
+    uint16_t bodySz;
+
+    if (queue->queueCnt == 0)
+        return true;
+
+    memcpy(&topicSz, queue->queueBuffer, sizeof(uint16_t));
+    memcpy(&bodySz, queue->queueBuffer + sizeof(uint16_t), sizeof(uint16_t));
+    char *topic = queue->queueBuffer + 2 * sizeof(uint16_t);
+    char *body = topic + topicSz + 1;
+
+    lqc->connectInfo.odc_activityAt = pMillis();
+    queue->lastTryAt = pMillis();
+    if (S__transmit(lqc, topic, body, LQC__publishDefaultTimeoutS) != lqcSendResult_sent)
+        return false;                                                                           // leave queued, connection manager handles failures
+
+    uint16_t recordSz = 2 * sizeof(uint16_t) + topicSz + bodySz + 2;
+    memmove(queue->queueBuffer, queue->queueBuffer + recordSz, queue->usedSz - recordSz);
+    queue->usedSz -= recordSz;
+    queue->queueCnt--;
+    PRINTF(dbgColor__info, "SendQueue: sent, %d remaining\r", queue->queueCnt);
+    return queue->queueCnt == 0;
+}
+
+
+static lqcSendResult_t S__enqueueSend(lqCloudDevice_t *lqc, const char *topic, const char *body)
+{
+    lqcRecoveryQueue_t *queue = &lqc->recoveryQueue;
+    uint16_t topicSz = strlen(topic);
+    uint16_t bodySz = strlen(body);
+    uint16_t recordSz = 2 * sizeof(uint16_t) + topicSz + bodySz + 2;
+
+    if (queue->queueBuffer == NULL || queue->usedSz + recordSz > queue->bufferSz)
+    {
+        if (strstr(topic, "evT=alrt") != NULL)
+            LQC_ATOMIC_INC(lqc->droppedAlrtMsgCnt);
+        else
+            LQC_ATOMIC_INC(lqc->droppedTeleMsgCnt);
+        return lqcSendResult_dropped;
+    }
+
+    char *record = queue->queueBuffer + queue->usedSz;
+    memcpy(record, &topicSz, sizeof(uint16_t));
+    memcpy(record + sizeof(uint16_t), &bodySz, sizeof(uint16_t));
+    memcpy(record + 2 * sizeof(uint16_t), topic, topicSz + 1);
+    memcpy(record + 2 * sizeof(uint16_t) + topicSz + 1, body, bodySz + 1);
+    queue->usedSz += recordSz;
+    queue->queueCnt++;
+    return lqcSendResult_queued;
+}
+
+
+static lqcSendResult_t S__transmit(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds)
 {
-    resultCode_t cbResult = g_lqCloud.sendMessageCB(topic, body, timeoutSeconds);
+    resultCode_t cbResult;
+
+    if (lqc != &g_lqCloud)
+        cbResult = lqc->sendMessageCB(topic, body, timeoutSeconds);
+    else if (LQC_httpFallbackActive())
+        cbResult = LQC_sendHttp(topic, body, timeoutSeconds);
+    else
+    {
+        cbResult = lqc->sendMessageCB(topic, body, timeoutSeconds);
+        if (cbResult == resultCode__success)
+            LQC_trackMqttSuccess();
+        else
+            LQC_trackMqttFailure();
+    }
 
     if (cbResult != resultCode__success)
-        g_lqCloud.deviceState = lqcDeviceState_offline;
+    {
+        lqc->deviceState = lqcDeviceState_offline;
+        LQC_ATOMIC_INC(lqc->commMetrics.sendFailures);
+        LQC_ATOMIC_INC(lqc->commMetrics.consecutiveSendFails);         // connection manager reconnects at LQC__send_resetAtConsecutiveFailures
+    }
+    else
+    {
+        LQC_ATOMIC_INC(lqc->commMetrics.sendSucceeds);
+        LQC_ATOMIC_STORE(lqc->commMetrics.consecutiveSendFails, 0);
+    }
+
+    return (cbResult == resultCode__success) ? lqcSendResult_sent : lqcSendResult_dropped;
+}
+
+
+
+#pragma region  Thread-safe send ring
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ *	@brief Enable thread-safe send: sends from any thread are placed in slots, sent by the network worker (lqc_doWork()).
+ *  @param [in] sendSlots Application slot array.
+ *  @param [in] slotCnt Number of slots, must be a power of 2.
+ *  @return False if slotCnt is not a power of 2, or not built with LQC_THREADSAFE.
+ */
+bool lqc_enableThreadSafeSend(lqcSendSlot_t *sendSlots, uint16_t slotCnt)
+{
+    #ifdef LQC_THREADSAFE
+    if (slotCnt == 0 || (slotCnt & (slotCnt - 1)) != 0)
+        return false;
+
+    for (size_t i = 0; i < slotCnt; i++)
+        sendSlots[i].seq = i;
+    S__sendRing.mask = slotCnt - 1;
+    S__sendRing.enqueuePos = 0;
+    S__sendRing.dequeuePos = 0;
+    S__sendRing.fullCnt = 0;
+    __atomic_store_n(&S__sendRing.slots, sendSlots, __ATOMIC_RELEASE);
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+
+/**
+ *	@brief Network worker: send messages placed in the ring by producers, invoked from lqc_doWork().
+ */
+void LQC_drainSendRing()
+{
+    #ifdef LQC_THREADSAFE
+    lqcSendRing_t *ring = &S__sendRing;
+
+    if (ring->slots == NULL)
+        return;
+
+    for (size_t i = 0; i <= ring->mask; i++)                                                    // at most one ring's worth per pass
+    {
+        lqcSendSlot_t *slot = &ring->slots[ring->dequeuePos & ring->mask];
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if ((int32_t)(seq - (ring->dequeuePos + 1)) < 0)
+            return;                                                                             // empty (or producer still copying)
+
+        S__trySendDirect(slot->lqc, slot->topic, slot->body, slot->timeoutSeconds);
+        __atomic_store_n(&slot->seq, ring->dequeuePos + ring->mask + 1, __ATOMIC_RELEASE);      // free for producer one lap ahead
+        ring->dequeuePos++;
+    }
+    #endif
+}
+
+
+/**
+ *	@brief Producer: claim a slot (compare-and-swap on the enqueue position), copy the message in and publish it.
+ */
+static lqcSendResult_t S__enqueueSendRing(lqCloudDevice_t *lqc, const char *topic, const char *body, uint8_t timeoutSeconds)
+{
+    #ifdef LQC_THREADSAFE
+    lqcSendRing_t *ring = &S__sendRing;
+    uint16_t topicSz = strlen(topic);
+    uint16_t bodySz = strlen(body);
+    lqcSendSlot_t *slot;
+
+    if (topicSz >= LQC__sendSlot_topicSz || bodySz >= LQC__sendSlot_bodySz)
+    {
+        LQC_ATOMIC_INC(ring->fullCnt);
+        return lqcSendResult_dropped;
+    }
+
+    uint32_t pos = __atomic_load_n(&ring->enqueuePos, __ATOMIC_RELAXED);
+    while (true)
+    {
+        slot = &ring->slots[pos & ring->mask];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;                                                                          // slot claimed (pos updated on fail)
+        }
+        else if (diff < 0)
+        {
+            LQC_ATOMIC_INC(ring->fullCnt);                                                      // worker a lap behind, ring full
+            return lqcSendResult_dropped;
+        }
+        else
+            pos = __atomic_load_n(&ring->enqueuePos, __ATOMIC_RELAXED);                         // another producer claimed it
+    }
+
+    slot->lqc = lqc;
+    slot->timeoutSeconds = timeoutSeconds;
+    memcpy(slot->topic, topic, topicSz + 1);
+    memcpy(slot->body, body, bodySz + 1);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);                                    // publish to worker
+    LQC_signalWakeup();
+    return lqcSendResult_queued;
+    #else
+    return lqcSendResult_dropped;
+    #endif
+}
+
+/**
+ *	@brief Network worker: a published slot is waiting at the dequeue position.
+ */
+static bool S__sendRingPending()
+{
+    #ifdef LQC_THREADSAFE
+    lqcSendRing_t *ring = &S__sendRing;
+
+    if (ring->slots == NULL)
+        return false;
+    uint32_t seq = __atomic_load_n(&ring->slots[ring->dequeuePos & ring->mask].seq, __ATOMIC_ACQUIRE);
+    return (int32_t)(seq - (ring->dequeuePos + 1)) >= 0;
+    #else
+    return false;
+    #endif
+}
+
+#pragma endregion
+
+
+
+#pragma region  Next wakeup (tickless sleep, event loop integration)
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ *	@brief Get the time until lqc_doWork() next has work, the minimum across the library's timers and queues.
+ *  @return Millis until next work, 0 = now, LQC_WAKEUP_NONE if no timer pending.
+ */
+uint32_t lqc_nextWakeupMs()
+{
+    uint32_t wakeup = MIN(LQC_actionsNextWakeup(&g_lqCloud), LQC_schedulerNextWakeup());
+    wakeup = MIN(wakeup, LQC_transferNextWakeup());
+
+    if (LQC_isrEventsPending())
+        return 0;
+    if (g_lqCloud.bootPending)                                                                  // boot message retry, as tested in lqcInst_doWork()
+        wakeup = MIN(wakeup, LQC_millisUntil(g_lqCloud.deviceStateChangeAt, S__bootRetryMillis(&g_lqCloud)));
+
+    if (LQC_workerRunning())                                                                    // network timers are the worker's
+        return LQC_workerCompletionsPending() ? 0 : wakeup;
+
+    if (S__sendRingPending() || (g_lqCloud.isOnline && LQC_gatewaySendPending()))
+        return 0;
+    wakeup = MIN(wakeup, LQC_connectNextWakeup());
+    wakeup = MIN(wakeup, LQC_dataPumpNextWakeup());
+    return wakeup;
+}
+
+
+/**
+ *	@brief Linux hosts: eventfd signaled when work is queued outside lqc_doWork(), created on first call.
+ *  @return File descriptor, -1 if not supported.
+ */
+int lqc_getWakeupFd()
+{
+    #ifdef __linux__
+    if (S__wakeupFd < 0)
+        S__wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return S__wakeupFd;
+    #else
+    return -1;
+    #endif
+}
+
+
+/**
+ *	@brief Millis remaining in a period started at startAt, 0 if elapsed (rollover safe).
+ */
+uint32_t LQC_millisUntil(uint32_t startAt, uint32_t periodMillis)
+{
+    uint32_t elapsed = pMillis() - startAt;
+    return (elapsed >= periodMillis) ? 0 : periodMillis - elapsed;
+}
+
+
+/**
+ *	@brief Signal the wakeup eventfd (if created), work was queued by a thread, receive path or ISR.
+ */
+void LQC_signalWakeup()
+{
+    #ifdef __linux__
+    if (S__wakeupFd >= 0)
+    {
+        uint64_t signal = 1;
+        (void)!write(S__wakeupFd, &signal, sizeof(signal));                                     // EAGAIN at counter max is harmless, fd already readable
+    }
+    #endif
+}
+
 
-    return cbResult == resultCode__success ;
+static void S__clearWakeup()
+{
+    #ifdef __linux__
+    if (S__wakeupFd >= 0)
+    {
+        uint64_t signalCnt;
+        (void)!read(S__wakeupFd, &signalCnt, sizeof(signalCnt));
+    }
+    #endif
 }
 
+#pragma endregion
+
 
 
 #pragma region  LQ Cloud internal functions
@@ -370,9 +801,35 @@ lqcSendResult_t LQC_trySend(const char *topic, const char *body, bool queueOnFai
 /**
  *	@brief Pass event notification up-the-stack, optionally process them.
  */
-void LQC_invokeAppEventCBRequest(const char *eventTag, const char *eventMsg)
+void LQC_invokeAppEventCBRequest(lqCloudDevice_t *lqc, const char *eventTag, const char *eventMsg)
+{
+    if (LQC_onWorkerThread())
+    {
+        LQC_postCompletion(lqc, eventTag, eventMsg);                        // worker mode: delivered on the application thread
+        return;
+    }
+    lqc->applEvntNotifyCB(eventTag, eventMsg);
+}
+
+
+/**
+ *	@brief Request information from the application by event, the application answers with lqc_setEventResponse().
+ *
+ *  One exchange at a time: a request made while another thread's exchange is in progress (or from the network worker,
+ *  where the callback is not invoked) is not made, the caller goes without the information.
+ *  @return False if the request was not made.
+ */
+bool LQC_requestAppEventResponse(lqCloudDevice_t *lqc, const char *eventTag, appEventResponse_t *response)
 {
-    g_lqCloud.applEvntNotifyCB(eventTag, eventMsg);
+    memset(response, 0, sizeof(appEventResponse_t));
+    if (LQC_onWorkerThread() || !LQC_TRYLOCK(S__eventRspBusy))
+        return false;
+
+    S__eventRsp = response;
+    lqc->applEvntNotifyCB(eventTag, "");
+    S__eventRsp = NULL;
+    LQC_TRYUNLOCK(S__eventRspBusy);
+    return true;
 }
 
 
@@ -484,6 +941,31 @@ void LQC_faultHandler(const char *faultMsg)
 #pragma region  Local static (private) functions
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ *	@brief Initialize an LQCloud instance, shared by lqc_create() (default instance) and lqc_createInstance().
+ */
+static void S__initInstance(lqCloudDevice_t *lqc, lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *deviceKey)
+{
+    ASSERT(sendMessageCB != NULL);
+    ASSERT(deviceConfig != NULL);
+    ASSERT(strlen(deviceKey) > 0);
+    ASSERT(strlen(deviceKey) <= lqc__identity_deviceKeySz);
+
+    lqc->deviceType = deviceType;
+    lqc->sendMessageCB = sendMessageCB;
+    lqc->applEvntNotifyCB = applEvntNotifyCB;
+    lqc->applInfoRequestCB = applInfoRequestCB;
+    lqc->yieldCB = yieldCB;
+    lqc->deviceCnfg = deviceConfig;
+
+    strncpy(lqc->deviceKey, deviceKey, lqc__identity_deviceKeySz);
+    lqc->actnQueue.dispatchBudget = LQC__actionDispatchBudget;
+    lqc->actnCurrent = -1;
+    lqc->connectInfo.connectMode = lqcConnect_mqttContinuous;
+    LQC_initRecentActions(lqc, &lqc->actnRecentLocal);
+}
+
+
 /**
  *	@brief  Background retry queue message sender.
  */
@@ -521,32 +1003,23 @@ void LQC_faultHandler(const char *faultMsg)
  */
 void lqc_receiveMsg(char *message, uint16_t messageSz, const char *props)
 {
-    // uint16_t msgId = 99;
-    // char *topicProps = "";
-   //S__cloudReceiver(msgId, topicProps, message, messageSz, props);
-
-
-    keyValueDict_t propsDict = lq_createQryStrDictionary(props, strlen(props));
-
-    #ifdef _DEBUG
-    PRINTF(dbgColor__info, "\r**MQTT--MSG** \tick=%d\r", pMillis());
-    PRINTF(dbgColor__cyan, "\rt(%d): %s", strlen(props), props);
-    PRINTF(dbgColor__cyan, "\rm(%d): %s", strlen(message), message);
-    PRINTF(dbgColor__info, "\rProps(%d)\r", propsDict.count);
-    for (size_t i = 0; i < propsDict.count; i++)
-    {
-        PRINTF(dbgColor__cyan, "%s=%s\r", propsDict.keys[i], propsDict.values[i]);
-    }
-    PRINTF(0, "\r");
-    #endif
+    lqcInst_receiveMsg(&g_lqCloud, message, messageSz, props);
+}
 
-    lq_getQryStrDictionaryValue("$.mid", propsDict, g_lqCloud.actnMsgId, LQC__messageIdSz);
-    lq_getQryStrDictionaryValue("evN", propsDict, g_lqCloud.actnName, LQC__action_nameSz);
-    // strcpy(g_lqCloud.actnMsgId, lqc_getDictValue("$.mid", mqttProps));
-    // strcpy(g_lqCloud.actnName, lqc_getDictValue("evN", mqttProps));
-    g_lqCloud.actnResult = resultCode__notFound;
-    LQC_processIncomingActionRequest(g_lqCloud.actnName, propsDict, message);
 
+/**
+ *	@brief Receive a cloud message for a specific instance, from that instance's transport receive callback.
+ */
+void lqcInst_receiveMsg(lqcHandle_t lqc, char *message, uint16_t messageSz, const char *props)
+{
+    /* Receive runs in the transport's receive callback: copy and queue only, the action is 
+     * performed (and responded to) from lqc_doWork(). Chunked transfer fragments are handed 
+     * straight to the transfer sink, they are acked from lqc_doWork(). On the network worker 
+     * fragments are queued with the action requests, the sink runs on the application thread. */
+    lqc->connectInfo.odc_activityAt = pMillis();                            // on-demand connection held open while C2D traffic
+    if (lqc == &g_lqCloud && !LQC_onWorkerThread() && LQC_receiveTransferChunk(message, messageSz, props))
+        return;
+    LQC_enqueueActionRequest(lqc, message, messageSz, props);
 }
 
 // /**
@@ -34,6 +34,7 @@
 
 #include <ltemc.h>              // *** TODO remove these dependencies ***
 #include <ltemc-mqtt.h>         // ***
+#include <ltemc-http.h>         // ***
 #include <lqc-ntwk.h>
 //#include <lqc-proto.h>
 
@@ -64,13 +65,63 @@ enum lqcloud_constants
     lqc__connection_onDemand_connDurationSecs = 120,        /// period in seconds an on-demand connection stays open 
     lqc__connection_continous_retryIntrvlSecs = 60,         /// period in seconds between connection attemps
     LQC__connection_retryIntervalSecs = 60,
+    LQC__connect_providerTimeoutSecs = 120,                 /// connection manager: wait for cellular provider
+    LQC__connect_networkTimeoutSecs = 60,                   /// connection manager: wait for PDP network activation
+    LQC__connect_messagingTimeoutSecs = 45,                 /// connection manager: MQTT open/connect/subscribe to complete (stall detection)
+    LQC__connect_stepIntervalMillis = 2000,                 /// connection manager: min interval between connection step attempts
+    LQC__connect_onDemandHoldSecs = 30,                     /// on-demand: default time connection is held open after last activity (for C2D)
+    LQC__connect_windowFaultCnt = 3,                        /// on-demand: connection faults in a window before it is closed (radio to sleep) until the next
+    LQC__connect_linkCheckSecs = 60,                        /// connection manager: interval between MQTT status polls while ready (receive-only devices)
+
+    LQC__transport_failoverAfterDefault = 3,                /// HTTP fallback: consecutive MQTT failures (send or connect) before D2C switches to HTTPS
+    LQC__transport_probeIntervalSecs = 300,                 /// HTTP fallback: interval between background MQTT reconnect attempts
+    LQC__dataPump_c2dPollMax = 4,                           /// sensor: C2D messages (action requests) fetched after each batch
+
+    LQC__coap_blockSzx = 4,                                 /// CoAP block-wise size exponent, block = 16 << szx (4 = 256 bytes)
+    LQC__coap_ackTimeoutMillis = 2000,                      /// CoAP confirmable: initial retransmit timeout (doubles each retransmit)
+    LQC__coap_maxRetransmit = 4,                            /// CoAP confirmable: retransmits before exchange fails
+
+    LQC__gateway_childVisitCnt = 32,                        /// gateway: children serviced (actions, send turn) per lqc_doWork() pass
+    LQC__gateway_sendBudget = 8,                            /// gateway: child messages sent upstream per lqc_doWork() pass
+
+    LQC__isrEventCnt = 16,                                  /// ISR event ring: records held for lqc_doWork() expansion (power of 2, max 128)
+    LQC__isrEvent_valueCnt = 3,                             /// ISR event record: numeric values captured with each event
+    LQC__isrEventDefCnt = 8,                                /// ISR event definitions (event IDs registered)
+    LQC__isrEvent_expandBudget = 2,                         /// ISR event records expanded (sent) per lqc_doWork() pass
+
+    LQC__sendSlot_topicSz = 240,                            /// thread-safe send: topic capacity of a send slot (incl NULL)
+    LQC__sendSlot_bodySz = 512,                             /// thread-safe send: body capacity of a send slot (incl NULL), larger messages are dropped
+
+    LQC__schedulerTimerCnt = 16,                            /// scheduler: timers running at once (heap capacity)
+    LQC__scheduler_alignMillis = 1000,                      /// scheduler: periodic timers due within this window fire together (one wakeup)
+
+    LQC__worker_passIntervalMillis = 10,                    /// worker mode: network worker wait between passes
+    LQC__worker_completionCnt = 8,                          /// worker mode: event notifications held for delivery on the application thread
+
+    LQC__sas_tokenTtlSecs = 86400,                          /// SAS renewal: default lifetime of tokens generated from the device key
+    LQC__sas_renewAheadSecs = 3600,                         /// SAS renewal: token regenerated this long before it expires
 
     LQC__send_resetAtConsecutiveFailures = 2,
 
     LQC__actionCnt = 12,                                    /// number of application actions, change to needs (lower to save memory)
     LQC__action_MsgIdSz =  37,                              /// size of message Id field (incl NULL)
     LQC__action_nameSz = 17,                                /// Max length of an action name (incl NULL)
-    LQC__action_paramsListSz = 40                           /// Max length of an action parameter list, LQ Cloud registered parameter names/types
+    LQC__action_paramsListSz = 40,                          /// Max length of an action parameter list, LQ Cloud registered parameter names/types
+    LQC__actionInfoSz = 208 + LQC__actionCnt * (14 + LQC__action_nameSz + LQC__action_paramsListSz),  /// getactn catalogue cache size (lqc_setActionInfoCache())
+
+    LQC__actionQueueCnt = 4,                                /// max number of inbound action requests held for lqc_doWork() dispatch
+    LQC__actionQueue_bufferSz = (lqc__msg_bodySz + mqtt__topic_bufferSz + 12),  /// packed request storage: one max size request (body, props, header) or several smaller
+    LQC__actionRejectCnt = 4,                               /// number of pending automatic (rejected request) responses
+    LQC__actionDispatchBudget = 1,                          /// default actions dispatched per lqc_doWork() pass
+    LQC__actionPendingCnt = 4,                              /// number of actions that can be in-flight (awaiting their response) at once
+    LQC__action_defaultTimeoutSecs = 30,                    /// deferred action response timeout, if not specified by application
+    LQC__actionRecentCnt = 16,                              /// recently performed action requests remembered for duplicate suppression (> queue + pending)
+    LQC__actionStat_histBins = 6,                           /// action execution time histogram: <10, <50, <100, <500, <1000, >=1000 millis
+
+    LQC__transfer_idSz = 17,                                /// max length of chunked transfer ID (incl NULL)
+    LQC__transfer_nameSz = 17,                              /// max length of chunked transfer name (incl NULL)
+    LQC__transfer_windowDefault = 4,                        /// chunks received between acks, if not specified by cloud
+    LQC__transfer_timeoutSecs = 60                          /// transfer aborted if next chunk not received within
 };
 
 
@@ -230,14 +281,41 @@ typedef enum lqcSendQoS_tag
 } lqcSendQoS_t;
 
 
-// typedef enum lqcConnect_tag
-// {
-//     lqcConnect_mqttDetached = 0,            /// device is send only using HTTP and not connected to LQCloud
-//     lqcConnect_mqttOnDemand = 1,            /// device stays offline most of the time and connects to send or at prescribed intervals 
-//     lqcConnect_mqttContinuous = 2,          /// device is connected all of the time, but will not block local processing if offline
-//     lqcConnect_httpSensor = 3,
-//     lqcConnect__invalid
-// } lqcConnect_t;
+typedef enum lqcConnect_tag
+{
+    lqcConnect_mqttDetached = 0,            /// device is send only using HTTP and not connected to LQCloud
+    lqcConnect_mqttOnDemand = 1,            /// device stays offline most of the time and connects to send or at prescribed intervals 
+    lqcConnect_mqttContinuous = 2,          /// device is connected all of the time, but will not block local processing if offline
+    lqcConnect_httpSensor = 3,
+    lqcConnect__invalid
+} lqcConnect_t;
+
+
+/** 
+ *  @brief Power save requests to the application (see lqc_registerPowerSaveCallback()).
+*/
+typedef enum lqcPowerSave_tag
+{
+    lqcPowerSave_wake = 0,                  /// LQCloud is opening a connection, exit power save (PSM/eDRX/sleep)
+    lqcPowerSave_sleep = 1                  /// LQCloud closed the on-demand connection, radio can enter power save
+} lqcPowerSave_t;
+
+typedef void (*lqcPowerSave_func)(lqcPowerSave_t powerSaveRqst);
+
+/** 
+ *  @brief Application time source for SAS token expiry: Unix time in seconds (RTC, modem network time), 0 if not yet known.
+*/
+typedef uint32_t (*lqcEpochTime_func)();
+
+
+/** 
+ *  @brief Message an ISR event record is expanded into (see lqc_registerIsrEvent()).
+*/
+typedef enum lqcIsrEventType_tag
+{
+    lqcIsrEventType_telemetry = 0,
+    lqcIsrEventType_alert = 1
+} lqcIsrEventType_t;
 
 
 typedef enum lqcConnectState_tag                
@@ -356,6 +434,107 @@ typedef struct lqcEpoch_tag
 */
 typedef void (*lqcAction_func)(keyValueDict_t params);
 
+/** 
+ *  @brief Handle to an in-flight action, used to complete (respond to) an action after the action function has returned.
+ *  A handle value of LQC_ACTIONHANDLE_INVALID indicates no action (or the action has already completed or timed out).
+*/
+typedef uint16_t lqcActionHandle_t;
+#define LQC_ACTIONHANDLE_INVALID 0
+
+/** 
+ *  @brief Recent action request cache, suppresses re-execution of an action redelivered by the cloud (QoS1 redelivery).
+ *  Requests are keyed by a hash of the request's $.mid, held in a FIFO ring of the last LQC__actionRecentCnt requests;
+ *  entries still in progress (queued or in-flight) are never replaced. LQCloud keeps an instance internally, the application can supply one
+ *  in memory not initialized at reset (.noinit) to have the cache survive a device reset (see lqc_enableRecentActionsCache()).
+*/
+typedef struct lqcRecentActions_tag
+{
+    uint32_t magic;                                         /// validates content surviving a reset
+    uint32_t midHash[LQC__actionRecentCnt];                 /// hash of request $.mid, 0 = empty
+    uint16_t resultCode[LQC__actionRecentCnt];              /// action response result code, 0 = in progress (no response yet)
+    uint8_t next;                                           /// ring position of next entry (oldest)
+} lqcRecentActions_t;
+
+/** 
+ *  @brief Chunked C2D transfer events, delivered to the application transfer sink.
+*/
+typedef enum lqcTransferEvent_tag
+{
+    lqcTransferEvent_begin = 0,             /// new transfer, dataSz = total payload length; sink returns false to refuse
+    lqcTransferEvent_data,                  /// next in-order fragment, at offset (streaming mode, no arena)
+    lqcTransferEvent_complete,              /// all fragments received and CRC verified; arena mode: data = arena, dataSz = total length
+    lqcTransferEvent_abort                  /// transfer failed (CRC, size, timeout, superseded), discard partial content
+} lqcTransferEvent_t;
+
+/** 
+ *  @brief Application sink for chunked C2D transfers (payloads larger than the transport receive buffer).
+ *  Invoked on the application thread: from the transport receive callback, or from lqc_doWork() in worker mode (fragments
+ *  are queued with action requests, see lqc_setActionQueue()). Should only store/copy the data. Return false to abort the transfer.
+*/
+typedef bool (*lqcTransferSink_func)(lqcTransferEvent_t event, const char *xferName, uint32_t offset, const uint8_t *data, uint16_t dataSz);
+
+/** 
+ *  @brief Handle to an LQCloud instance (device identity with its own actions, queues and metrics), see lqc_createInstance().
+ *  The lqc_* functions operate on the default instance, lqcInst_* functions take the instance handle.
+*/
+typedef struct lqCloudDevice_tag *lqcHandle_t;
+
+/** 
+ *  @brief Scheduler timer callback, invoked from lqc_doWork() when the timer is due.
+*/
+typedef void (*lqcTimer_func)(void *userData);
+
+/** 
+ *  @brief Scheduler timer, application owned (static), see lqc_timerInit().
+*/
+typedef struct lqcTimer_tag
+{
+    uint32_t dueAt;                                         /// millis the timer fires
+    uint32_t periodMillis;                                  /// 0 = one-shot
+    lqcTimer_func timerCB;
+    void *userData;
+    uint8_t heapIndx;                                       /// position in scheduler, LQC__schedulerTimerCnt = not running
+} lqcTimer_t;
+
+/** 
+ *  @brief lqc_nextWakeupMs() result when no timer is pending, only an external event (receive, send, ISR) creates work.
+*/
+#define LQC_WAKEUP_NONE 0xFFFFFFFF
+
+/** 
+ *  @brief Thread-safe send slot, the application supplies the slots (see lqc_enableThreadSafeSend()).
+*/
+typedef struct lqcSendSlot_tag
+{
+    uint32_t seq;                                           /// ring sequence, slot is free to the producer at seq == position
+    lqcHandle_t lqc;                                        /// sending instance
+    uint8_t timeoutSeconds;
+    char topic[LQC__sendSlot_topicSz];
+    char body[LQC__sendSlot_bodySz];
+} lqcSendSlot_t;
+
+/** 
+ *  @brief Platform thread and mutex hooks for worker mode (see lqc_enableWorkerThread()), pthreads or RTOS tasks.
+*/
+typedef struct lqcPlatformHooks_tag
+{
+    bool (*createThread)(void (*threadFunc)(void *arg), void *arg);     /// start the network worker thread/task
+    void *(*currentThread)();                                           /// handle of the calling thread/task: (void *)pthread_self(), xTaskGetCurrentTaskHandle()
+    void *(*createMutex)();
+    void (*lockMutex)(void *mutex);
+    void (*unlockMutex)(void *mutex);
+    void (*sleepMillis)(uint32_t millis);                               /// network worker wait between passes
+} lqcPlatformHooks_t;
+
+/** 
+ *  @brief Gateway mode child registry entry, the application supplies the table (see lqc_enableGateway()).
+*/
+typedef struct lqcGatewayChild_tag
+{
+    uint32_t idHash;                                        /// hash of child device ID, 0 = empty entry
+    lqcHandle_t lqc;                                        /// child instance
+} lqcGatewayChild_t;
+
 /**
  * @brief Data received from LQCloud
  * 
@@ -374,18 +553,88 @@ extern "C"
 // void lqc_create(void *protoCtrl, lqcStartNetwork_func startNetworkCB, appEventCallback_func appEventCB, yield_func yieldCB, char *validationKey);
 void lqc_create(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *validationKey);
 
+/**
+ *  \brief Create an additional LQCloud instance, parameters as lqc_create().
+ *  \details Instances send with their own sendMessageCB and are serviced by lqcInst_doWork(). The connection manager, 
+ *  HTTP fallback, data pump and CoAP transport serve only the default instance.
+ *  \return Instance handle, NULL if allocation failed.
+ */
+lqcHandle_t lqc_createInstance(lqcDeviceType_t deviceType, lqcDeviceConfig_t *deviceConfig, lqcSendMessage_func sendMessageCB, applEvntNotify_func applEvntNotifyCB, applInfoRequest_func applInfoRequestCB, yield_func yieldCB, char *validationKey);
+void lqc_destroyInstance(lqcHandle_t lqc);
+lqcHandle_t lqc_getDefaultInstance();
+
+void lqcInst_doWork(lqcHandle_t lqc);
+void lqcInst_receiveMsg(lqcHandle_t lqc, char *message, uint16_t messageSz, const char *props);
+lqcSendResult_t lqcInst_sendTelemetry(lqcHandle_t lqc, const char *evntName, const char *evntSummary, const char *bodyJson);
+lqcSendResult_t lqcInst_sendAlert(lqcHandle_t lqc, const char *alrtName, const char *alrtSummary, const char *bodyJson);
+bool lqcInst_registerApplicationAction(lqcHandle_t lqc, const char *actnName, lqcAction_func applActionCB, const char *paramList);
+bool lqcInst_setActionBudget(lqcHandle_t lqc, const char *actnName, uint16_t budgetMillis);
+void lqcInst_setActionQueue(lqcHandle_t lqc, char *queueBuffer, uint16_t bufferSz);
+bool lqcInst_setActionInfoCache(lqcHandle_t lqc, char *cacheBuffer, uint16_t bufferSz);
+bool lqcInst_completeAction(lqcHandle_t lqc, lqcActionHandle_t actnHandle, uint16_t resultCode, const char *bodyJson);
+void lqcInst_reportCommMetrics(lqcHandle_t lqc);
+
 void lqc_setDeviceLabel(const char *label);
 void lqc_setDeviceKey(const char *key);
 void lqc_enableDiagnostics(diagnosticInfo_t *diagnosticsInfoBlock);
 
+/**
+ *  \brief Use an application supplied recent action cache, typically placed in memory not initialized at reset (.noinit).
+ *  \param [in] recentActions Cache block; if its content is not valid (cold start) it is initialized.
+ */
+void lqc_enableRecentActionsCache(lqcRecentActions_t *recentActions);
+
 void lqc_start(uint8_t resetCause);
 
+/**
+ *  \brief Query for connectivity to the LQCloud.
+ *  \return True if connected; with connection manager enabled, when messaging is ready (connected and subscribed).
+ */
 bool lqc_isOnline();
 
+/**
+ *  \brief LQCloud manages the cloud connection (connect/reconnect) from lqc_doWork(), one connection step per pass.
+ *  \details Sends made while connecting are only kept if a send queue is supplied (lqc_setSendQueue()), otherwise they 
+ *  are dropped. On-demand mode depends on the queue, messages wait there for the next window.
+ *  \param [in] mqttCtrl MQTT control for the LQCloud connection, initialized by the application (mqtt_initControl).
+ *  \param [in] pdpContextId Packet network (PDP) context for the connection.
+ */
+void lqc_enableConnectionManager(mqttCtrl_t *mqttCtrl, uint8_t pdpContextId);
+
+/**
+ *  \brief Get the cloud connection state (connection manager).
+ */
+lqcConnectState_t lqc_getConnectState();
+
+/**
+ *  \brief Get the time in millis the connection has been in its current state (connection manager).
+ */
+uint32_t lqc_getConnectStateDuration();
+
 void lqc_receiveMsg(char *message, uint16_t messageSz, const char *props);
 void lqc_setEventResponse(uint8_t requestEvent, uint16_t result, const char *response);
 void lqc_doWork();
 
+/**
+ *  \brief Set the number of queued action requests (and automatic responses) serviced by each lqc_doWork() pass.
+ *  \param [in] actionsPerPass Dispatch budget, 0 restores the default (LQC__actionDispatchBudget).
+ */
+void lqc_setActionDispatchBudget(uint8_t actionsPerPass);
+
+/**
+ *  \brief Supply the buffer holding received action requests for dispatch from lqc_doWork() (required for worker mode).
+ *  \details Without it actions are performed in the transport's receive callback.
+ *  \param [in] queueBuffer Application buffer, LQC__actionQueue_bufferSz holds one maximum size request.
+ *  \param [in] bufferSz Size of the buffer.
+ */
+void lqc_setActionQueue(char *queueBuffer, uint16_t bufferSz);
+
+/**
+ *  \brief Supply a buffer (LQC__actionInfoSz) caching the getactn catalogue, otherwise it is built on the stack per request.
+ *  \return False if the buffer is smaller than LQC__actionInfoSz.
+ */
+bool lqc_setActionInfoCache(char *cacheBuffer, uint16_t bufferSz);
+
 lqcSendResult_t lqc_sendTelemetry(const char *evntName, const char *evntSummary, const char *bodyJson);
 lqcSendResult_t lqc_sendAlert(const char *alrtName, const char *alrtSummary, const char *bodyJson);
 
@@ -393,10 +642,43 @@ lqcSendResult_t lqc_diagnosticsCheck(diagnosticInfo_t *diagInfo);
 
 bool lqc_registerApplicationAction(const char *actnName, lqcAction_func applActionCB, const char *paramList);
 
+/**
+ *  \brief Set an execution time budget for an application action, an action function exceeding it raises a warning 
+ *  event ("ACTNBUDGET") to the application notification callback. Execution statistics are reported by the built-in getactstat action.
+ *  \param [in] actnName Registered action name.
+ *  \param [in] budgetMillis Execution time allowed the action function (millis), 0 = no budget.
+ *  \return True if action found.
+ */
+bool lqc_setActionBudget(const char *actnName, uint16_t budgetMillis);
+
 void LQC_sendActionResponse(uint16_t resultCode, lqcEventClass_t eventClass, const char *bodyJson);
 
 void lqc_sendActionResponse(uint16_t resultCode, const char *bodyJson);
 
+/**
+ *  \brief Invoked from within an action function, defers the response for the action until lqc_completeAction().
+ *  \param [in] timeoutSecs Seconds the action may run, at timeout LQCloud responds with a timeout result (0 = default).
+ *  \return Handle to the action for lqc_completeAction(), LQC_ACTIONHANDLE_INVALID if not invoked from an action.
+ */
+lqcActionHandle_t lqc_deferActionResponse(uint16_t timeoutSecs);
+
+/**
+ *  \brief Complete a deferred action, sending its result (response) to LQCloud.
+ *  \param [in] actnHandle Handle obtained from lqc_deferActionResponse().
+ *  \param [in] resultCode HTTP style status result, 200 is success, etc.
+ *  \param [in] bodyJson Response body (JSON), can be empty.
+ *  \return True if response sent; false if handle is not valid (action already completed or timed out).
+ */
+bool lqc_completeAction(lqcActionHandle_t actnHandle, uint16_t resultCode, const char *bodyJson);
+
+/**
+ *  \brief Enable chunked C2D transfers. Fragments are streamed to the sink or, if an arena is supplied, reassembled into it.
+ *  \param [in] transferSinkCB Application transfer sink, receives transfer events.
+ *  \param [in] arena Reassembly buffer (optional), NULL to stream fragments to the sink as received.
+ *  \param [in] arenaSz Size of the arena, transfers larger than arena are refused.
+ */
+void lqc_registerTransferSink(lqcTransferSink_func transferSinkCB, uint8_t *arena, uint32_t arenaSz);
+
 char *lqc_getDeviceId();
 char *lqc_getDeviceLabel();
 uint8_t lqc_getProtoState();
@@ -412,11 +694,185 @@ void lqc_composeIothUserId(char *userId, uint8_t uidSz, const char* hostUrl, con
 void lqc_composeIothSasToken(char *sasToken, uint8_t sasSz, const char* hostUrl, const char *deviceId, const char* signature);
 void lqc_setDeviceConfigFromSASToken(const char* sasToken, lqcDeviceConfig_t *deviceConfig);
 
+/**
+ *  \brief Generate an IoT Hub SAS token signed (HMAC-SHA256) with the device key.
+ *  \param [in] key Device key, decoded (binary) form of the base64 key from IoT Hub.
+ *  \param [in] expiry Token expiry, Unix time in seconds.
+ *  \return True if token fits in sasSz.
+ */
+bool lqc_generateIothSasToken(char *sasToken, uint16_t sasSz, const char* hostUrl, const char *deviceId, const uint8_t *key, uint8_t keySz, uint32_t expiry);
+
+/**
+ *  \brief Enable SAS token expiry tracking and, with a device key, local token generation and renewal ahead of expiry.
+ *  \param [in] deviceSasKey Base64 device key (IoT Hub symmetric key), NULL to track the expiry of the configured signature only.
+ *  \param [in] epochTimeCB Application time source (Unix seconds).
+ *  \param [in] tokenTtlSecs Lifetime of generated tokens, 0 for default (LQC__sas_tokenTtlSecs).
+ *  \return False if the device key is not valid base64 or too long.
+ */
+bool lqc_enableSasTokenRenewal(const char *deviceSasKey, lqcEpochTime_func epochTimeCB, uint32_t tokenTtlSecs);
+
+/**
+ *  \brief Expiry (se=) of the current SAS token, Unix time in seconds. 0 if not known.
+ */
+uint32_t lqc_getSasTokenExpiry();
+
 /** 
  *  \brief Register a callback to change communications device power profile. Enter/exit sleep/PSM/eDRX/etc.
- *  \param [in] powerSaveCB Enum specifying the LTE LPWAN protocol(s) to scan; 0=LTE M1,1=LTE NB1,2=LTE M1 and NB1
+ *  \param [in] powerSaveCB Application function, invoked with lqcPowerSave_wake before an on-demand connection opens and
+ *  lqcPowerSave_sleep after it closes.
+ */
+void lqc_registerPowerSaveCallback(lqcPowerSave_func powerSaveCB);
+
+/**
+ *  \brief Sets connection mode for the managed cloud connection. Default is continuous.
+ *  \param [in] connectMode lqcConnect_mqttContinuous or lqcConnect_mqttOnDemand.
+ *  \param [in] interConnectSecs On-demand: seconds between scheduled connection windows (0 = only when urgent, alerts). 
+ *  A window that faults LQC__connect_windowFaultCnt times is closed, the next window (or urgent send) retries.
+ *  \param [in] holdConnectSecs On-demand: seconds the connection is held open after last activity, for C2D (0 = default).
+ */
+void lqc_setConnectMode(lqcConnect_t connectMode, uint32_t interConnectSecs, uint16_t holdConnectSecs);
+
+/**
+ *  \brief Connect with a persistent MQTT session (clean-session false); C2D queued by the broker is delivered at reconnect.
+ *  \details QoS1 C2D messages sent while disconnected are delivered by the broker on resume.
+ *  \param [in] enable True to resume sessions, false (default) connects with a clean session and subscribes every time.
+ */
+void lqc_enableSessionResume(bool enable);
+
+/**
+ *  \brief Enable HTTPS POST as fallback transport for D2C messages when MQTT cannot be held (blocked port, poor carrier).
+ *  \details Message properties are sent as iothub-app-* headers. MQTT is probed in the background and D2C returns to it when connected.
+ *  \param [in] httpCtrl HTTP control initialized by the application (http_initControl), on a data context not used by MQTT.
+ *  \param [in] failoverAfter Consecutive MQTT failures before switching to HTTPS (0 = default).
+ */
+void lqc_enableHttpFallback(httpCtrl_t *httpCtrl, uint8_t failoverAfter);
+
+/**
+ *  \brief Get the transport currently carrying D2C messages.
+ *  \return lqcMessagingProto_mqtt or lqcMessagingProto_http (fallback active).
+ */
+lqcMessagingProto_t lqc_getActiveTransport();
+
+/**
+ *  \brief Sensor (lqcDeviceType_sensor) data pump: telemetry and alerts are batched and sent by one HTTPS POST per interval, no MQTT session.
+ *  \details After each batch pending C2D action requests are fetched. Action responses are sent at the next lqc_doWork() pass.
+ *  \param [in] httpCtrl HTTP control initialized by the application (http_initControl) with lqc_receiveHttp() as receive callback.
+ *  \param [in] batchBuffer Application buffer, messages accumulate here between posts (also receives C2D after post).
+ *  \param [in] batchBufferSz Size of the buffer.
+ *  \param [in] batchIntervalSecs Seconds between batch posts.
+ */
+void lqc_enableDataPump(httpCtrl_t *httpCtrl, char *batchBuffer, uint16_t batchBufferSz, uint32_t batchIntervalSecs);
+
+/**
+ *  \brief Data pump HTTP receive callback, pass to http_initControl() for the data pump httpCtrl.
+ */
+void lqc_receiveHttp(dataCntxt_t dataCntxt, uint16_t httpStatus, char *recvData, uint16_t dataSz);
+
+/**
+ *  \brief Define how records for an ISR event ID are expanded into alerts or telemetry by lqc_doWork().
+ *  \param [in] eventId Application event ID, recorded by lqc_isrRecordEvent().
+ *  \param [in] eventType Send record as telemetry or alert.
+ *  \param [in] evntName Telemetry/alert name.
+ *  \param [in] valueNames Comma separated JSON property names for the recorded values ("count,pin"), NULL for a "v" array.
+ *  \return False if no definition slots remain.
+ */
+bool lqc_registerIsrEvent(uint8_t eventId, lqcIsrEventType_t eventType, const char *evntName, const char *valueNames);
+
+/**
+ *  \brief Record an event from interrupt context: wait-free, no blocking or allocation. The record is sent from lqc_doWork().
+ *  \details Single producer: record from ISRs of one priority (or with nesting disabled) only.
+ *  \return False if the ring is full, the event is counted as dropped.
+ */
+bool lqc_isrRecordEvent(uint8_t eventId, int32_t value0, int32_t value1, int32_t value2);
+
+/**
+ *  \brief Initialize a scheduler timer (not running), the timer object must remain valid while running.
+ *  \param [in] timer Application timer object.
+ *  \param [in] timerCB Function invoked from lqc_doWork() when due.
+ *  \param [in] userData Passed to timerCB.
+ */
+void lqc_timerInit(lqcTimer_t *timer, lqcTimer_func timerCB, void *userData);
+
+/**
+ *  \brief Start (or restart) a timer, timers are kept in deadline order and fired by lqc_doWork().
+ *  \details Periodic timers keep their cadence (no drift) and may fire up to LQC__scheduler_alignMillis early to share 
+ *  a wakeup with another due timer. One-shot timers are not fired early.
+ *  \param [in] delayMillis Millis until first firing.
+ *  \param [in] periodMillis Interval for periodic timer, 0 for one-shot.
+ *  \return False if LQC__schedulerTimerCnt timers are already running.
+ */
+bool lqc_timerStart(lqcTimer_t *timer, uint32_t delayMillis, uint32_t periodMillis);
+void lqc_timerStop(lqcTimer_t *timer);
+bool lqc_timerIsRunning(lqcTimer_t *timer);
+
+/**
+ *  \brief Time until lqc_doWork() next has work: scheduler timers, connection steps and retries, on-demand window 
+ *  open/close, data pump batch post, action and transfer timeouts, queued sends. Sleep (or poll/epoll wait) up to this long, 0 = call now.
+ *  \details Invoke after lqc_doWork(); a send, receive or ISR event in the meantime creates work sooner.
+ *  \return Millis until next work, LQC_WAKEUP_NONE if no timer is pending.
+ */
+uint32_t lqc_nextWakeupMs();
+
+/**
+ *  \brief Linux hosts: eventfd readable when work is queued by another thread, the receive path or an ISR event. Add to 
+ *  the application's poll/epoll set with lqc_nextWakeupMs() as the timeout; lqc_doWork() clears it.
+ *  \return File descriptor (created on first call), -1 if not supported on the host.
+ */
+int lqc_getWakeupFd();
+
+/**
+ *  \brief Thread-safe mode (build with LQC_THREADSAFE): sends from any task/thread are placed in a lock-free ring of
+ *  slots and sent by the thread calling lqc_doWork() (the network worker, one thread only).
+ *  \param [in] sendSlots Application slot array.
+ *  \param [in] slotCnt Number of slots, power of 2.
+ *  \return False if slotCnt is not a power of 2 or library not built with LQC_THREADSAFE.
+ */
+bool lqc_enableThreadSafeSend(lqcSendSlot_t *sendSlots, uint16_t slotCnt);
+
+/**
+ *  \brief Worker mode (build with LQC_THREADSAFE): lqc_start() spawns a network worker that owns the transport, connection
+ *  manager and send ring. Application threads only enqueue sends; lqc_doWork() on the application thread performs cloud
+ *  actions and delivers event notifications raised by the worker (completion queue), no network waits.
+ *  \param [in] platformHooks Thread, mutex and sleep functions for the host (static, not copied).
+ *  \param [in] sendSlots Application slot array for the send ring (see lqc_enableThreadSafeSend()).
+ *  \param [in] slotCnt Number of slots, power of 2.
+ *  \return False if the parameters are invalid, the mutex could not be created or not built with LQC_THREADSAFE.
+ */
+bool lqc_enableWorkerThread(lqcPlatformHooks_t *platformHooks, lqcSendSlot_t *sendSlots, uint16_t slotCnt);
+
+/**
+ *  \brief Worker mode: signal the network worker to exit, it finishes its current pass. 
+ */
+void lqc_stopWorkerThread();
+
+/**
+ *  \brief Gateway mode: the default instance's connection carries D2C and C2D for many child device instances.
+ *  \param [in] childTable Application table for the child registry, size ~1.33x the number of children.
+ *  \param [in] childTableSz Number of entries in childTable.
+ */
+void lqc_enableGateway(lqcGatewayChild_t *childTable, uint16_t childTableSz);
+
+/**
+ *  \brief Register a child (instance from lqc_createInstance()), its sends are queued and go upstream in turn.
+ *  \details Child traffic uses the gateway's own topics, the child is identified by the cId message property. Use 
+ *  lqc_gatewayReceiveMsg() as the receive path for the gateway's C2D topic.
+ *  \return False if the table is full (75% load) or child is already registered.
+ */
+bool lqc_gatewayAddChild(lqcHandle_t childLqc, char *queueBuffer, uint16_t queueBufferSz);
+bool lqc_gatewayRemoveChild(const char *deviceId);
+lqcHandle_t lqc_gatewayFindChild(const char *deviceId);
+
+/**
+ *  \brief Gateway C2D receiver, routes by the cId message property to the child (or to lqc_receiveMsg() for the gateway).
+ */
+void lqc_gatewayReceiveMsg(char *message, uint16_t messageSz, const char *props);
+
+/**
+ *  \brief Supply buffer for messages sent while not connected (on-demand windows, reconnects); sent in order when connected.
+ *  \param [in] queueBuffer Application buffer, messages are packed (topic and body) into it.
+ *  \param [in] bufferSz Size of the buffer.
  */
-void lqc_registerPowerSaveCallback(powerSaveCallback_func powerSaveCB);
+void lqc_setSendQueue(char *queueBuffer, uint16_t bufferSz);
 
 
 // const char *lqc_parseSasTokenForDeviceId(const char* sasToken);
@@ -45,19 +45,41 @@
 
 extern lqCloudDevice_t g_lqCloud;
 
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+#define MAX(x, y) (((x)>(y)) ? (x):(y))
+
 
 #pragma region Static Local Declarations
-static void S__tryAsApplAction(const char *actnName, const char *actnKey, const char *actionMsgBody);
-static void S__actionResponse(lqcEventClass_t evntClass, const char *evntName, uint16_t resultCode, const char *responseBody);
+static lqCloudDevice_t *S__dispatchLqc = NULL;                  // instance performing actions, responses from action functions go to it
+
+static inline lqCloudDevice_t *S__actionInstance() { return (S__dispatchLqc != NULL) ? S__dispatchLqc : &g_lqCloud; }
+static void S__currentActionResponse(lqCloudDevice_t *lqc, uint16_t resultCd, lqcEventClass_t eventClass, const char *bodyJson);
+static void S__tryAsApplAction(lqCloudDevice_t *lqc, const char *actnName, const char *actnKey, const char *actionMsgBody);
+static void S__actionResponse(lqCloudDevice_t *lqc, lqcEventClass_t evntClass, const char *evntName, uint16_t resultCode, const char *responseBody);
+static void S__sendActionResponse(lqCloudDevice_t *lqc, const char *actnMsgId, lqcEventClass_t eventClass, const char *eventName, uint16_t resultCode, const char *responseBody);
+static void S__rejectActionRequest(lqCloudDevice_t *lqc, const char *props, uint16_t resultCode);
+static int8_t S__acquireCorrelation(lqCloudDevice_t *lqc);
+static void S__releaseCorrelation(lqcActionCorrelation_t *actn);
+static void S__enqueueActionRequest(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props);
+static void S__queueRequest(lqcActionQueue_t *queue, const char *message, uint16_t messageSz, const char *props, uint16_t propsSz);
+static void S__performReceivedAction(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props);
+static void S__performActionRequest(lqCloudDevice_t *lqc, int8_t actnIndx, char *props, uint16_t propsSz, const char *message, uint16_t messageSz, uint32_t recvAt);
+static int8_t S__findRecentAction(lqcRecentActions_t *recent, uint32_t midHash);
+static bool S__checkRecentAction(lqCloudDevice_t *lqc, uint32_t midHash, const char *props);
+static void S__recordRecentAction(lqCloudDevice_t *lqc, uint32_t midHash, uint16_t resultCode);
+static void S__completeCorrelation(lqCloudDevice_t *lqc, lqcActionCorrelation_t *actn, uint16_t resultCode);
+static void S__recordExecTime(lqCloudDevice_t *lqc, lqcApplAction_t *applActn, uint32_t execMillis);
 
 static void S__metricsInfoResponse(keyValueDict_t params);
 
 // built in cloud actions
-static void S__getActionInfoResponse();
-static void S__getDeviceInfoResponse();
-static void S__getNetworkInfoResponse();
-static void S__setDeviceLabelResponse(keyValueDict_t params);
-static void S__getCommMetricsInfoResponse(keyValueDict_t params);
+static void S__getActionInfoResponse(lqCloudDevice_t *lqc);
+static uint16_t S__buildActionInfo(lqCloudDevice_t *lqc, char *info, uint16_t infoSz);
+static void S__getDeviceInfoResponse(lqCloudDevice_t *lqc);
+static void S__getNetworkInfoResponse(lqCloudDevice_t *lqc);
+static void S__setDeviceLabelResponse(lqCloudDevice_t *lqc, keyValueDict_t params);
+static void S__getCommMetricsInfoResponse(lqCloudDevice_t *lqc, keyValueDict_t params);
+static void S__getActionStatsResponse(lqCloudDevice_t *lqc, keyValueDict_t params);
 
 #pragma endregion
 
@@ -82,23 +104,111 @@ static void S__getCommMetricsInfoResponse(keyValueDict_t params);
  *  \param [in] paramTypes - Character list, where each char indicates a parameter by type 
  */
 bool lqc_registerApplicationAction(const char *actnName, lqcAction_func applActionCB, const char *paramList)
+{
+    return lqcInst_registerApplicationAction(&g_lqCloud, actnName, applActionCB, paramList);
+}
+
+
+/**
+ *	\brief Register an application action with a specific LQCloud instance.
+ *
+ *	\param [in] lqc - Instance handle (from lqc_createInstance() or lqc_getDefaultInstance())
+ *	\param [in] actnName - The name the action is known as in the cloud and APIs
+ *  \param [in] actnFunc - Pointer to the function to invoke in order to perform action
+ *  \param [in] paramTypes - Character list, where each char indicates a parameter by type 
+ */
+bool lqcInst_registerApplicationAction(lqcHandle_t lqc, const char *actnName, lqcAction_func applActionCB, const char *paramList)
 {
     ASSERT(strlen(actnName) < LQC__action_nameSz);
     ASSERT(strlen(paramList) < LQC__action_paramsListSz);
 
     for (size_t i = 0; i < LQC__actionCnt; i++)
     {
-        if (g_lqCloud.applActions[i].name[0] == '\0')
+        if (lqc->applActions[i].name[0] == '\0')
         {
-            strcpy(g_lqCloud.applActions[i].name, actnName);
-            g_lqCloud.applActions[i].actionCB = applActionCB;
-            strcpy(g_lqCloud.applActions[i].paramList, paramList);
+            strcpy(lqc->applActions[i].name, actnName);
+            lqc->applActions[i].actionCB = applActionCB;
+            strcpy(lqc->applActions[i].paramList, paramList);
+            lqc->actnInfoLen = 0;                                           // invalidate cached getactn catalogue
             return true;
         }
     }
     return false;    
 }
 
+
+/**
+ *	\brief Set an execution time budget for an application action, exceeding the budget raises an ACTNBUDGET warning event.
+ *
+ *	\param [in] actnName - The name the action is registered with
+ *  \param [in] budgetMillis - Execution time allowed the action function, 0 = no budget
+ */
+bool lqc_setActionBudget(const char *actnName, uint16_t budgetMillis)
+{
+    return lqcInst_setActionBudget(&g_lqCloud, actnName, budgetMillis);
+}
+
+
+bool lqcInst_setActionBudget(lqcHandle_t lqc, const char *actnName, uint16_t budgetMillis)
+{
+    for (size_t i = 0; i < LQC__actionCnt; i++)
+    {
+        if (strcmp(lqc->applActions[i].name, actnName) == 0)
+        {
+            lqc->applActions[i].budgetMillis = budgetMillis;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ *	\brief Supply the buffer holding received action requests until they are performed from lqc_doWork().
+ *
+ *  Without a queue buffer requests are performed in the transport's receive callback (worker mode requires the queue, 
+ *  requests received on the network worker are answered as unavailable).
+ * 
+ *	\param [in] queueBuffer - Application buffer, requests are packed (header, properties, body) into it.
+ *  \param [in] bufferSz - Size of the buffer, LQC__actionQueue_bufferSz holds one maximum size request.
+ */
+void lqc_setActionQueue(char *queueBuffer, uint16_t bufferSz)
+{
+    lqcInst_setActionQueue(&g_lqCloud, queueBuffer, bufferSz);
+}
+
+
+void lqcInst_setActionQueue(lqcHandle_t lqc, char *queueBuffer, uint16_t bufferSz)
+{
+    LQC_LOCK();
+    lqc->actnQueue.buffer = queueBuffer;
+    lqc->actnQueue.bufferSz = (queueBuffer != NULL) ? bufferSz : 0;
+    lqc->actnQueue.bufferUsed = 0;
+    lqc->actnQueue.count = 0;
+    LQC_UNLOCK();
+}
+
+
+/**
+ *	\brief Supply a buffer caching the getactn catalogue between registrations, otherwise it is built on the stack per request.
+ *
+ *  \param [in] cacheBuffer - Application buffer.
+ *  \param [in] bufferSz - Size of the buffer, at least LQC__actionInfoSz.
+ *  \return False if the buffer is too small (no cache).
+ */
+bool lqc_setActionInfoCache(char *cacheBuffer, uint16_t bufferSz)
+{
+    return lqcInst_setActionInfoCache(&g_lqCloud, cacheBuffer, bufferSz);
+}
+
+
+bool lqcInst_setActionInfoCache(lqcHandle_t lqc, char *cacheBuffer, uint16_t bufferSz)
+{
+    lqc->actnInfoLen = 0;
+    lqc->actnInfo = (bufferSz >= LQCACTN_INFO_SZ) ? cacheBuffer : NULL;
+    return lqc->actnInfo != NULL;
+}
+
 /**
  *	@brief Validates and sends the result (response) for an application action.
  *	@param resultCode [in] HTTP style status result, 200 is success, etc.
@@ -107,12 +217,7 @@ bool lqc_registerApplicationAction(const char *actnName, lqcAction_func applActi
  */
 void LQC_sendActionResponse(uint16_t resultCd, lqcEventClass_t eventClass, const char *bodyJson)
 {
-    uint16_t bodySz = strlen(bodyJson);
-
-    if (bodySz == 0)                                                                        // empty, send empty JSON object
-        S__actionResponse(eventClass, g_lqCloud.actnName, resultCd, "{}");
-    else
-        S__actionResponse(eventClass, g_lqCloud.actnName, resultCd, bodyJson);
+    S__currentActionResponse(S__actionInstance(), resultCd, eventClass, bodyJson);
 }
 
 
@@ -124,7 +229,60 @@ void LQC_sendActionResponse(uint16_t resultCd, lqcEventClass_t eventClass, const
  */
 void lqc_sendActionResponse(uint16_t resultCd, const char *bodyJson)
 {
-    LQC_sendActionResponse(resultCd, lqcEventClass_application, bodyJson);
+    S__currentActionResponse(S__actionInstance(), resultCd, lqcEventClass_application, bodyJson);
+}
+
+
+/**
+ *	@brief Invoked from an action function to respond later (async), action function returns without sending a response.
+ *	@param timeoutSecs [in] Seconds allowed for the action to complete, LQCloud sends a timeout response if exceeded. 0 = default.
+ *  @return Handle to complete the action with, LQC_ACTIONHANDLE_INVALID if no action is in progress.
+ */
+lqcActionHandle_t lqc_deferActionResponse(uint16_t timeoutSecs)
+{
+    lqCloudDevice_t *lqc = S__actionInstance();
+
+    if (lqc->actnCurrent < 0)
+        return LQC_ACTIONHANDLE_INVALID;
+
+    lqcActionCorrelation_t *actn = &lqc->actnPending[lqc->actnCurrent];
+    actn->deferred = true;
+    actn->startAt = pMillis();
+    actn->timeoutMillis = PERIOD_FROM_SECONDS(timeoutSecs ? timeoutSecs : LQC__action_defaultTimeoutSecs);
+
+    return (actn->generation << 8) | (lqc->actnCurrent + 1);
+}
+
+
+/**
+ *	@brief Complete a deferred action, sends the action response to LQCloud.
+ *	@param actnHandle [in] Handle returned from lqc_deferActionResponse().
+ *	@param resultCode [in] HTTP style status result, 200 is success, etc.
+ *	@param body [in] Char pointer to body (message) response from the appl action.
+ *  @return True if response sent, false if the handle is stale (already completed or timed out).
+ */
+bool lqc_completeAction(lqcActionHandle_t actnHandle, uint16_t resultCd, const char *bodyJson)
+{
+    return lqcInst_completeAction(&g_lqCloud, actnHandle, resultCd, bodyJson);
+}
+
+
+/**
+ *	@brief Complete a deferred action of a specific LQCloud instance (the instance that performed the action).
+ */
+bool lqcInst_completeAction(lqcHandle_t lqc, lqcActionHandle_t actnHandle, uint16_t resultCd, const char *bodyJson)
+{
+    uint8_t indx = (actnHandle & 0xFF) - 1;
+    if (actnHandle == LQC_ACTIONHANDLE_INVALID || indx >= LQC__actionPendingCnt)
+        return false;
+
+    lqcActionCorrelation_t *actn = &lqc->actnPending[indx];
+    if (!actn->inUse || !actn->deferred || actn->generation != (actnHandle >> 8))
+        return false;
+
+    S__sendActionResponse(lqc, actn->msgId, actn->eventClass, actn->name, resultCd, strlen(bodyJson) ? bodyJson : "{}");
+    S__completeCorrelation(lqc, actn, resultCd);
+    return true;
 }
 
 #pragma endregion
@@ -141,7 +299,7 @@ void lqc_sendActionResponse(uint16_t resultCd, const char *bodyJson)
  *  \param [in] actnParams - Parameters received with request.
  *	\param [in] msgBody - Message body received from the MQTT receiver process.
  */
-void LQC_processIncomingActionRequest(const char *actnName, keyValueDict_t mqttProps, const char *msgBody)
+void LQC_processIncomingActionRequest(lqCloudDevice_t *lqc, const char *actnName, keyValueDict_t mqttProps, const char *msgBody)
 {
     char sKeyProp[lqc__identity_deviceKeySz] = {0};
     char eventClassProp[5] = {0};
@@ -153,58 +311,525 @@ void LQC_processIncomingActionRequest(const char *actnName, keyValueDict_t mqttP
     lq_getQryStrDictionaryValue("mId", mqttProps, rqstMsgIdProp, LQC__action_MsgIdSz);
 
     lqcEventClass_t eventClass = strncmp(eventClassProp, "lqc", 3) ? lqcEventClass_application : lqcEventClass_lqcloud;
-    strncpy(g_lqCloud.actnMsgId, rqstMsgIdProp, LQC__action_MsgIdSz);
 
-    if (strlen(g_lqCloud.deviceKey) == 0 || strcmp(sKeyProp, g_lqCloud.deviceKey) == 0)
+    lqcActionCorrelation_t *actn = &lqc->actnPending[lqc->actnCurrent];
+    actn->eventClass = eventClass;
+    if (rqstMsgIdProp[0] != '\0')                                          // mId overrides transport $.mid for correlation
+        strncpy(actn->msgId, rqstMsgIdProp, LQC__action_MsgIdSz);
+
+    if (strlen(lqc->deviceKey) == 0 || strcmp(sKeyProp, lqc->deviceKey) == 0)
     {
         if (eventClass == lqcEventClass_application)
         {
-            S__tryAsApplAction(actnName, sKeyProp, msgBody);
+            S__tryAsApplAction(lqc, actnName, sKeyProp, msgBody);
         }
         else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "getactn") == 0)    // getactninfo: get action info
         {
-            S__getActionInfoResponse();
+            S__getActionInfoResponse(lqc);
         }
         else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "getdvc") == 0)     // getdvcinfo: get device info
         {
-            S__getDeviceInfoResponse();
+            S__getDeviceInfoResponse(lqc);
         }
         else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "getntwk") == 0)    // getntwkinfo: get network info
         {
-            S__getNetworkInfoResponse();
+            S__getNetworkInfoResponse(lqc);
         }
         else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "setlabel") == 0)    // setdname: set (or get) device name
         {
             lqJsonPropValue_t paramsProp = lq_getJsonPropValue(msgBody, "params");
             keyValueDict_t actnParams = lq_createQryStrDictionary(paramsProp.value, paramsProp.len);
-            S__setDeviceLabelResponse(actnParams);
+            S__setDeviceLabelResponse(lqc, actnParams);
         }
         else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "getcomm") == 0)    // getdiaginfo: get cloud diagnostics info
         {
             lqJsonPropValue_t paramsProp = lq_getJsonPropValue(msgBody, "params");
             keyValueDict_t actnParams = lq_createQryStrDictionary(paramsProp.value, paramsProp.len);
-            S__getCommMetricsInfoResponse(actnParams);
+            S__getCommMetricsInfoResponse(lqc, actnParams);
+        }
+        else if (eventClass == lqcEventClass_lqcloud && strcmp(actnName, "getactstat") == 0)    // getactstat: get application action execution statistics
+        {
+            lqJsonPropValue_t paramsProp = lq_getJsonPropValue(msgBody, "params");
+            keyValueDict_t actnParams = lq_createQryStrDictionary(paramsProp.value, paramsProp.len);
+            S__getActionStatsResponse(lqc, actnParams);
         }
         else
-            LQC_sendActionResponse(resultCode__notFound, eventClass, "Unable to match action.");
+            S__currentActionResponse(lqc, resultCode__notFound, eventClass, "Unable to match action.");
     }
     else
-        LQC_sendActionResponse(resultCode__forbidden, eventClass, "Invalid action key.");
+        S__currentActionResponse(lqc, resultCode__forbidden, eventClass, "Invalid action key.");
 }
 
 
 
+/**
+ *	\brief Queue an incoming action request for dispatch from lqc_doWork(). Invoked in the transport's receive callback.
+ *
+ *  Request is copied, not parsed. If the queue is full (or the request exceeds a queue slot) the request is recorded
+ *  for an automatic response from lqc_doWork(). A request redelivered by the cloud is not queued again, if already 
+ *  performed its original result code is sent as the response. On the network worker chunked transfer fragments are 
+ *  queued here as well, so the transfer sink is invoked from lqc_doWork(); a fragment that does not fit is dropped unacked.
+ *
+ *	\param [in] message - Message body received.
+ *  \param [in] messageSz - Size of the message body.
+ *	\param [in] props - Message properties (topic postamble as HTTP query string).
+ */
+void LQC_enqueueActionRequest(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props)
+{
+    if (lqc->actnQueue.buffer == NULL && !LQC_onWorkerThread())
+    {
+        S__performReceivedAction(lqc, message, messageSz, props);          // no queue: perform now, as receive is on the application thread
+        return;
+    }
+    LQC_LOCK();                                                             // worker mode: queue is shared with the application thread
+    S__enqueueActionRequest(lqc, message, messageSz, props);
+    LQC_UNLOCK();
+    LQC_signalWakeup();
+}
+
+
+static void S__enqueueActionRequest(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props)
+{
+    lqcActionQueue_t *queue = &lqc->actnQueue;
+    uint16_t propsSz = strlen(props);
+    char msgId[SET_PROPLEN(LQC__action_MsgIdSz)];
+    uint16_t rqstSz = sizeof(lqcActionRqst_t) + propsSz + 1 + messageSz + 1;
+
+    bool xferChunk = lqc == &g_lqCloud && LQC_isTransferChunk(props);      // worker mode: transfer fragment, for the sink on the application thread
+    if (xferChunk)
+    {
+        if (queue->buffer == NULL || queue->count == LQC__actionQueueCnt || rqstSz > queue->bufferSz - queue->bufferUsed)
+        {
+            PRINTF(dbgColor__warn, "Xfer fragment not queued\r");          // not acked, cloud resends from last ack
+            return;
+        }
+        S__queueRequest(queue, message, messageSz, props, propsSz);         // redelivery is handled by transfer sequence, not recent actions
+        return;
+    }
+
+    LQC_peekPropValue(props, "$.mid", msgId, sizeof(msgId));
+    uint32_t midHash = LQC_hashKey(msgId, strlen(msgId));
+    if (S__checkRecentAction(lqc, midHash, props))
+        return;
+
+    if (queue->buffer == NULL)
+    {
+        S__rejectActionRequest(lqc, props, resultCode__unavailable);        // worker mode without lqc_setActionQueue()
+        return;
+    }
+    if (rqstSz > queue->bufferSz)
+    {
+        S__rejectActionRequest(lqc, props, resultCode__badRequest);         // can never be queued
+        return;
+    }
+    if (queue->count == LQC__actionQueueCnt || rqstSz > queue->bufferSz - queue->bufferUsed)
+    {
+        S__rejectActionRequest(lqc, props, resultCode__unavailable);
+        return;
+    }
+
+    S__queueRequest(queue, message, messageSz, props, propsSz);
+    S__recordRecentAction(lqc, midHash, 0);                                 // in progress, result recorded at response
+}
+
+
+/**
+ *	\brief Copy a request to the tail of the queue buffer, caller has checked it fits.
+ */
+static void S__queueRequest(lqcActionQueue_t *queue, const char *message, uint16_t messageSz, const char *props, uint16_t propsSz)
+{
+    lqcActionRqst_t rqst = { .recvAt = pMillis(), .propsSz = propsSz, .msgSz = messageSz };
+    char *dest = queue->buffer + queue->bufferUsed;
+    memcpy(dest, &rqst, sizeof(lqcActionRqst_t));                           // header unaligned in buffer, copy don't cast
+    dest += sizeof(lqcActionRqst_t);
+    memcpy(dest, props, propsSz);
+    dest[propsSz] = '\0';
+    dest += propsSz + 1;
+    memcpy(dest, message, messageSz);
+    dest[messageSz] = '\0';
+
+    queue->bufferUsed += sizeof(lqcActionRqst_t) + propsSz + 1 + messageSz + 1;
+    queue->count++;
+}
+
+
+/**
+ *	\brief No action queue: perform the request from the receive callback, properties are copied for parsing.
+ */
+static void S__performReceivedAction(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props)
+{
+    char rqstProps[mqtt__topic_bufferSz];
+    char msgId[SET_PROPLEN(LQC__action_MsgIdSz)];
+    uint16_t propsSz = strlen(props);
+    int8_t actnIndx = -1;
+
+    LQC_peekPropValue(props, "$.mid", msgId, sizeof(msgId));
+    uint32_t midHash = LQC_hashKey(msgId, strlen(msgId));
+
+    LQC_LOCK();
+    if (!S__checkRecentAction(lqc, midHash, props))
+    {
+        if (propsSz >= sizeof(rqstProps))
+            S__rejectActionRequest(lqc, props, resultCode__badRequest);
+        else if ((actnIndx = S__acquireCorrelation(lqc)) < 0)
+            S__rejectActionRequest(lqc, props, resultCode__unavailable);    // all in-flight slots busy (deferred actions)
+        else
+            S__recordRecentAction(lqc, midHash, 0);
+    }
+    LQC_UNLOCK();
+    if (actnIndx < 0)
+        return;
+
+    memcpy(rqstProps, props, propsSz + 1);
+    S__performActionRequest(lqc, actnIndx, rqstProps, propsSz, message, messageSz, pMillis());
+}
+
+
+/**
+ *	\brief Perform a request in the reserved in-flight slot, the slot is released here unless the action deferred its response.
+ */
+static void S__performActionRequest(lqCloudDevice_t *lqc, int8_t actnIndx, char *props, uint16_t propsSz, const char *message, uint16_t messageSz, uint32_t recvAt)
+{
+    lqcActionCorrelation_t *actn = &lqc->actnPending[actnIndx];
+    keyValueDict_t propsDict = lq_createQryStrDictionary(props, propsSz);
+    lqCloudDevice_t *priorLqc = S__dispatchLqc;
+    int8_t priorCurrent = lqc->actnCurrent;
+
+    PRINTF(dbgColor__cyan, "m(%d): %s\r", messageSz, message);
+
+    lq_getQryStrDictionaryValue("$.mid", propsDict, actn->msgId, LQC__messageIdSz);
+    lq_getQryStrDictionaryValue("evN", propsDict, actn->name, LQC__action_nameSz);
+    actn->midHash = LQC_hashKey(actn->msgId, strlen(actn->msgId));
+    actn->recvAt = recvAt;
+
+    lqc->actnCurrent = actnIndx;
+    S__dispatchLqc = lqc;                                                   // action functions respond via lqc_sendActionResponse()
+    LQC_processIncomingActionRequest(lqc, actn->name, propsDict, message);
+    if (actn->inUse && !actn->deferred)                                     // safety: action neither responded or deferred
+        S__releaseCorrelation(actn);
+    S__dispatchLqc = priorLqc;                                              // restored, receive may be nested in an action's send
+    lqc->actnCurrent = priorCurrent;
+}
+
+
+/**
+ *	\brief Perform queued action requests, invoked from lqc_doWork(). 
+ * 
+ *  Automatic responses for rejected requests are sent first, then queued requests are performed FIFO. Both count 
+ *  against the dispatch budget (see lqc_setActionDispatchBudget()).
+ */
+void LQC_dispatchActionRequests(lqCloudDevice_t *lqc)
+{
+    lqcActionQueue_t *queue = &lqc->actnQueue;
+    uint8_t budget = queue->dispatchBudget;
+
+    while (budget > 0 && queue->rejectCount > 0)
+    {
+        lqcActionReject_t *reject = &queue->rejects[queue->rejectTail];
+
+        PRINTF(dbgColor__warn, "ActnRejected: %s rslt=%d\r", reject->name, reject->resultCode);
+        S__sendActionResponse(lqc, reject->msgId, reject->eventClass, reject->name, reject->resultCode, "{}");
+
+        LQC_LOCK();
+        queue->rejectTail = (queue->rejectTail + 1) % LQC__actionRejectCnt;
+        queue->rejectCount--;
+        LQC_UNLOCK();
+        budget--;
+    }
+
+    while (budget > 0 && queue->count > 0)
+    {
+        lqcActionRqst_t rqst;                                               // oldest request at buffer head, stays reserved until action completes
+        memcpy(&rqst, queue->buffer, sizeof(lqcActionRqst_t));
+        char *rqstProps = queue->buffer + sizeof(lqcActionRqst_t);
+        char *rqstMsg = rqstProps + rqst.propsSz + 1;
+        uint16_t rqstSz = sizeof(lqcActionRqst_t) + rqst.propsSz + 1 + rqst.msgSz + 1;
+
+        bool xferChunk = lqc == &g_lqCloud && LQC_receiveTransferChunk(rqstMsg, rqst.msgSz, rqstProps);  // queued by the network worker, no in-flight slot
+        if (!xferChunk)
+        {
+            int8_t actnIndx = S__acquireCorrelation(lqc);
+            if (actnIndx < 0)
+                break;                                                      // all in-flight slots busy, leave queued for a later pass
+
+            PRINTF(dbgColor__info, "\r**ActnDispatch** queued=%d waitMs=%d\r", queue->count, pMillis() - rqst.recvAt);
+            S__performActionRequest(lqc, actnIndx, rqstProps, rqst.propsSz, rqstMsg, rqst.msgSz, rqst.recvAt);
+        }
+
+        LQC_LOCK();                                                         // receive appends behind, shift remaining requests to head
+        queue->bufferUsed -= rqstSz;
+        memmove(queue->buffer, queue->buffer + rqstSz, queue->bufferUsed);
+        queue->count--;
+        LQC_UNLOCK();
+        budget--;
+    }
+}
+
+
+/**
+ *	\brief Millis until queued requests can be dispatched or a deferred action times out.
+ */
+uint32_t LQC_actionsNextWakeup(lqCloudDevice_t *lqc)
+{
+    uint32_t wakeup = LQC_WAKEUP_NONE;
+    bool slotFree = false;
+
+    for (size_t i = 0; i < LQC__actionPendingCnt; i++)
+    {
+        lqcActionCorrelation_t *actn = &lqc->actnPending[i];
+
+        if (!actn->inUse)
+            slotFree = true;
+        else if (actn->deferred)
+            wakeup = MIN(wakeup, LQC_millisUntil(actn->startAt, actn->timeoutMillis));
+    }
+    if (lqc->actnQueue.rejectCount > 0 || (lqc->actnQueue.count > 0 && slotFree))
+        return 0;
+    return wakeup;
+}
+
+
+/**
+ *	\brief Respond to deferred actions not completed within their timeout, invoked from lqc_doWork().
+ */
+void LQC_checkActionTimeouts(lqCloudDevice_t *lqc)
+{
+    for (size_t i = 0; i < LQC__actionPendingCnt; i++)
+    {
+        lqcActionCorrelation_t *actn = &lqc->actnPending[i];
+
+        if (actn->inUse && actn->deferred && wrkTime_isElapsed(actn->startAt, actn->timeoutMillis))
+        {
+            PRINTF(dbgColor__warn, "ActnTimeout: %s\r", actn->name);
+            S__sendActionResponse(lqc, actn->msgId, actn->eventClass, actn->name, resultCode__timeout, "{}");
+            S__completeCorrelation(lqc, actn, resultCode__timeout);
+        }
+    }
+}
+
+
+/**
+ *	\brief Copy a property value from a query string formatted props string, without parsing (mutating) it. 
+ *  \return Length of value copied, 0 if key not found.
+ */
+uint8_t LQC_peekPropValue(const char *props, const char *key, char *value, uint8_t valueSz)
+{
+    uint8_t keyLen = strlen(key);
+    const char *pKey = props;
+
+    value[0] = '\0';
+    while ((pKey = strstr(pKey, key)) != NULL)
+    {
+        bool keyStart = (pKey == props || pKey[-1] == '&' || pKey[-1] == '/' || pKey[-1] == '?');
+        if (keyStart && pKey[keyLen] == '=')
+        {
+            const char *pValue = pKey + keyLen + 1;
+            uint8_t len = 0;
+            while (pValue[len] != '\0' && pValue[len] != '&' && len < valueSz - 1)
+            {
+                value[len] = pValue[len];
+                len++;
+            }
+            value[len] = '\0';
+            return len;
+        }
+        pKey += keyLen;
+    }
+    return 0;
+}
+
+
+/**
+ *	\brief FNV-1a hash of an identifier (message ID, device ID), 0 is reserved for an empty key (empty cache or table entry).
+ */
+uint32_t LQC_hashKey(const char *key, uint16_t keyLen)
+{
+    if (keyLen == 0)
+        return 0;
+
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < keyLen; i++)
+    {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619U;
+    }
+    return hash ? hash : 1;
+}
+
+
+/**
+ *	\brief Set the recent actions cache in use, validating content that may have survived a reset.
+ *
+ *  Entries recorded without a result (in progress at reset) are cleared, the cloud did not receive a response for 
+ *  them so a redelivery is performed.
+ */
+void LQC_initRecentActions(lqCloudDevice_t *lqc, lqcRecentActions_t *recentActions)
+{
+    if (recentActions->magic != LQC__actionRecentMagic)
+    {
+        memset(recentActions, 0, sizeof(lqcRecentActions_t));
+        recentActions->magic = LQC__actionRecentMagic;
+    }
+    for (size_t i = 0; i < LQC__actionRecentCnt; i++)
+    {
+        if (recentActions->resultCode[i] == 0)
+            recentActions->midHash[i] = 0;
+    }
+    recentActions->next %= LQC__actionRecentCnt;
+    lqc->actnRecent = recentActions;
+}
+
+
 #pragma endregion
 
 
 #pragma region Static Local Functions
 
+/**
+ *	\brief Find a request in the recent actions ring.
+ *  \return Ring index, -1 if not present.
+ */
+static int8_t S__findRecentAction(lqcRecentActions_t *recent, uint32_t midHash)
+{
+    for (uint8_t i = 0; i < LQC__actionRecentCnt; i++)
+    {
+        if (recent->midHash[i] == midHash)
+            return i;
+    }
+    return -1;
+}
+
+
+/**
+ *	\brief Test for a request redelivery, a duplicate of a performed request is answered with the original result code.
+ *  \return True if request is a duplicate and should not be queued.
+ */
+static bool S__checkRecentAction(lqCloudDevice_t *lqc, uint32_t midHash, const char *props)
+{
+    lqcRecentActions_t *recent = lqc->actnRecent;
+    int8_t indx;
+
+    if (midHash == 0 || (indx = S__findRecentAction(recent, midHash)) < 0)
+        return false;
+
+    lqc->duplicateActnRqstCnt++;
+    PRINTF(dbgColor__warn, "ActnDuplicate: rslt=%d\r", recent->resultCode[indx]);
+    if (recent->resultCode[indx] != 0)                                      // in progress (queued/in-flight) will respond when completed
+        S__rejectActionRequest(lqc, props, recent->resultCode[indx]);
+    return true;
+}
+
+
+/**
+ *	\brief Record a request (resultCode 0, in progress) or its result. New entries replace the oldest completed entry,
+ *  in progress entries are kept (ring is larger than queue + in-flight).
+ */
+static void S__recordRecentAction(lqCloudDevice_t *lqc, uint32_t midHash, uint16_t resultCode)
+{
+    lqcRecentActions_t *recent = lqc->actnRecent;
+
+    if (midHash == 0)
+        return;
+
+    int8_t indx = S__findRecentAction(recent, midHash);
+    if (indx < 0)
+    {
+        for (uint8_t i = 0; i < LQC__actionRecentCnt && recent->midHash[recent->next] != 0 && recent->resultCode[recent->next] == 0; i++)
+            recent->next = (recent->next + 1) % LQC__actionRecentCnt;           // skip in progress
+        indx = recent->next;
+        recent->next = (recent->next + 1) % LQC__actionRecentCnt;
+    }
+    recent->midHash[indx] = midHash;
+    recent->resultCode[indx] = resultCode;
+}
+
+
+/**
+ *	\brief Reserve an in-flight action slot.
+ *  \return Index of slot in actnPending, -1 if all are in use.
+ */
+static int8_t S__acquireCorrelation(lqCloudDevice_t *lqc)
+{
+    for (size_t i = 0; i < LQC__actionPendingCnt; i++)
+    {
+        lqcActionCorrelation_t *actn = &lqc->actnPending[i];
+        if (!actn->inUse)
+        {
+            actn->inUse = true;
+            actn->deferred = false;
+            actn->msgId[0] = '\0';
+            actn->name[0] = '\0';
+            actn->startAt = pMillis();
+            actn->midHash = 0;
+            actn->recvAt = actn->startAt;
+            actn->applIndx = -1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ *	\brief Record the outcome of a responded action (result, round trip timing) and release its in-flight slot.
+ */
+static void S__completeCorrelation(lqCloudDevice_t *lqc, lqcActionCorrelation_t *actn, uint16_t resultCode)
+{
+    lqc->actnResult = resultCode;
+    LQC_LOCK();
+    S__recordRecentAction(lqc, actn->midHash, resultCode);
+    LQC_UNLOCK();
+
+    if (actn->applIndx >= 0)
+    {
+        lqcApplAction_t *applActn = &lqc->applActions[actn->applIndx];
+        applActn->rspLastMillis = pMillis() - actn->recvAt;
+        applActn->rspMaxMillis = MAX(applActn->rspMaxMillis, applActn->rspLastMillis);
+    }
+    S__releaseCorrelation(actn);
+}
+
+
+static void S__releaseCorrelation(lqcActionCorrelation_t *actn)
+{
+    actn->inUse = false;
+    actn->deferred = false;
+    actn->generation++;
+}
+
+
+/**
+ *	\brief Record a request for automatic response, request properties are read without altering props.
+ */
+static void S__rejectActionRequest(lqCloudDevice_t *lqc, const char *props, uint16_t resultCode)
+{
+    lqcActionQueue_t *queue = &lqc->actnQueue;
+    char eventClassProp[LQC_EVNTCLASS_SZ] = {0};
+
+    if (queue->rejectCount == LQC__actionRejectCnt)
+    {
+        lqc->droppedActnRqstCnt++;                                          // no room to even respond, cloud will timeout request
+        return;
+    }
+
+    lqcActionReject_t *reject = &queue->rejects[queue->rejectHead];
+    LQC_peekPropValue(props, "$.mid", reject->msgId, sizeof(reject->msgId));
+    LQC_peekPropValue(props, "evN", reject->name, sizeof(reject->name));
+    LQC_peekPropValue(props, "evC", eventClassProp, sizeof(eventClassProp));
+    reject->eventClass = strncmp(eventClassProp, "lqc", 3) ? lqcEventClass_application : lqcEventClass_lqcloud;
+    reject->resultCode = resultCode;
+
+    queue->rejectHead = (queue->rejectHead + 1) % LQC__actionRejectCnt;
+    queue->rejectCount++;
+}
+
+
 /**
  *	\brief Application custom action processor. 
  *
  *	\param [in] actionMessage - Message received from the MQTT receiver process.
  */
-static void S__tryAsApplAction(const char *actnName, const char *actnKey, const char *actionMsgBody)
+static void S__tryAsApplAction(lqCloudDevice_t *lqc, const char *actnName, const char *actnKey, const char *actionMsgBody)
 {
     PRINTF(dbgColor__dGreen, "ApplAction: %s\r", actnName);
     lqJsonPropValue_t paramsProp = lq_getJsonPropValue(actionMsgBody, "params");
@@ -212,39 +837,124 @@ static void S__tryAsApplAction(const char *actnName, const char *actnKey, const
 
     for (size_t i = 0; i < LQC__actionCnt; i++)
     {
-        if (strcmp(g_lqCloud.applActions[i].name, actnName) == 0)
+        if (strcmp(lqc->applActions[i].name, actnName) == 0)
         {
-            g_lqCloud.applActions[i].actionCB(actnParams);
-            if (strlen(g_lqCloud.actnMsgId) > 0)                     // send error, if function failed to send response and clear request msgId
-                S__actionResponse(lqcEventClass_application, g_lqCloud.actnName, resultCode__internalError, "Action failed. See eRslt (resultCode).");
+            lqcActionCorrelation_t *actn = &lqc->actnPending[lqc->actnCurrent];
+            actn->applIndx = i;
+
+            uint32_t execStart = pMillis();
+            lqc->applActions[i].actionCB(actnParams);
+            S__recordExecTime(lqc, &lqc->applActions[i], pMillis() - execStart);
+
+            if (actn->inUse && !actn->deferred)                     // send error, if function failed to send (or defer) response
+                S__actionResponse(lqc, lqcEventClass_application, actnName, resultCode__internalError, "Action failed. See eRslt (resultCode).");
             return;
         }
     }
+    S__actionResponse(lqc, lqcEventClass_application, actnName, resultCode__notFound, "Unable to match action.");
 }
 
 
-static void S_getApplActions(char applActions[], uint16_t maxSz)
+/**
+ *	\brief Tally an application action function execution, raise warning event if over budget. 
+ */
+static void S__recordExecTime(lqCloudDevice_t *lqc, lqcApplAction_t *applActn, uint32_t execMillis)
 {
-    uint16_t actnOffset = 0;
+    static const uint16_t histBinLimits[LQC__actionStat_histBins - 1] = { 10, 50, 100, 500, 1000 };
+    uint8_t bin = 0;
 
-    for (size_t i = 0; i < LQC__actionCnt; i++)
+    while (bin < LQC__actionStat_histBins - 1 && execMillis >= histBinLimits[bin])
+        bin++;
+
+    applActn->execCnt++;
+    applActn->execLastMillis = MIN(execMillis, UINT16_MAX);
+    applActn->execMaxMillis = MAX(applActn->execMaxMillis, applActn->execLastMillis);
+    applActn->execHistogram[bin]++;
+
+    if (applActn->budgetMillis > 0 && execMillis > applActn->budgetMillis)
     {
-        char actnBuf[80] = {0};
-        //char paramBuf[60] = {0};
+        char budgetMsg[40];
 
-        if (strlen(g_lqCloud.applActions[i].name) > 0)
-        {
-            snprintf(actnBuf, sizeof(actnBuf), "{\"n\":\"%s\",\"p\":\"%s\"},", g_lqCloud.applActions[i].name, g_lqCloud.applActions[i].paramList);
+        applActn->execOverBudgetCnt++;
+        snprintf(budgetMsg, sizeof(budgetMsg), "%s:%lums>%ums", applActn->name, (unsigned long)execMillis, applActn->budgetMillis);
+        PRINTF(dbgColor__warn, "ActnOverBudget: %s\r", budgetMsg);
+        LQC_invokeAppEventCBRequest(lqc, "ACTNBUDGET", budgetMsg);
+    }
+}
 
-            strncpy(applActions + actnOffset, actnBuf, maxSz - actnOffset);
-            actnOffset += strlen(actnBuf);
+
+/**
+ *	\brief Serialize the action catalogue (getactn response body).
+ *
+ *  Buffer is sized for LQC__actionCnt actions at maximum name/paramList lengths (LQCACTN_INFO_SZ), so content is never truncated.
+ *  \return Length of the catalogue.
+ */
+static uint16_t S__buildActionInfo(lqCloudDevice_t *lqc, char *info, uint16_t infoSz)
+{
+    uint16_t infoLen;
+
+    infoLen = snprintf(info, infoSz, "{\"getactn\":"
+                                      "{\"lqc\":["
+                                      "{\"n\":\"getactn\",\"p\":\"\"},"
+                                      "{\"n\":\"getntwk\",\"p\":\"\"},"
+                                      "{\"n\":\"getdvc\",\"p\":\"\"},"
+                                      "{\"n\":\"getcomm\",\"p\":\"reset=bool\"},"
+                                      "{\"n\":\"getactstat\",\"p\":\"reset=bool\"},"
+                                      "{\"n\":\"setlabel\",\"p\":\"name=text\"}"
+                                      "],"
+                                      "\"app\":[");
+    for (size_t i = 0; i < LQC__actionCnt; i++)
+    {
+        if (lqc->applActions[i].name[0] != '\0')
+        {
+            infoLen += snprintf(info + infoLen, infoSz - infoLen, "{\"n\":\"%s\",\"p\":\"%s\"},", 
+                                lqc->applActions[i].name, lqc->applActions[i].paramList);
         }
     }
-    applActions[strlen(applActions) - 1] = '\0';         // drop trailing '&'
+    if (info[infoLen - 1] == ',')
+        infoLen--;                                                          // drop trailing ','
+    infoLen += snprintf(info + infoLen, infoSz - infoLen, "]}}");
+    return infoLen;
+}
+
+
+/**
+ *	\brief Validate and send the response for the action in progress, empty body is sent as an empty JSON object.
+ */
+static void S__currentActionResponse(lqCloudDevice_t *lqc, uint16_t resultCd, lqcEventClass_t eventClass, const char *bodyJson)
+{
+    if (lqc->actnCurrent < 0)
+    {
+        PRINTF(dbgColor__warn, "ActnResp: no action in progress, use lqc_completeAction()\r");
+        return;
+    }
+    const char *actnName = lqc->actnPending[lqc->actnCurrent].name;
+
+    if (strlen(bodyJson) == 0)                                                              // empty, send empty JSON object
+        S__actionResponse(lqc, eventClass, actnName, resultCd, "{}");
+    else
+        S__actionResponse(lqc, eventClass, actnName, resultCd, bodyJson);
 }
 
 
-static void S__actionResponse(lqcEventClass_t eventClass, const char *eventName, uint16_t resultCode, const char *responseBody)
+/**
+ *	\brief Respond to the action in progress (synchronous response) and release its in-flight slot.
+ */
+static void S__actionResponse(lqCloudDevice_t *lqc, lqcEventClass_t eventClass, const char *eventName, uint16_t resultCode, const char *responseBody)
+{
+    if (lqc->actnCurrent < 0)
+        return;
+
+    lqcActionCorrelation_t *actn = &lqc->actnPending[lqc->actnCurrent];
+    if (!actn->inUse || actn->deferred)                                     // already responded, or will respond via handle
+        return;
+
+    S__sendActionResponse(lqc, actn->msgId, eventClass, eventName, resultCode, responseBody);
+    S__completeCorrelation(lqc, actn, resultCode);
+}
+
+
+static void S__sendActionResponse(lqCloudDevice_t *lqc, const char *actnMsgId, lqcEventClass_t eventClass, const char *eventName, uint16_t resultCode, const char *responseBody)
 {
     char mqttTopic[LQMQ_TOPIC_PUB_MAXSZ];
     char actnClass[LQC_EVNTCLASS_SZ];
@@ -252,14 +962,10 @@ static void S__actionResponse(lqcEventClass_t eventClass, const char *eventName,
     PRINTF(0, "ActnRespBodySz=%d\r", strlen(responseBody));
 
     strncpy(actnClass, (eventClass == lqcEventClass_application) ? "appl":"lqc", 5);
-    //uint16_t msgId = mqtt_getLastMsgId(g_lqCloud.mqttCtrl);
 
     // "devices/%s/messages/events/mId=~%d&mV=1.0&evT=aRsp&aCId=%s&evC=%s&evN=%s&aRslt=%d"
-    snprintf(mqttTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicActionResponse, g_lqCloud.deviceCnfg->deviceId, ++g_lqCloud.lastMsgId, g_lqCloud.actnMsgId, actnClass, eventName, resultCode);
-    LQC_trySend(mqttTopic, responseBody, 0, false);
-
-    g_lqCloud.actnMsgId[0] = '\0';
-    g_lqCloud.actnResult = resultCode;
+    snprintf(mqttTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicActionResponse, lqc->deviceCnfg->deviceId, LQC_ATOMIC_INC(lqc->lastMsgId), actnMsgId, actnClass, eventName, resultCode);
+    LQC_trySend(lqc, mqttTopic, responseBody, 0, false);
 }
 
 #pragma endregion
@@ -268,33 +974,30 @@ static void S__actionResponse(lqcEventClass_t eventClass, const char *eventName,
 #pragma region LQ Cloud Built-In Action Functions
 
 /**
- *	\brief Generate and send action response about device actions 
+ *	\brief Send action response about device actions, with a cache buffer the catalogue is serialized once per registration change.
  */
-static void S__getActionInfoResponse()
+static void S__getActionInfoResponse(lqCloudDevice_t *lqc)
 {
-    char appActns[LQC__actionCnt * LQCACTN_BUF_SZ] = {0};
-    //char mqttBody[(LQCACTN_CNT * LQCACTN_BUF_SZ) + LQCACTN_CACTIONS_BODY_SZ] = {0};
-    char mqttBody[LQMQ_MSG_MAXSZ] = {0};
-
-    S_getApplActions(appActns, LQC__actionCnt * LQCACTN_BUF_SZ);
-    snprintf(mqttBody, (LQC__actionCnt * LQCACTN_BUF_SZ) + LQCACTN_LQCACTIONS_BODY_SZ, "{\"getactn\":"
-                    "{\"lqc\":["
-                    "{\"n\":\"getactn\",\"p\":\"\"},"
-                    "{\"n\":\"getntwk\",\"p\":\"\"},"
-                    "{\"n\":\"getdvc\",\"p\":\"\"},"
-                    "{\"n\":\"getdiag\",\"p\":\"reset=bool\"},"
-                    "{\"n\":\"setdname\",\"p\":\"name=text\"}"
-                    "],"
-                    "\"app\":[%s]}}", appActns);
-                
-    S__actionResponse(lqcEventClass_lqcloud, "getactn", resultCode__success, mqttBody);
+    if (lqc->actnInfo == NULL)                                              // no cache (lqc_setActionInfoCache()), build per request
+    {
+        char info[LQCACTN_INFO_SZ];
+        S__buildActionInfo(lqc, info, sizeof(info));
+        S__actionResponse(lqc, lqcEventClass_lqcloud, "getactn", resultCode__success, info);
+        return;
+    }
+    if (lqc->actnInfoLen == 0)
+    {
+        lqc->actnInfoLen = S__buildActionInfo(lqc, lqc->actnInfo, LQCACTN_INFO_SZ);
+        PRINTF(dbgColor__info, "ActnInfo cached, sz=%d\r", lqc->actnInfoLen);
+    }
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "getactn", resultCode__success, lqc->actnInfo);
 }
 
 
 /**
  *	\brief Generate and send action response about device 
  */
-static void S__getDeviceInfoResponse()
+static void S__getDeviceInfoResponse(lqCloudDevice_t *lqc)
 {
     char topic[LQMQ_TOPIC_PUB_MAXSZ] = {0};
     char body[LQMQ_MSG_MAXSZ] = {0};
@@ -302,28 +1005,28 @@ static void S__getDeviceInfoResponse()
     snprintf(body, 
              sizeof(body), 
              "{\"getdvc\": {\"dId\": \"%s\",\"codeVer\": \"LooUQ-Cloud MQTT v1.1\",\"msgVer\": \"1.0\"}}", 
-             g_lqCloud.deviceCnfg->deviceId);
-    S__actionResponse(lqcEventClass_lqcloud, "getdvc", resultCode__success, body);
+             lqc->deviceCnfg->deviceId);
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "getdvc", resultCode__success, body);
 }
 
 
 /**
  *	\brief Generate and send action response about device network 
  */
-static void S__getNetworkInfoResponse()
+static void S__getNetworkInfoResponse(lqCloudDevice_t *lqc)
 {
     char topic[LQMQ_TOPIC_PUB_MAXSZ] = {0};
     char body[LQMQ_MSG_MAXSZ] = {0};
 
     snprintf(body,sizeof(body), "{\"getntwk\": {\"ntwkType\": \"MQTT\",\"rssi\":%d}}", 0);
-    S__actionResponse(lqcEventClass_lqcloud, "getntwk", resultCode__success, body);
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "getntwk", resultCode__success, body);
 }
 
 
 /**
  *	\brief Gather LQCloud diagnostic struct members and notify user 
  */
-static void S__getCommMetricsInfoResponse(keyValueDict_t params)
+static void S__getCommMetricsInfoResponse(lqCloudDevice_t *lqc, keyValueDict_t params)
 {
     #define KVALUESZ 8
     char kValue[KVALUESZ] = {0};
@@ -335,21 +1038,73 @@ static void S__getCommMetricsInfoResponse(keyValueDict_t params)
     PRINTF(dbgColor__cyan, "resetStats: %s\r", kValue);
     resetDiags = atoi(kValue);
 
-    LQC_composeCommMetricsReport(body, sizeof(body));
-    S__actionResponse(lqcEventClass_lqcloud, "getCommMtrx", resultCode__success, body);
+    LQC_composeCommMetricsReport(lqc, body, sizeof(body));
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "getCommMtrx", resultCode__success, body);
 
     if (resetDiags)
     {
-        LQC_clearMetrics(lqcMetricsType_metrics);
-        LQC_clearMetrics(lqcMetricsType_diagnostics);
+        LQC_clearMetrics(lqc, lqcMetricsType_metrics);
+        LQC_clearMetrics(lqc, lqcMetricsType_diagnostics);
     }
 }
 
 
+/**
+ *	\brief Report application action execution statistics, optionally reset them.
+ */
+static void S__getActionStatsResponse(lqCloudDevice_t *lqc, keyValueDict_t params)
+{
+    #define KVALUESZ 8
+    char kValue[KVALUESZ] = {0};
+    char body[LQMQ_MSG_MAXSZ] = {0};
+    uint16_t bodyLen;
+
+    lq_getQryStrDictionaryValue("reset", params, kValue, KVALUESZ);
+    bool resetStats = atoi(kValue);
+
+    bodyLen = snprintf(body, sizeof(body), "{\"getactstat\":[");
+    for (size_t i = 0; i < LQC__actionCnt; i++)
+    {
+        lqcApplAction_t *applActn = &lqc->applActions[i];
+        if (applActn->name[0] == '\0')
+            continue;
+
+        char actnStats[140];
+        snprintf(actnStats, sizeof(actnStats), 
+                 "{\"n\":\"%s\",\"cnt\":%d,\"lst\":%d,\"max\":%d,\"bdgt\":%d,\"ovr\":%d,\"hist\":[%d,%d,%d,%d,%d,%d],\"rsp\":%lu,\"rspMax\":%lu},",
+                 applActn->name, applActn->execCnt, applActn->execLastMillis, applActn->execMaxMillis, applActn->budgetMillis, applActn->execOverBudgetCnt,
+                 applActn->execHistogram[0], applActn->execHistogram[1], applActn->execHistogram[2], 
+                 applActn->execHistogram[3], applActn->execHistogram[4], applActn->execHistogram[5],
+                 (unsigned long)applActn->rspLastMillis, (unsigned long)applActn->rspMaxMillis);
+
+        if (bodyLen + strlen(actnStats) + 3 >= sizeof(body))                // leave room for closing "]}"
+            break;
+        strcpy(body + bodyLen, actnStats);
+        bodyLen += strlen(actnStats);
+
+        if (resetStats)
+        {
+            applActn->execCnt = 0;
+            applActn->execLastMillis = 0;
+            applActn->execMaxMillis = 0;
+            applActn->execOverBudgetCnt = 0;
+            memset(applActn->execHistogram, 0, sizeof(applActn->execHistogram));
+            applActn->rspLastMillis = 0;
+            applActn->rspMaxMillis = 0;
+        }
+    }
+    if (body[bodyLen - 1] == ',')
+        bodyLen--;                                                          // drop trailing ','
+    strcpy(body + bodyLen, "]}");
+
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "getactstat", resultCode__success, body);
+}
+
+
 /**
  *	\brief Gather LQCloud diagnostic struct members and notify user 
  */
-static void S__setDeviceLabelResponse(keyValueDict_t params)
+static void S__setDeviceLabelResponse(lqCloudDevice_t *lqc, keyValueDict_t params)
 {
     #define KVALUESZ 8
     char kValue[KVALUESZ] = {0};
@@ -363,15 +1118,15 @@ static void S__setDeviceLabelResponse(keyValueDict_t params)
 
     if (kValLen != 0 && (kValLen < 3 || kValLen >= lqc__identity_deviceLabelSz))
     {
-        S__actionResponse(lqcEventClass_lqcloud, "setdname", resultCode__badRequest, "Invalid dname param, length must be 3 to 12 chars");
+        S__actionResponse(lqc, lqcEventClass_lqcloud, "setdname", resultCode__badRequest, "Invalid dname param, length must be 3 to 12 chars");
         return;
     }
 
     if (kValLen > 0)
-        strncpy(g_lqCloud.deviceCnfg->deviceLabel, kValue, lqc__identity_deviceLabelSz);
+        strncpy(lqc->deviceCnfg->deviceLabel, kValue, lqc__identity_deviceLabelSz);
 
-    S__actionResponse(lqcEventClass_lqcloud, "setdname", resultCode__success, g_lqCloud.deviceCnfg->deviceLabel);
-    PRINTF(dbgColor__info, "Device Label: %s\r", g_lqCloud.deviceCnfg->deviceLabel);
+    S__actionResponse(lqc, lqcEventClass_lqcloud, "setdname", resultCode__success, lqc->deviceCnfg->deviceLabel);
+    PRINTF(dbgColor__info, "Device Label: %s\r", lqc->deviceCnfg->deviceLabel);
 }
 
 #pragma endregion
@@ -51,6 +51,7 @@ extern lqCloudDevice_t g_lqCloud;
 /* Static Local Functions
 ------------------------------------------------------------------------------------------------ */
 static bool sendAlert(lqcEventClass_t evntClass, const char *evntName, const char *evntSummary, const char *message);
+static uint16_t S__composeDiagnostics(diagnosticInfo_t *diagInfo, char *buffer, uint16_t bufferSz);
 
 
 /* LooUQ Cloud Alerts
@@ -59,16 +60,18 @@ static bool sendAlert(lqcEventClass_t evntClass, const char *evntName, const cha
 /* As displayed in Azure IoT Explorer telemetry view
 {
   "body": {
-    "dvStart": {
+    "dBoot": {
       "dvcInfo": {
         "dId": "afdba032-138d-4cba-8218-6bf7f42b28e2",
-        "codeVer": "LooUQ-Cloud MQTT v1.1",
-        "msgVer": "1.0"
+        "reset": 1,
+        "codeVer": "LooUQ-CloudMQTTv1.1",
+        "msgVer": "1.1"
       },
       "ntwkInfo": {
         "ntwkType": "<network type>",
         "ntwkDetail": "<network info>"
-      }
+      },
+      "bootMs": 8412
     }
   },
   "enqueuedTime": "2020-08-01T17:38:18.046Z",
@@ -77,7 +80,7 @@ static bool sendAlert(lqcEventClass_t evntClass, const char *evntName, const cha
     "mV": "1.0",
     "mTyp": "alrt",
     "evC": "cloud",
-    "evN": "dvStart",
+    "evN": "dBoot",
     "evV": "afdba032-138d-4cba-8218-6bf7f42b28e2"
   }
 }
@@ -93,7 +96,16 @@ static bool sendAlert(lqcEventClass_t evntClass, const char *evntName, const cha
  */
 lqcSendResult_t lqc_sendAlert(const char *alrtName, const char *alrtSummary, const char *message)
 {
-    return LQC_sendAlert(lqcEventClass_application, alrtName, alrtSummary, message);
+    return LQC_sendAlert(&g_lqCloud, lqcEventClass_application, alrtName, alrtSummary, message);
+}
+
+
+/**
+ *	\brief Send alert message to LooUQ Cloud from a specific LQCloud instance.
+ */
+lqcSendResult_t lqcInst_sendAlert(lqcHandle_t lqc, const char *alrtName, const char *alrtSummary, const char *message)
+{
+    return LQC_sendAlert(lqc, lqcEventClass_application, alrtName, alrtSummary, message);
 }
 
 
@@ -103,27 +115,37 @@ lqcSendResult_t lqc_sendAlert(const char *alrtName, const char *alrtSummary, con
 #pragma region LQCloud Internal
 
 /**
- *	\brief Notify LQCloud device started (or recovered from off-line state).
+ *	\brief Notify LQCloud device started (or recovered from off-line state), one boot message sent through the send queue.
  * 
- *  \param [in] startType - Enum describing the device start conditions.
+ *  Body: device info, reset cause, network info, millis from boot to running and pending diagnostics (if any). Diagnostics 
+ *  are reported once, the diagnostics block is released when the message is sent or queued.
  */
-lqcSendResult_t LQC_sendDeviceStarted()
+lqcSendResult_t LQC_sendBootMessage(lqCloudDevice_t *lqc)
 {
     char summary[lqc__msg_summarySz] = {0};
     char body[lqc__msg_bodySz] = {0};
-    char restartDescr[18] = {0};
+    bool diagPending = lqc->diagnosticsInfo != NULL && lqc->diagnosticsInfo->diagMagic == assert__diagnosticsMagic;
 
     // summary is a simple C-string, body is a string formatted as a JSON object
-    snprintf(summary, sizeof(summary), "DeviceStart:%s",g_lqCloud.deviceCnfg->deviceId);
-    snprintf(body, 
-             sizeof(body), 
-             "{\"dvcInfo\":{\"dId\":\"%s\",\"reset\":%d,\"codeVer\":\"LooUQ-CloudMQTTv1.1\",\"msgVer\":\"1.0\"},\"ntwkInfo\":{\"ntwkType\":\"%s\",\"ntwkDetail\":\"%s\"}}",
-             g_lqCloud.deviceCnfg->deviceId, 
-             g_lqCloud.resetCause,
-             "MQTT", 
-             "TBD");
-
-    return LQC_sendAlert(lqcEventClass_lqcloud, "dStart", summary, body);
+    snprintf(summary, sizeof(summary), "DeviceBoot:%s", lqc->deviceCnfg->deviceId);
+    uint16_t bodyLen = snprintf(body, 
+                                sizeof(body), 
+                                "{\"dvcInfo\":{\"dId\":\"%s\",\"reset\":%d,\"codeVer\":\"LooUQ-CloudMQTTv1.1\",\"msgVer\":\"1.1\"},\"ntwkInfo\":{\"ntwkType\":\"%s\",\"ntwkDetail\":\"%s\"},\"bootMs\":%lu",
+                                lqc->deviceCnfg->deviceId, 
+                                lqc->resetCause,
+                                "MQTT", 
+                                "TBD",
+                                (unsigned long)lqc->bootMillis);
+
+    if (diagPending && bodyLen < sizeof(body))
+        bodyLen += S__composeDiagnostics(lqc->diagnosticsInfo, body + bodyLen, sizeof(body) - bodyLen);
+    if (bodyLen < sizeof(body) - 1)
+        strcat(body, "}");
+
+    lqcSendResult_t result = LQC_sendAlert(lqc, lqcEventClass_lqcloud, "dBoot", summary, body);
+    if (diagPending && result != lqcSendResult_dropped)
+        lqc->diagnosticsInfo = NULL;
+    return result;
 }
 
 
@@ -132,43 +154,25 @@ lqcSendResult_t LQC_sendDeviceStarted()
  * 
  *  \param diagInfo [in] - Struct containing both application and MCU fault conditions.
  */
-lqcSendResult_t LQC_sendDiagnosticsAlert(diagnosticInfo_t * diagInfo)
+lqcSendResult_t LQC_sendDiagnosticsAlert(lqCloudDevice_t *lqc, diagnosticInfo_t * diagInfo)
 {
+    if (diagInfo == NULL || diagInfo->diagMagic != assert__diagnosticsMagic)
+        return lqcSendResult_dropped;
 
-    if (diagInfo->diagMagic == assert__diagnosticsMagic)
-    {
-        char summary[lqc__msg_summarySz] = {0};
-        char body[lqc__msg_bodySz] = {0};
-
-        /*
-        Summary is a simple C-string
-        Body is a string formatted as a JSON object
-
-            {\"dId\":\"%s\",\"diag\":{
-            \"asrt\":{\"pc\":%d,\"lr\":%d,\"ln\":%d,\"fid\":%d},
-            \"app\":{\"comm\":%d,\"ntwk\":%d,\"sgnl\":%d},
-            \"hflt\":{\"ufsr\":%d,\"r0\":%d,\"r1\":%d,\"r2\":%d,\"r3\":%d,\"r12\":%d,\"ra\":%d,\"xpsr\":%d\"}}
-        */
-
-        snprintf(summary, sizeof(summary), "DeviceDiag:%s/%s (%d)", g_lqCloud.deviceCnfg->deviceId, g_lqCloud.deviceCnfg->deviceLabel, diagInfo->rcause);
-        snprintf(body, sizeof(body), 
-                "{\"dId\":\"%s\","
-                "\"diag\":{"
-                "\"asrt\":{\"ftg\":%s,\"pc\":%d,\"lr\":%d,\"ln\":%d},"
-                "\"app\":{\"comm\":%d,\"ntwk\":%d,\"sgnl\":%d},"
-                "\"hflt\":{\"ufsr\":%d,\"r0\":%d,\"r1\":%d,\"r2\":%d,\"r3\":%d,\"r12\":%d,\"ra\":%d,\"xpsr\":%d\"}"
-                "}",
-                g_lqCloud.deviceCnfg->deviceId, 
-                diagInfo->pc, diagInfo->lr, diagInfo->line, diagInfo->fileTag,
-                diagInfo->commState, diagInfo->ntwkState, diagInfo->signalState,
-                diagInfo->ufsr, diagInfo->r0, diagInfo->r1, diagInfo->r2, diagInfo->r3, diagInfo->r12, diagInfo->return_address, diagInfo->xpsr);
-
-        return LQC_sendAlert(lqcEventClass_lqcloud, "dDiag", summary, body);
-    }
+    char summary[lqc__msg_summarySz] = {0};
+    char body[lqc__msg_bodySz] = {0};
+
+    snprintf(summary, sizeof(summary), "DeviceDiag:%s/%s (%d)", lqc->deviceCnfg->deviceId, lqc->deviceCnfg->deviceLabel, diagInfo->rcause);
+    uint16_t bodyLen = snprintf(body, sizeof(body), "{\"dId\":\"%s\"", lqc->deviceCnfg->deviceId);
+    bodyLen += S__composeDiagnostics(diagInfo, body + bodyLen, sizeof(body) - bodyLen);
+    if (bodyLen < sizeof(body) - 1)
+        strcat(body, "}");
+
+    return LQC_sendAlert(lqc, lqcEventClass_lqcloud, "dDiag", summary, body);
 }
 
 
-lqcSendResult_t LQC_sendAlert(lqcEventClass_t alrtClass, const char *alrtName, const char *alrtSummary, const char *bodyJson)
+lqcSendResult_t LQC_sendAlert(lqCloudDevice_t *lqc, lqcEventClass_t alrtClass, const char *alrtName, const char *alrtSummary, const char *bodyJson)
 {
     char msgEvntName[lqc__msg_nameSz] = {0};
     char msgEvntSummary[lqc__msg_summarySz] = {0};
@@ -187,10 +191,43 @@ lqcSendResult_t LQC_sendAlert(lqcEventClass_t alrtClass, const char *alrtName, c
         snprintf(msgEvntSummary, sizeof(msgEvntSummary), "\"descr\": \"%s\",", alrtSummary);
 
     // "devices/%s/messages/events/mId=~%d&mV=1.0&evT=alrt&evC=%s&evN=%s"
-    snprintf(msgTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicAlert, g_lqCloud.deviceCnfg->deviceId, ++g_lqCloud.lastMsgId, eventClass, msgEvntName);
+    snprintf(msgTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicAlert, lqc->deviceCnfg->deviceId, LQC_ATOMIC_INC(lqc->lastMsgId), eventClass, msgEvntName);
     snprintf(msgBody, LQMQ_MSG_MAXSZ, "{%s\"alert\": %s}", msgEvntSummary, bodyJson);
-    return LQC_trySend(msgTopic, msgBody, 0, false);
+    if (lqc == &g_lqCloud)
+        LQC_requestConnect();                                               // alerts are urgent, open an on-demand connection now
+    return LQC_trySend(lqc, msgTopic, msgBody, 0, false);
 }
 
 
 #pragma endregion
+
+
+/* Static Local Functions
+================================================================================================ */
+#pragma region Static Local Functions
+
+/**
+ *	\brief Compose diagnostics JSON property (with leading comma) to append to an alert body object.
+ *  \return Length of text appended, truncated to bufferSz.
+ */
+static uint16_t S__composeDiagnostics(diagnosticInfo_t *diagInfo, char *buffer, uint16_t bufferSz)
+{
+    /*
+        ,"diag":{
+        "asrt":{"ftg":%d,"pc":%d,"lr":%d,"ln":%d},
+        "app":{"comm":%d,"ntwk":%d,"sgnl":%d},
+        "hflt":{"ufsr":%d,"r0":%d,"r1":%d,"r2":%d,"r3":%d,"r12":%d,"ra":%d,"xpsr":%d}}
+    */
+    int len = snprintf(buffer, bufferSz,
+                       ",\"diag\":{"
+                       "\"asrt\":{\"ftg\":%d,\"pc\":%d,\"lr\":%d,\"ln\":%d},"
+                       "\"app\":{\"comm\":%d,\"ntwk\":%d,\"sgnl\":%d},"
+                       "\"hflt\":{\"ufsr\":%d,\"r0\":%d,\"r1\":%d,\"r2\":%d,\"r3\":%d,\"r12\":%d,\"ra\":%d,\"xpsr\":%d}"
+                       "}",
+                       diagInfo->fileTag, diagInfo->pc, diagInfo->lr, diagInfo->line,
+                       diagInfo->commState, diagInfo->ntwkState, diagInfo->signalState,
+                       diagInfo->ufsr, diagInfo->r0, diagInfo->r1, diagInfo->r2, diagInfo->r3, diagInfo->r12, diagInfo->return_address, diagInfo->xpsr);
+    return (len < 0) ? 0 : MIN(len, bufferSz - 1);
+}
+
+#pragma endregion
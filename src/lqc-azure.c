@@ -2,6 +2,17 @@
 #define SRCFILE "AZR"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
 #include "lqc-internal.h"
 #include "lqc-azure.h"
+#include "lqc-sha256.h"
+#include "lqc-crc.h"
+
+extern lqCloudDevice_t g_lqCloud;
+static lqcSasToken_t S__sasToken;                                      // SAS token cache and renewal
+
+static void S__composeSasToken(uint32_t now);
+static uint32_t S__sasSourceCrc();
+static uint32_t S__parseSasExpiry(const char *signature);
+static uint8_t S__base64Decode(const char *src, uint8_t *dest, uint8_t destSz);
+static uint8_t S__base64UrlEncode(const uint8_t *src, uint8_t srcSz, char *dest, uint8_t destSz);
 
 
 void lqc_composeIothUserId(char *userId, uint8_t uidSz, const char* hostUrl, const char *deviceId)
@@ -58,3 +69,209 @@ void lqc_setDeviceConfigFromSASToken(const char* sasToken, lqcDeviceConfig_t * d
     }
 }
 
+
+/**
+ *	\brief Generate SAS token locally: sig = urlencode(base64(HMAC-SHA256(key, "<resource>\n<expiry>"))).
+ */
+bool lqc_generateIothSasToken(char *sasToken, uint16_t sasSz, const char* hostUrl, const char *deviceId, const uint8_t *key, uint8_t keySz, uint32_t expiry)
+{
+    // "SharedAccessSignature sr=<hostUrl>%2Fdevices%2F<deviceId>&sig=<signature>&se=<expiry>"
+    char stringToSign[lqc__identity_hostUrlSz + lqc__identity_deviceIdSz + 26];
+    uint8_t mac[lqcSha256__digestSz];
+    char signature[3 * 4 * ((lqcSha256__digestSz + 2) / 3) + 1];              // base64, URL encoded (worst case all %xx)
+
+    uint16_t resourceLen = snprintf(stringToSign, sizeof(stringToSign), "%s%%2Fdevices%%2F%s", hostUrl, deviceId);
+    uint16_t signLen = resourceLen + snprintf(stringToSign + resourceLen, sizeof(stringToSign) - resourceLen, "\n%lu", (unsigned long)expiry);
+    if (signLen >= sizeof(stringToSign))
+        return false;
+
+    lqcSha256_hmac(key, keySz, stringToSign, signLen, mac);
+    S__base64UrlEncode(mac, sizeof(mac), signature, sizeof(signature));
+    uint16_t tokenLen = snprintf(sasToken, sasSz, "SharedAccessSignature sr=%.*s&sig=%s&se=%lu", resourceLen, stringToSign, signature, (unsigned long)expiry);
+    return tokenLen < sasSz;
+}
+
+
+bool lqc_enableSasTokenRenewal(const char *deviceSasKey, lqcEpochTime_func epochTimeCB, uint32_t tokenTtlSecs)
+{
+    lqcSasToken_t *sas = &S__sasToken;
+
+    memset(sas, 0, sizeof(lqcSasToken_t));
+    sas->epochTimeCB = epochTimeCB;
+    sas->ttlSecs = (tokenTtlSecs > 0) ? tokenTtlSecs : LQC__sas_tokenTtlSecs;
+    if (deviceSasKey != NULL)
+    {
+        sas->keySz = S__base64Decode(deviceSasKey, sas->key, sizeof(sas->key));
+        if (sas->keySz == 0)
+            return false;
+    }
+    return true;
+}
+
+
+uint32_t lqc_getSasTokenExpiry()
+{
+    return S__sasToken.expiry;
+}
+
+
+/**
+ *	\brief Get the current SAS token (cached), composed only if not yet composed or the device config changed.
+ *  \details Renewal ahead of expiry is performed by LQC_doSasWork(), never on the connect path.
+ */
+const char *LQC_getSasToken()
+{
+    lqcSasToken_t *sas = &S__sasToken;
+
+    if (sas->token[0] == '\0' || S__sasSourceCrc() != sas->sourceCrc)          // device config replaced (reprovisioned)
+        S__composeSasToken((sas->epochTimeCB != NULL) ? sas->epochTimeCB() : 0);
+    return sas->token;
+}
+
+
+/**
+ *	\brief Renew SAS token ahead of expiry while the connection is idle (not connecting, no queued sends), off the connect path.
+ */
+void LQC_doSasWork()
+{
+    lqcSasToken_t *sas = &S__sasToken;
+
+    if (sas->epochTimeCB == NULL || g_lqCloud.deviceCnfg == NULL)
+        return;
+    if (g_lqCloud.connectInfo.state != lqcConnectState_idleClosed && g_lqCloud.connectInfo.state != lqcConnectState_messagingReady)
+        return;
+    if (g_lqCloud.recoveryQueue.queueCnt > 0)
+        return;
+
+    uint32_t now = sas->epochTimeCB();
+    if (now == 0 || (sas->expiry != 0 && now + LQC__sas_renewAheadSecs < sas->expiry))
+        return;
+
+    if (sas->keySz > 0)
+        S__composeSasToken(now);
+    else if (sas->expiry != 0 && now >= sas->expiry && !sas->expiredNotified)
+    {
+        sas->expiredNotified = true;                                            // no device key: application must reprovision
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_warn, "SAS token expired");
+    }
+}
+
+
+static void S__composeSasToken(uint32_t now)
+{
+    lqcSasToken_t *sas = &S__sasToken;
+    lqcDeviceConfig_t *cnfg = g_lqCloud.deviceCnfg;
+
+    sas->sourceCrc = S__sasSourceCrc();
+    sas->expiredNotified = false;
+    if (sas->keySz > 0 && now > 0)
+    {
+        uint32_t expiry = now + sas->ttlSecs;
+        if (lqc_generateIothSasToken(sas->token, sizeof(sas->token), cnfg->hostUrl, cnfg->deviceId, sas->key, sas->keySz, expiry))
+        {
+            sas->expiry = expiry;
+            return;
+        }
+    }
+    // no key (or time not known yet): token from config signature
+    lqc_composeIothSasToken(sas->token, sizeof(sas->token), cnfg->hostUrl, cnfg->deviceId, cnfg->signature);
+    sas->expiry = S__parseSasExpiry(cnfg->signature);
+}
+
+
+/**
+ *	\brief CRC of the device config fields (host\device\signature) a token is composed from, detects reprovisioning.
+ */
+static uint32_t S__sasSourceCrc()
+{
+    lqcDeviceConfig_t *cnfg = g_lqCloud.deviceCnfg;
+
+    uint32_t sourceCrc = lqcCrc_update(lqcCrc_init(), cnfg->hostUrl, strlen(cnfg->hostUrl));
+    sourceCrc = lqcCrc_update(sourceCrc, cnfg->deviceId, strlen(cnfg->deviceId));
+    return lqcCrc_final(lqcCrc_update(sourceCrc, cnfg->signature, strlen(cnfg->signature)));
+}
+
+
+static uint32_t S__parseSasExpiry(const char *signature)
+{
+    const char *expiry = strstr(signature, "se=");
+
+    if (expiry == NULL || (expiry != signature && expiry[-1] != '&'))
+        return 0;
+    return strtoul(expiry + 3, NULL, 10);
+}
+
+
+/**
+ *	\brief Decode base64 (standard alphabet, padded).
+ *  \return Bytes decoded, 0 if invalid or larger than destSz.
+ */
+static uint8_t S__base64Decode(const char *src, uint8_t *dest, uint8_t destSz)
+{
+    uint32_t bits = 0;
+    uint8_t bitCnt = 0;
+    uint8_t destLen = 0;
+
+    for (; *src != '\0' && *src != '='; src++)
+    {
+        uint8_t value;
+        if (*src >= 'A' && *src <= 'Z')
+            value = *src - 'A';
+        else if (*src >= 'a' && *src <= 'z')
+            value = *src - 'a' + 26;
+        else if (*src >= '0' && *src <= '9')
+            value = *src - '0' + 52;
+        else if (*src == '+')
+            value = 62;
+        else if (*src == '/')
+            value = 63;
+        else
+            return 0;
+
+        bits = (bits << 6) | value;
+        bitCnt += 6;
+        if (bitCnt >= 8)
+        {
+            if (destLen == destSz)
+                return 0;
+            bitCnt -= 8;
+            dest[destLen++] = (bits >> bitCnt) & 0xFF;
+        }
+    }
+    return destLen;
+}
+
+
+/**
+ *	\brief Encode base64 with URL encoding of the non-URL-safe characters (+, /, =) as the SAS sig= value.
+ *  \return Length of encoded string.
+ */
+static uint8_t S__base64UrlEncode(const uint8_t *src, uint8_t srcSz, char *dest, uint8_t destSz)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t destLen = 0;
+
+    for (uint8_t i = 0; i < srcSz; i += 3)
+    {
+        uint32_t triple = (src[i] << 16) | ((i + 1 < srcSz) ? src[i + 1] << 8 : 0) | ((i + 2 < srcSz) ? src[i + 2] : 0);
+        for (uint8_t j = 0; j < 4; j++)
+        {
+            char c = (i + j * 3 / 4 < srcSz) ? alphabet[(triple >> (18 - 6 * j)) & 0x3F] : '=';
+            const char *encoded = (c == '+') ? "%2B" : (c == '/') ? "%2F" : (c == '=') ? "%3D" : NULL;
+            uint8_t encodedLen = (encoded != NULL) ? 3 : 1;
+
+            if (destLen + encodedLen >= destSz)
+            {
+                dest[destLen] = '\0';
+                return destLen;
+            }
+            if (encoded != NULL)
+                memcpy(dest + destLen, encoded, 3);
+            else
+                dest[destLen] = c;
+            destLen += encodedLen;
+        }
+    }
+    dest[destLen] = '\0';
+    return destLen;
+}
@@ -65,6 +65,37 @@ static const char *IotHubTemplate_D2C_topicTelemetry = "devices/%s/messages/even
 static const char *IotHubTemplate_D2C_topicAlert = "devices/%s/messages/events/mId=~%d&mV=1.0&evT=alrt&evC=%s&evN=%s";
 static const char *IotHubTemplate_D2C_topicActionResponse = "devices/%s/messages/events/mId=~%d&mV=1.0&evT=aRsp&aCId=%s&evC=%s&evN=%s&aRslt=%d";
 
+
+/* Chunked Transfer Ack Properties Template
+ * %s = dId : device ID
+ * %d = mId : msg ID
+ * %s = xId : transfer ID
+ * %d = xSeq : next chunk sequence expected (cumulative ack, cloud resumes sending here)
+ * %d = xRslt : transfer result code (200 = in progress/complete)
+*/
+#define IOTHUB_MSG_D2CTOPIC_TRANSFERACK_TMPLT "devices/%s/messages/events/mId=~%d&mV=1.0&evT=xAck&xId=%s&xSeq=%d&xRslt=%d"
+static const char *IotHubTemplate_D2C_topicTransferAck = "devices/%s/messages/events/mId=~%d&mV=1.0&evT=xAck&xId=%s&xSeq=%d&xRslt=%d";
+
+
+/* HTTPS (REST) D2C Templates, fallback transport
+ * %s = device ID
+ * %s = property name, %s = property value : message (topic) properties as application properties
+*/
+#define IOTHUB_HTTP_D2CURL_TMPLT "/devices/%s/messages/events?api-version=2020-03-13"
+static const char *IotHubTemplate_http_D2CUrl = "/devices/%s/messages/events?api-version=2020-03-13";
+static const char *IotHubTemplate_http_appPropertyHdr = "iothub-app-%.*s: %.*s\r\n";
+
+
+/* HTTPS (REST) Sensor Data Pump Templates
+ * %s = device ID
+ * %s = etag : C2D message lock token (complete)
+*/
+#define IOTHUB_HTTP_C2DURL_TMPLT "/devices/%s/messages/deviceBound?api-version=2020-03-13"
+#define IOTHUB_HTTP_C2DCOMPLETEURL_TMPLT "/devices/%s/messages/deviceBound/%s?api-version=2020-03-13"
+static const char *IotHubTemplate_http_C2DUrl = "/devices/%s/messages/deviceBound?api-version=2020-03-13";
+static const char *IotHubTemplate_http_C2DCompleteUrl = "/devices/%s/messages/deviceBound/%s?api-version=2020-03-13";
+static const char *IotHubTemplate_http_batchContentType = "application/vnd.microsoft.iothub.json";
+
 #pragma endregion
 
 #endif  /* !__LQC_AZURE_H__ */
@@ -0,0 +1,384 @@
+/******************************************************************************
+ *  \file lqc-cnfgstore.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client Config Store
+ *
+ * See lqc-cnfgstore.h for the slot layout. Open validates both slots (CRC is
+ * streamed in small chunks, no slot buffer) and indexes the active slot's
+ * tags; reads then fetch only the requested value from the backend.
+ *****************************************************************************/
+
+#define SRCFILE "CFS"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include <string.h>
+#include "lqc-cnfgstore.h"
+#include "lqc-crc.h"
+
+#ifdef __linux__
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+
+enum
+{
+    S__crcSz = 4,
+    S__chunkSz = 32,                            // CRC\index read size while opening
+    S__tlvHdrSz = 2
+};
+
+
+#pragma region Static Local Declarations
+static bool S__indexSlot(const lqcCnfgStoreBackend_t *backend, uint8_t slot, lqcCnfgStore_t *candidate);
+static int8_t S__findTag(lqcCnfgStore_t *store, uint8_t tag);
+static uint32_t S__getU32(const uint8_t *src);
+static void S__putU32(uint8_t *dest, uint32_t value);
+static bool S__flashRead(void *context, uint8_t slot, uint16_t offset, void *data, uint16_t dataSz);
+static bool S__flashWrite(void *context, uint8_t slot, const void *image, uint16_t imageSz);
+#ifdef __linux__
+static bool S__fileRead(void *context, uint8_t slot, uint16_t offset, void *data, uint16_t dataSz);
+static bool S__fileWrite(void *context, uint8_t slot, const void *image, uint16_t imageSz);
+#endif
+#pragma endregion
+
+
+/* Public Functions
+------------------------------------------------------------------------------------------------ */
+#pragma region Public Functions
+
+void lqcCnfgStore_flashBackend(lqcCnfgStoreBackend_t *backend, lqcCnfgStoreFlash_t *flash)
+{
+    backend->read = S__flashRead;
+    backend->write = S__flashWrite;
+    backend->context = flash;
+}
+
+
+#ifdef __linux__
+void lqcCnfgStore_fileBackend(lqcCnfgStoreBackend_t *backend, lqcCnfgStoreFile_t *file, const char *basePath)
+{
+    snprintf(file->slotPath[0], sizeof(file->slotPath[0]), "%s.a", basePath);
+    snprintf(file->slotPath[1], sizeof(file->slotPath[1]), "%s.b", basePath);
+    backend->read = S__fileRead;
+    backend->write = S__fileWrite;
+    backend->context = file;
+}
+#endif
+
+
+/**
+ *	\brief Open store, the valid slot with the newest sequence is active.
+ */
+bool lqcCnfgStore_open(lqcCnfgStore_t *store, const lqcCnfgStoreBackend_t *backend)
+{
+    lqcCnfgStore_t candidate;
+
+    memset(store, 0, sizeof(lqcCnfgStore_t));
+    store->backend = backend;
+    store->activeSlot = lqcCnfgStore__noSlot;
+
+    for (uint8_t slot = 0; slot < 2; slot++)
+    {
+        if (!S__indexSlot(backend, slot, &candidate))
+            continue;
+        if (store->activeSlot == lqcCnfgStore__noSlot || (int32_t)(candidate.sequence - store->sequence) > 0)
+        {
+            memcpy(store, &candidate, sizeof(lqcCnfgStore_t));
+            store->backend = backend;
+            store->activeSlot = slot;
+        }
+    }
+    return store->activeSlot != lqcCnfgStore__noSlot;
+}
+
+
+uint16_t lqcCnfgStore_read(lqcCnfgStore_t *store, uint8_t tag, void *value, uint16_t valueSz)
+{
+    int8_t indx = S__findTag(store, tag);
+
+    if (indx < 0 || store->index[indx].len > valueSz)
+        return 0;
+    if (!store->backend->read(store->backend->context, store->activeSlot, store->index[indx].offset, value, store->index[indx].len))
+        return 0;
+    return store->index[indx].len;
+}
+
+
+bool lqcCnfgStore_readString(lqcCnfgStore_t *store, uint8_t tag, char *value, uint16_t valueSz)
+{
+    int8_t indx = S__findTag(store, tag);
+
+    if (indx < 0 || store->index[indx].len >= valueSz)                         // room for NULL
+        return false;
+    uint16_t len = lqcCnfgStore_read(store, tag, value, valueSz - 1);
+    value[len] = '\0';
+    return len == store->index[indx].len;
+}
+
+
+bool lqcCnfgStore_readUint(lqcCnfgStore_t *store, uint8_t tag, uint32_t *value)
+{
+    uint8_t bytes[4] = {0};
+    uint16_t len = lqcCnfgStore_read(store, tag, bytes, sizeof(bytes));
+
+    if (len == 0)
+        return false;
+    *value = S__getU32(bytes);                                                  // shorter values are zero extended
+    return true;
+}
+
+
+bool lqcCnfgStore_readDeviceConfig(lqcCnfgStore_t *store, lqcDeviceConfig_t *deviceConfig)
+{
+    uint32_t hostPort;
+
+    memset(deviceConfig, 0, sizeof(lqcDeviceConfig_t));
+    if (!lqcCnfgStore_readString(store, lqcCnfgTag_deviceId, deviceConfig->deviceId, sizeof(deviceConfig->deviceId)) ||
+        !lqcCnfgStore_readString(store, lqcCnfgTag_hostUrl, deviceConfig->hostUrl, sizeof(deviceConfig->hostUrl)) ||
+        !lqcCnfgStore_readString(store, lqcCnfgTag_signature, deviceConfig->signature, sizeof(deviceConfig->signature)))
+    {
+        memset(deviceConfig, 0, sizeof(lqcDeviceConfig_t));
+        return false;
+    }
+    lqcCnfgStore_readString(store, lqcCnfgTag_deviceLabel, deviceConfig->deviceLabel, sizeof(deviceConfig->deviceLabel));
+    deviceConfig->hostPort = lqcCnfgStore_readUint(store, lqcCnfgTag_hostPort, &hostPort) ? hostPort : lqc__connection_hostPort;
+
+    memcpy(deviceConfig->magicFlag, LQC_PROVISIONING_MAGICFLAG, strlen(LQC_PROVISIONING_MAGICFLAG));
+    memcpy(deviceConfig->packageId, LQC_DEVICECONFIG_PACKAGEID, strlen(LQC_DEVICECONFIG_PACKAGEID));
+    return true;
+}
+
+
+/**
+ *	\brief Update settings, the new image is written to the inactive slot and verified by re-opening the store.
+ */
+bool lqcCnfgStore_update(lqcCnfgStore_t *store, const lqcCnfgStoreItem_t *items, uint8_t itemCnt)
+{
+    uint8_t image[lqcCnfgStore__slotSz];
+    uint16_t imageSz = lqcCnfgStore__headerSz;
+    uint8_t tagCnt = 0;
+
+    for (uint8_t i = 0; i < store->tagCnt; i++)                                 // carry forward tags not being updated
+    {
+        bool replaced = false;
+        for (uint8_t j = 0; j < itemCnt; j++)
+            replaced |= (items[j].tag == store->index[i].tag);
+        if (replaced)
+            continue;
+        if (imageSz + S__tlvHdrSz + store->index[i].len + S__crcSz > lqcCnfgStore__slotSz)
+            return false;
+
+        image[imageSz] = store->index[i].tag;
+        image[imageSz + 1] = store->index[i].len;
+        if (!store->backend->read(store->backend->context, store->activeSlot, store->index[i].offset, image + imageSz + S__tlvHdrSz, store->index[i].len))
+            return false;
+        imageSz += S__tlvHdrSz + store->index[i].len;
+        tagCnt++;
+    }
+    for (uint8_t j = 0; j < itemCnt; j++)
+    {
+        if (items[j].value == NULL)                                             // removed
+            continue;
+        if (imageSz + S__tlvHdrSz + items[j].len + S__crcSz > lqcCnfgStore__slotSz || ++tagCnt > lqcCnfgStore__tagCnt)
+            return false;
+
+        image[imageSz] = items[j].tag;
+        image[imageSz + 1] = items[j].len;
+        memcpy(image + imageSz + S__tlvHdrSz, items[j].value, items[j].len);
+        imageSz += S__tlvHdrSz + items[j].len;
+    }
+
+    uint16_t payloadSz = imageSz - lqcCnfgStore__headerSz;
+    uint32_t sequence = store->sequence + 1;
+    uint8_t slot = (store->activeSlot == 0) ? 1 : 0;
+
+    S__putU32(image, lqcCnfgStore__magic);
+    image[4] = lqcCnfgStore__layoutVersion;
+    image[5] = 0;
+    image[6] = payloadSz & 0xFF;
+    image[7] = payloadSz >> 8;
+    S__putU32(image + 8, sequence);
+    S__putU32(image + imageSz, lqcCrc_compute(image, imageSz));
+    imageSz += S__crcSz;
+
+    const lqcCnfgStoreBackend_t *backend = store->backend;
+    if (!backend->write(backend->context, slot, image, imageSz))
+        return false;
+    return lqcCnfgStore_open(store, backend) && store->activeSlot == slot && store->sequence == sequence;
+}
+
+
+bool lqcCnfgStore_writeDeviceConfig(lqcCnfgStore_t *store, const lqcDeviceConfig_t *deviceConfig)
+{
+    uint8_t hostPort[2] = { deviceConfig->hostPort & 0xFF, deviceConfig->hostPort >> 8 };
+    lqcCnfgStoreItem_t items[] = 
+    {
+        { lqcCnfgTag_deviceId, strnlen(deviceConfig->deviceId, lqc__identity_deviceIdSz), deviceConfig->deviceId },
+        { lqcCnfgTag_deviceLabel, strnlen(deviceConfig->deviceLabel, lqc__identity_deviceLabelSz), deviceConfig->deviceLabel },
+        { lqcCnfgTag_hostUrl, strnlen(deviceConfig->hostUrl, lqc__identity_hostUrlSz), deviceConfig->hostUrl },
+        { lqcCnfgTag_hostPort, sizeof(hostPort), hostPort },
+        { lqcCnfgTag_signature, strnlen(deviceConfig->signature, lqc__identity_signatureSz), deviceConfig->signature }
+    };
+    return lqcCnfgStore_update(store, items, sizeof(items) / sizeof(lqcCnfgStoreItem_t));
+}
+
+#pragma endregion
+
+
+/* Static Local Functions
+------------------------------------------------------------------------------------------------ */
+#pragma region Static Local Functions
+
+/**
+ *	\brief Validate a slot (header, CRC) and index its TLVs in a single streamed pass.
+ */
+static bool S__indexSlot(const lqcCnfgStoreBackend_t *backend, uint8_t slot, lqcCnfgStore_t *candidate)
+{
+    uint8_t chunk[S__chunkSz];
+
+    memset(candidate, 0, sizeof(lqcCnfgStore_t));
+    if (!backend->read(backend->context, slot, 0, chunk, lqcCnfgStore__headerSz))
+        return false;
+    if (S__getU32(chunk) != lqcCnfgStore__magic || chunk[4] > lqcCnfgStore__layoutVersion)
+        return false;
+
+    candidate->payloadSz = chunk[6] | (chunk[7] << 8);
+    candidate->sequence = S__getU32(chunk + 8);
+    if (lqcCnfgStore__headerSz + candidate->payloadSz + S__crcSz > lqcCnfgStore__slotSz)
+        return false;
+
+    uint32_t crc = lqcCrc_update(lqcCrc_init(), chunk, lqcCnfgStore__headerSz);
+    uint16_t payloadEnd = lqcCnfgStore__headerSz + candidate->payloadSz;
+    uint16_t tlvAt = lqcCnfgStore__headerSz;                                    // next TLV header offset
+    uint8_t tag = 0;
+
+    for (uint16_t offset = lqcCnfgStore__headerSz; offset < payloadEnd; )
+    {
+        uint16_t chunkSz = MIN(S__chunkSz, payloadEnd - offset);
+        if (!backend->read(backend->context, slot, offset, chunk, chunkSz))
+            return false;
+        crc = lqcCrc_update(crc, chunk, chunkSz);
+
+        for (uint16_t i = 0; i < chunkSz; i++, offset++)                        // TLV headers may straddle chunks
+        {
+            if (offset == tlvAt)
+                tag = chunk[i];
+            else if (offset == tlvAt + 1)
+            {
+                if (candidate->tagCnt == lqcCnfgStore__tagCnt)
+                    return false;
+                candidate->index[candidate->tagCnt].tag = tag;
+                candidate->index[candidate->tagCnt].len = chunk[i];
+                candidate->index[candidate->tagCnt].offset = tlvAt + S__tlvHdrSz;
+                candidate->tagCnt++;
+                tlvAt += S__tlvHdrSz + chunk[i];
+            }
+        }
+    }
+    if (tlvAt != payloadEnd)                                                    // last TLV overruns payload
+        return false;
+
+    if (!backend->read(backend->context, slot, payloadEnd, chunk, S__crcSz))
+        return false;
+    return S__getU32(chunk) == lqcCrc_final(crc);
+}
+
+
+static int8_t S__findTag(lqcCnfgStore_t *store, uint8_t tag)
+{
+    if (store->activeSlot == lqcCnfgStore__noSlot)
+        return -1;
+    for (uint8_t i = 0; i < store->tagCnt; i++)
+    {
+        if (store->index[i].tag == tag)
+            return i;
+    }
+    return -1;
+}
+
+
+static uint32_t S__getU32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+
+static void S__putU32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = value & 0xFF;
+    dest[1] = (value >> 8) & 0xFF;
+    dest[2] = (value >> 16) & 0xFF;
+    dest[3] = value >> 24;
+}
+
+
+static bool S__flashRead(void *context, uint8_t slot, uint16_t offset, void *data, uint16_t dataSz)
+{
+    lqcCnfgStoreFlash_t *flash = (lqcCnfgStoreFlash_t *)context;
+    return flash->read(flash->slotAddress[slot] + offset, data, dataSz);
+}
+
+
+static bool S__flashWrite(void *context, uint8_t slot, const void *image, uint16_t imageSz)
+{
+    lqcCnfgStoreFlash_t *flash = (lqcCnfgStoreFlash_t *)context;
+    return flash->erase(flash->slotAddress[slot], lqcCnfgStore__slotSz) && 
+           flash->program(flash->slotAddress[slot], image, imageSz);
+}
+
+
+#ifdef __linux__
+static bool S__fileRead(void *context, uint8_t slot, uint16_t offset, void *data, uint16_t dataSz)
+{
+    lqcCnfgStoreFile_t *file = (lqcCnfgStoreFile_t *)context;
+    FILE *fp = fopen(file->slotPath[slot], "rb");
+
+    if (fp == NULL)
+        return false;
+    bool success = fseek(fp, offset, SEEK_SET) == 0 && fread(data, 1, dataSz, fp) == dataSz;
+    fclose(fp);
+    return success;
+}
+
+
+/**
+ *	\brief Write slot file by write\sync of a temp file and rename over the slot (atomic replace).
+ */
+static bool S__fileWrite(void *context, uint8_t slot, const void *image, uint16_t imageSz)
+{
+    lqcCnfgStoreFile_t *file = (lqcCnfgStoreFile_t *)context;
+    char tempPath[sizeof(file->slotPath[0]) + 4];
+
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", file->slotPath[slot]);
+    FILE *fp = fopen(tempPath, "wb");
+    if (fp == NULL)
+        return false;
+    bool success = fwrite(image, 1, imageSz, fp) == imageSz && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    fclose(fp);
+    return success && rename(tempPath, file->slotPath[slot]) == 0;
+}
+#endif
+
+#pragma endregion
@@ -0,0 +1,192 @@
+/******************************************************************************
+ *  \file lqc-cnfgstore.h
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ * LooUQ LQCloud Config Store: versioned binary store for LQCloud settings
+ *
+ * Settings (identity, host, signature, application tuning) are kept as a
+ * compact TLV list in one of two slots (A/B). Updates write the complete new
+ * image to the inactive slot with the next sequence number, the slot with the
+ * highest sequence and a valid CRC is active; an interrupted write leaves the
+ * prior slot in use. Unknown tags are skipped and preserved on update, so the
+ * layout can grow without breaking stored devices.
+ *
+ * Slot image: header | TLV payload (tag:u8, len:u8, value) | CRC-32 (header + payload)
+ *****************************************************************************/
+#ifndef __LQCLOUD_CNFGSTORE_H__
+#define __LQCLOUD_CNFGSTORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <lqcloud.h>
+
+
+enum lqcCnfgStore_constants
+{
+    lqcCnfgStore__magic = 0x5343514C,           /// "LQCS" little-endian, slot header valid
+    lqcCnfgStore__layoutVersion = 1,            /// header\TLV encoding version, newer layouts are not read
+    lqcCnfgStore__slotSz = 512,                 /// max image size (header + payload + CRC), backend slot size
+    lqcCnfgStore__headerSz = 12,
+    lqcCnfgStore__tagCnt = 24,                  /// max tags in a store (index entries)
+    lqcCnfgStore__valueMaxSz = 255,
+    lqcCnfgStore__noSlot = 0xFF
+};
+
+
+/** 
+ *  \brief Config store tags. Values are strings (no NULL stored) or little-endian integers.
+*/
+typedef enum lqcCnfgTag_tag
+{
+    lqcCnfgTag_deviceId = 1,
+    lqcCnfgTag_deviceLabel = 2,
+    lqcCnfgTag_hostUrl = 3,
+    lqcCnfgTag_hostPort = 4,                    /// uint16
+    lqcCnfgTag_signature = 5,
+    lqcCnfgTag_packageVersion = 6,              /// provisioning package version
+
+    lqcCnfgTag_appBase = 0x80                   /// application tuning parameters: lqcCnfgTag_appBase + n
+} lqcCnfgTag_t;
+
+
+/** 
+ *  \brief Storage backend, reads any range of a slot; writes a complete slot image (erase + program).
+*/
+typedef struct lqcCnfgStoreBackend_tag
+{
+    bool (*read)(void *context, uint8_t slot, uint16_t offset, void *data, uint16_t dataSz);
+    bool (*write)(void *context, uint8_t slot, const void *image, uint16_t imageSz);
+    void *context;
+} lqcCnfgStoreBackend_t;
+
+
+/** 
+ *  \brief Flash backend context: application flash functions and the two slot addresses (each lqcCnfgStore__slotSz, erase aligned).
+*/
+typedef struct lqcCnfgStoreFlash_tag
+{
+    bool (*erase)(uint32_t address, uint16_t size);
+    bool (*program)(uint32_t address, const void *data, uint16_t dataSz);
+    bool (*read)(uint32_t address, void *data, uint16_t dataSz);
+    uint32_t slotAddress[2];
+} lqcCnfgStoreFlash_t;
+
+
+/** 
+ *  \brief File backend context (Linux): slot files are <basePath>.a and <basePath>.b, replaced by rename.
+*/
+typedef struct lqcCnfgStoreFile_tag
+{
+    char slotPath[2][80];
+} lqcCnfgStoreFile_t;
+
+
+/** 
+ *  \brief Opened store: active slot and tag index, values are read from the backend on request.
+*/
+typedef struct lqcCnfgStore_tag
+{
+    const lqcCnfgStoreBackend_t *backend;
+    uint8_t activeSlot;                         /// lqcCnfgStore__noSlot if no valid slot
+    uint32_t sequence;
+    uint16_t payloadSz;
+    uint8_t tagCnt;
+    struct
+    {
+        uint8_t tag;
+        uint8_t len;
+        uint16_t offset;                        /// value offset in slot
+    } index[lqcCnfgStore__tagCnt];
+} lqcCnfgStore_t;
+
+
+/** 
+ *  \brief Setting to write with lqcCnfgStore_update(), a NULL value removes the tag.
+*/
+typedef struct lqcCnfgStoreItem_tag
+{
+    uint8_t tag;
+    uint8_t len;
+    const void *value;
+} lqcCnfgStoreItem_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ *  \brief Initialize flash backend over application flash functions.
+ */
+void lqcCnfgStore_flashBackend(lqcCnfgStoreBackend_t *backend, lqcCnfgStoreFlash_t *flash);
+
+#ifdef __linux__
+/**
+ *  \brief Initialize file backend, slot files are <basePath>.a and <basePath>.b.
+ */
+void lqcCnfgStore_fileBackend(lqcCnfgStoreBackend_t *backend, lqcCnfgStoreFile_t *file, const char *basePath);
+#endif
+
+/**
+ *  \brief Open store: select the newest valid slot and index its tags (values are not copied).
+ *  \return True if a valid slot was found, otherwise store is open and empty.
+ */
+bool lqcCnfgStore_open(lqcCnfgStore_t *store, const lqcCnfgStoreBackend_t *backend);
+
+/**
+ *  \brief Read a tag value.
+ *  \return Value length, 0 if tag not present or value larger than valueSz.
+ */
+uint16_t lqcCnfgStore_read(lqcCnfgStore_t *store, uint8_t tag, void *value, uint16_t valueSz);
+
+/**
+ *  \brief Read a string tag value into a NULL terminated buffer.
+ */
+bool lqcCnfgStore_readString(lqcCnfgStore_t *store, uint8_t tag, char *value, uint16_t valueSz);
+
+/**
+ *  \brief Read an integer tag value (1, 2 or 4 byte little-endian).
+ */
+bool lqcCnfgStore_readUint(lqcCnfgStore_t *store, uint8_t tag, uint32_t *value);
+
+/**
+ *  \brief Read the identity tags into an LQCloud device config (deviceId, label, host, port, signature).
+ */
+bool lqcCnfgStore_readDeviceConfig(lqcCnfgStore_t *store, lqcDeviceConfig_t *deviceConfig);
+
+/**
+ *  \brief Update settings: merge items with the active slot's tags and write the result to the inactive slot.
+ */
+bool lqcCnfgStore_update(lqcCnfgStore_t *store, const lqcCnfgStoreItem_t *items, uint8_t itemCnt);
+
+/**
+ *  \brief Write the identity tags from an LQCloud device config (also migrates a legacy raw struct record).
+ */
+bool lqcCnfgStore_writeDeviceConfig(lqcCnfgStore_t *store, const lqcDeviceConfig_t *deviceConfig);
+
+
+#ifdef __cplusplus
+}
+#endif // !__cplusplus
+
+#endif  /* !__LQCLOUD_CNFGSTORE_H__ */
@@ -0,0 +1,412 @@
+/******************************************************************************
+ *  \file lqc-coap.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client CoAP Transport
+ *
+ * D2C messages are CoAP POSTs to /<deviceId>/e, each topic property (mId,
+ * evT, evC, evN, ...) is a Uri-Query option. Confirmable requests are
+ * retransmitted with exponential backoff (RFC 7252 4.2) until acknowledged;
+ * piggybacked and separate responses are both accepted. Bodies larger than
+ * one block go as Block1 (RFC 7959) confirmable blocks. The application's
+ * yield callback runs while waiting, it is expected to pump UDP receive into
+ * lqcCoap_receive().
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "COA"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+
+enum coap_constants
+{
+    coap__version = 1,
+    coap__tokenSz = 4,
+
+    coapType_con = 0,
+    coapType_non = 1,
+    coapType_ack = 2,
+    coapType_rst = 3,
+
+    coapCode_empty = 0x00,
+    coapCode_post = 0x02,
+
+    coapOption_uriPath = 11,
+    coapOption_contentFormat = 12,
+    coapOption_uriQuery = 15,
+    coapOption_block1 = 27,
+    coapOption_size1 = 60,
+
+    coapFormat_json = 50
+};
+
+
+#pragma region Static Local Declarations
+static lqcCoapCtrl_t S__coap;                                         // CoAP exchange state (when CoAP is the send transport)
+static uint16_t S__composeRequest(uint8_t *dgram, uint16_t dgramSz, bool confirmable, const char *topic, const char *payload, uint16_t payloadSz, bool useBlock1, uint32_t block1, uint16_t size1);
+static bool S__appendOption(uint8_t *dgram, uint16_t *dgramLen, uint16_t dgramSz, uint16_t *lastOption, uint16_t option, const uint8_t *value, uint16_t valueLen);
+static uint8_t S__encodeUint(uint32_t value, uint8_t *encoded);
+static resultCode_t S__exchange(const uint8_t *dgram, uint16_t dgramSz, bool confirmable, uint32_t exchangeStart, uint32_t timeoutMillis);
+static void S__sendEmpty(uint8_t type, uint16_t msgId);
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Initialize CoAP transport, lqcCoap_sendMessage is then passed to lqc_create() as the send function.
+ *
+ *	\param [in] sendDatagramCB - Application UDP send function.
+ *  \param [in] confirmable - Confirmable (acknowledged) requests, false for non-confirmable.
+ */
+void lqcCoap_initTransport(lqcCoapSendDatagram_func sendDatagramCB, bool confirmable)
+{
+    lqcCoapCtrl_t *coap = &S__coap;
+
+    coap->sendDatagramCB = sendDatagramCB;
+    coap->confirmable = confirmable;
+    coap->msgId = (uint16_t)rand();                                             // RFC 7252: randomized initial message ID
+    coap->token = (uint32_t)rand() << 16 ^ pMillis();
+}
+
+
+/**
+ *	\brief Send D2C message by CoAP POST (lqcSendMessage_func).
+ *
+ *	\param [in] topic - Fully formed message topic.
+ *  \param [in] message - Message body.
+ *  \param [in] timeoutSec - Time allowed for the exchange, 0 = default.
+ *  \return resultCode__success on 2.xx response, otherwise HTTP style code.
+ */
+resultCode_t lqcCoap_sendMessage(const char *topic, const char *message, uint8_t timeoutSec)
+{
+    lqcCoapCtrl_t *coap = &S__coap;
+    uint8_t dgram[LQC__coap_datagramSz];
+    uint16_t msgSz = strlen(message);
+    uint32_t exchangeStart = pMillis();
+    uint32_t timeoutMillis = PERIOD_FROM_SECONDS(timeoutSec ? timeoutSec : LQC__publishDefaultTimeoutS);
+
+    ASSERT(coap->sendDatagramCB != NULL);
+    coap->token = coap->token * 1103515245 + 12345;                             // new token per request (all blocks share it)
+
+    if (msgSz <= LQC__coap_blockSz)
+    {
+        uint16_t dgramSz = S__composeRequest(dgram, sizeof(dgram), coap->confirmable, topic, message, msgSz, false, 0, 0);
+        if (dgramSz == 0)
+            return resultCode__badRequest;
+        return S__exchange(dgram, dgramSz, coap->confirmable, exchangeStart, timeoutMillis);
+    }
+
+    for (uint32_t blockNum = 0; blockNum * LQC__coap_blockSz < msgSz; blockNum++)                // block-wise, confirmable
+    {
+        uint16_t offset = blockNum * LQC__coap_blockSz;
+        uint16_t blockSz = MIN(LQC__coap_blockSz, msgSz - offset);
+        bool more = offset + blockSz < msgSz;
+        uint32_t block1 = (blockNum << 4) | (more << 3) | LQC__coap_blockSzx;
+
+        uint16_t dgramSz = S__composeRequest(dgram, sizeof(dgram), true, topic, message + offset, blockSz, true, block1, (blockNum == 0) ? msgSz : 0);
+        if (dgramSz == 0)
+            return resultCode__badRequest;
+
+        resultCode_t rslt = S__exchange(dgram, dgramSz, true, exchangeStart, timeoutMillis);      // 2.31 Continue, final block 2.04
+        if (rslt != resultCode__success)
+        {
+            PRINTF(dbgColor__warn, "CoAP: block %d failed, rslt=%d\r", blockNum, rslt);
+            return rslt;
+        }
+    }
+    return resultCode__success;
+}
+
+
+/**
+ *	\brief Application UDP receive, match acknowledgements and responses to the outstanding request.
+ *
+ *	\param [in] datagram - Received CoAP message.
+ *  \param [in] datagramSz - Size of datagram.
+ */
+void lqcCoap_receive(const uint8_t *datagram, uint16_t datagramSz)
+{
+    lqcCoapCtrl_t *coap = &S__coap;
+
+    if (datagramSz < 4 || (datagram[0] >> 6) != coap__version)
+        return;
+
+    uint8_t type = (datagram[0] >> 4) & 0x03;
+    uint8_t tokenSz = datagram[0] & 0x0F;
+    uint8_t code = datagram[1];
+    uint16_t msgId = (datagram[2] << 8) | datagram[3];
+
+    if (tokenSz > 8 || datagramSz < 4 + tokenSz)
+        return;
+
+    uint32_t token = 0;
+    if (tokenSz == coap__tokenSz)
+        token = (uint32_t)datagram[4] << 24 | (uint32_t)datagram[5] << 16 | (uint32_t)datagram[6] << 8 | datagram[7];
+    bool tokenMatch = (tokenSz == coap__tokenSz && token == coap->token);
+
+    if (type == coapType_ack && msgId == coap->msgId)
+    {
+        if (code == coapCode_empty)
+            coap->acked = true;                                                 // separate response to follow
+        else if (tokenMatch)
+        {
+            coap->rspCode = code;
+            coap->rspReceived = true;
+        }
+    }
+    else if ((type == coapType_con || type == coapType_non) && code >= 0x40 && tokenMatch)
+    {
+        coap->rspCode = code;                                                   // separate response
+        coap->rspReceived = true;
+        if (type == coapType_con)
+            S__sendEmpty(coapType_ack, msgId);
+    }
+    else if (type == coapType_con)
+        S__sendEmpty(coapType_rst, msgId);                                      // not expected, reject
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+/**
+ *	\brief Compose CoAP POST: /<deviceId>/e?<topic properties>, JSON content.
+ *  \return Datagram size, 0 if it does not fit.
+ */
+static uint16_t S__composeRequest(uint8_t *dgram, uint16_t dgramSz, bool confirmable, const char *topic, const char *payload, uint16_t payloadSz, bool useBlock1, uint32_t block1, uint16_t size1)
+{
+    lqcCoapCtrl_t *coap = &S__coap;
+    const char *deviceId = g_lqCloud.deviceCnfg->deviceId;
+    uint16_t len = 0;
+    uint16_t lastOption = 0;
+    uint8_t uintValue[4];
+
+    const char *props = strstr(topic, "/messages/events/");
+    if (props == NULL)
+        return 0;
+    props += 17;
+
+    coap->msgId++;
+    dgram[len++] = (coap__version << 6) | ((confirmable ? coapType_con : coapType_non) << 4) | coap__tokenSz;
+    dgram[len++] = coapCode_post;
+    dgram[len++] = coap->msgId >> 8;
+    dgram[len++] = coap->msgId & 0xFF;
+    dgram[len++] = coap->token >> 24;
+    dgram[len++] = coap->token >> 16;
+    dgram[len++] = coap->token >> 8;
+    dgram[len++] = coap->token & 0xFF;
+
+    if (!S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_uriPath, (const uint8_t *)deviceId, strlen(deviceId)) ||
+        !S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_uriPath, (const uint8_t *)"e", 1))
+        return 0;
+
+    uintValue[0] = coapFormat_json;
+    if (!S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_contentFormat, uintValue, 1))
+        return 0;
+
+    while (*props != '\0')                                                      // name=value&... as Uri-Query options
+    {
+        const char *propEnd = strchr(props, '&');
+        uint16_t propLen = propEnd ? (uint16_t)(propEnd - props) : (uint16_t)strlen(props);
+
+        if (propLen > 0 && !S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_uriQuery, (const uint8_t *)props, propLen))
+            return 0;
+        if (propEnd == NULL)
+            break;
+        props = propEnd + 1;
+    }
+
+    if (useBlock1)
+    {
+        if (!S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_block1, uintValue, S__encodeUint(block1, uintValue)))
+            return 0;
+        if (size1 > 0 && !S__appendOption(dgram, &len, dgramSz, &lastOption, coapOption_size1, uintValue, S__encodeUint(size1, uintValue)))
+            return 0;
+    }
+
+    if (payloadSz > 0)
+    {
+        if (len + 1 + payloadSz > dgramSz)
+            return 0;
+        dgram[len++] = 0xFF;                                                    // payload marker
+        memcpy(dgram + len, payload, payloadSz);
+        len += payloadSz;
+    }
+    return len;
+}
+
+
+/**
+ *	\brief Append option (delta encoded from previous option, options appended in ascending order).
+ */
+static bool S__appendOption(uint8_t *dgram, uint16_t *dgramLen, uint16_t dgramSz, uint16_t *lastOption, uint16_t option, const uint8_t *value, uint16_t valueLen)
+{
+    uint16_t delta = option - *lastOption;
+    uint16_t len = *dgramLen;
+    uint8_t ext[4];
+    uint8_t extLen = 0;
+    uint8_t deltaNibble, lenNibble;
+
+    if (delta < 13)
+        deltaNibble = delta;
+    else if (delta < 269)
+    {
+        deltaNibble = 13;
+        ext[extLen++] = delta - 13;
+    }
+    else
+    {
+        deltaNibble = 14;
+        ext[extLen++] = (delta - 269) >> 8;
+        ext[extLen++] = (delta - 269) & 0xFF;
+    }
+
+    if (valueLen < 13)
+        lenNibble = valueLen;
+    else if (valueLen < 269)
+    {
+        lenNibble = 13;
+        ext[extLen++] = valueLen - 13;
+    }
+    else
+    {
+        lenNibble = 14;
+        ext[extLen++] = (valueLen - 269) >> 8;
+        ext[extLen++] = (valueLen - 269) & 0xFF;
+    }
+
+    if (len + 1 + extLen + valueLen > dgramSz)
+        return false;
+
+    dgram[len++] = (deltaNibble << 4) | lenNibble;
+    memcpy(dgram + len, ext, extLen);
+    len += extLen;
+    memcpy(dgram + len, value, valueLen);
+    *dgramLen = len + valueLen;
+    *lastOption = option;
+    return true;
+}
+
+
+/**
+ *	\brief Encode option uint value, big-endian with leading zero bytes removed (0 is zero length).
+ *  \return Encoded length.
+ */
+static uint8_t S__encodeUint(uint32_t value, uint8_t *encoded)
+{
+    uint8_t len = 0;
+
+    for (int8_t shift = 24; shift >= 0; shift -= 8)
+    {
+        if (len > 0 || (value >> shift) & 0xFF)
+            encoded[len++] = (value >> shift) & 0xFF;
+    }
+    return len;
+}
+
+
+/**
+ *	\brief Send request and, if confirmable, await response; retransmit with exponential backoff until acknowledged.
+ */
+static resultCode_t S__exchange(const uint8_t *dgram, uint16_t dgramSz, bool confirmable, uint32_t exchangeStart, uint32_t timeoutMillis)
+{
+    lqcCoapCtrl_t *coap = &S__coap;
+    uint32_t ackTimeout = LQC__coap_ackTimeoutMillis + (rand() % (LQC__coap_ackTimeoutMillis / 2));    // ACK_RANDOM_FACTOR 1.5
+    uint8_t retransmits = 0;
+    uint32_t sentAt = 0;
+    bool transmit = true;
+
+    coap->acked = false;
+    coap->rspReceived = false;
+
+    if (!confirmable)
+        return (coap->sendDatagramCB(dgram, dgramSz) == resultCode__success) ? resultCode__success : resultCode__unavailable;
+
+    while (true)
+    {
+        if (transmit)
+        {
+            if (coap->sendDatagramCB(dgram, dgramSz) != resultCode__success)
+                return resultCode__unavailable;
+            sentAt = pMillis();
+            transmit = false;
+        }
+
+        if (g_lqCloud.yieldCB != NULL)
+            g_lqCloud.yieldCB();                                                // application services UDP receive
+
+        if (coap->rspReceived)
+        {
+            uint8_t rspClass = coap->rspCode >> 5;
+            return (rspClass == 2) ? resultCode__success : rspClass * 100 + (coap->rspCode & 0x1F);
+        }
+        if (wrkTime_isElapsed(exchangeStart, timeoutMillis))
+            return resultCode__timeout;
+
+        if (!coap->acked && wrkTime_isElapsed(sentAt, ackTimeout))
+        {
+            if (++retransmits > LQC__coap_maxRetransmit)
+                return resultCode__timeout;
+            PRINTF(dbgColor__warn, "CoAP: retransmit %d, mId=%d\r", retransmits, coap->msgId);
+            ackTimeout *= 2;
+            transmit = true;
+        }
+    }
+}
+
+
+/**
+ *	\brief Send empty ACK or RST for a received confirmable message.
+ */
+static void S__sendEmpty(uint8_t type, uint16_t msgId)
+{
+    uint8_t dgram[4];
+
+    dgram[0] = (coap__version << 6) | (type << 4);
+    dgram[1] = coapCode_empty;
+    dgram[2] = msgId >> 8;
+    dgram[3] = msgId & 0xFF;
+    S__coap.sendDatagramCB(dgram, sizeof(dgram));
+}
+
+#pragma endregion
@@ -0,0 +1,75 @@
+/******************************************************************************
+ *  \file lqc-coap.h
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ * LooUQ LQCloud CoAP (UDP) Transport
+ *
+ * Implements the lqcSendMessage_func contract over CoAP (RFC 7252) for low
+ * overhead sensors, no TCP or TLS session to establish per report. The UDP
+ * socket is owned by the application: datagrams out are passed to its send
+ * callback, datagrams in are handed to lqcCoap_receive().
+ *****************************************************************************/
+#ifndef __LQCLOUD_COAP_H__
+#define __LQCLOUD_COAP_H__
+
+#include <lqcloud.h>
+
+
+/** 
+ *  \brief Application function to transmit a CoAP datagram (UDP) to the LQCloud CoAP endpoint.
+*/
+typedef resultCode_t (*lqcCoapSendDatagram_func)(const uint8_t *datagram, uint16_t datagramSz);
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ *  \brief Initialize CoAP transport, then pass lqcCoap_sendMessage to lqc_create() as sendMessageCB.
+ *  \param [in] sendDatagramCB Application UDP send function.
+ *  \param [in] confirmable True to send confirmable (acknowledged, retransmitted) messages; false for non-confirmable.
+ *  \details Bodies larger than LQC__coap_blockSz are sent block-wise (Block1), always confirmable.
+ */
+void lqcCoap_initTransport(lqcCoapSendDatagram_func sendDatagramCB, bool confirmable);
+
+/**
+ *  \brief Send D2C message by CoAP POST, lqcSendMessage_func implementation.
+ *  \param [in] topic Fully formed message topic, properties are sent as Uri-Query options.
+ *  \param [in] message Message body (JSON).
+ *  \param [in] timeoutSec Time allowed for confirmable exchange (all blocks).
+ *  \return resultCode__success on 2.xx response (or non-confirmable sent), otherwise HTTP style code from CoAP response code.
+ */
+resultCode_t lqcCoap_sendMessage(const char *topic, const char *message, uint8_t timeoutSec);
+
+/**
+ *  \brief Application UDP receive, pass each datagram from the LQCloud CoAP endpoint.
+ */
+void lqcCoap_receive(const uint8_t *datagram, uint16_t datagramSz);
+
+
+#ifdef __cplusplus
+}
+#endif // !__cplusplus
+
+#endif  /* !__LQCLOUD_COAP_H__ */
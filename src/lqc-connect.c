@@ -0,0 +1,525 @@
+/******************************************************************************
+ *  \file lqc-connect.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ * LooUQ LQCloud Client Connection Manager
+ *
+ * Brings the cloud connection up (provider > network > MQTT open > connect >
+ * subscribe) one step per lqc_doWork() pass, so a reconnect never holds the
+ * application loop for the whole sequence. Each state has a timeout, a state
+ * not advancing within it is a stall and the sequence restarts after the
+ * retry interval.
+ *
+ * Session resume: connects with clean-session false so the broker keeps queued
+ * QoS1 C2D across connections. BGx does not surface the CONNACK session-present
+ * flag, so a session the broker discarded (expiry, hub restart) can't be told
+ * from a resumed one; the C2D topic is subscribed on every connect.
+ *
+ * HTTP fallback: MQTT failures (sends and connection faults) are tallied, at
+ * the threshold D2C moves to HTTPS. Reconnects continue at the probe interval
+ * without interface resets (HTTPS shares the modem); reaching messagingReady
+ * returns D2C to MQTT.
+ *
+ * On-demand mode: sends are queued while closed; a connection window opens on
+ * schedule or for urgent traffic (alerts), flushes the queue, is held open
+ * briefly for C2D, then closes and the application is told the radio can
+ * enter power save.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "CON"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+#define MAX(x, y) (((x)>(y)) ? (x):(y))
+
+
+#pragma region Static Local Declarations
+static void S__changeConnectState(lqcConnectState_t newState);
+static uint32_t S__stateTimeoutMillis(lqcConnectState_t state);
+static resultCode_t S__openMqtt();
+static void S__closeMqtt();
+static void S__openWindow();
+static void S__closeWindow();
+static void S__abandonWindow();
+static bool S__cloudWorkPending();
+static void S__connectionReady();
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Have LQCloud own the cloud connection, connecting (and reconnecting) from lqc_doWork().
+ *
+ *	\param [in] mqttCtrl - MQTT control for the LQCloud connection, initialized by application (mqtt_initControl).
+ *  \param [in] pdpContextId - Packet network (PDP) context used for the connection.
+ */
+void lqc_enableConnectionManager(mqttCtrl_t *mqttCtrl, uint8_t pdpContextId)
+{
+    g_lqCloud.connectInfo.mqttCtrl = mqttCtrl;
+    g_lqCloud.connectInfo.pdpContextId = pdpContextId;
+    g_lqCloud.connectInfo.faultCnt = 0;
+    g_lqCloud.connectInfo.lastStepAt = 0;
+    S__changeConnectState(lqcConnectState_idleClosed);
+}
+
+
+/**
+ *	\brief Sets connection mode for the managed cloud connection. Default is continuous.
+ *
+ *	\param [in] connectMode - Enum specifying the type of connection between the local device and the LQCloud.
+ *  \param [in] interConnectSecs - On-demand: seconds between scheduled connection windows, 0 = connect only for urgent sends
+ *  \param [in] holdConnectSecs - On-demand: seconds to hold a connection open after last activity, 0 = default
+ */
+void lqc_setConnectMode(lqcConnect_t connectMode, uint32_t interConnectSecs, uint16_t holdConnectSecs)
+{
+    ASSERT(connectMode == lqcConnect_mqttContinuous || connectMode == lqcConnect_mqttOnDemand);
+
+    g_lqCloud.connectInfo.connectMode = connectMode;
+    g_lqCloud.connectInfo.odc_interConnectMillis = PERIOD_FROM_SECONDS(interConnectSecs);
+    g_lqCloud.connectInfo.odc_holdConnectMillis = PERIOD_FROM_SECONDS(holdConnectSecs ? holdConnectSecs : LQC__connect_onDemandHoldSecs);
+    g_lqCloud.connectInfo.odc_disconnectAt = pMillis();
+}
+
+
+/**
+ *	\brief Connect with a persistent MQTT session, C2D sent while disconnected is delivered at reconnect.
+ *
+ *	\param [in] enable - True to use clean-session false and resume, false (default) for clean session each connect.
+ */
+void lqc_enableSessionResume(bool enable)
+{
+    g_lqCloud.connectInfo.sessionResume = enable;
+}
+
+
+/**
+ *	\brief Register application power save callback, invoked as on-demand connection windows open and close.
+ */
+void lqc_registerPowerSaveCallback(lqcPowerSave_func powerSaveCB)
+{
+    g_lqCloud.connectInfo.powerSaveCB = powerSaveCB;
+}
+
+
+/**
+ *	\brief Query for connectivity to the LQCloud.
+ *  \return Connection state, lqcConnectState_messagingReady when able to send and receive.
+ */
+lqcConnectState_t lqc_getConnectState()
+{
+    return g_lqCloud.connectInfo.state;
+}
+
+
+/**
+ *	\brief Get the time the connection has been in its current state.
+ *  \return Millis in the current state.
+ */
+uint32_t lqc_getConnectStateDuration()
+{
+    return pMillis() - g_lqCloud.connectInfo.stateEnteredAt;
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Advance the connection state machine, at most one connection step (network/modem request) per invoke.
+ *  Invoked from lqc_doWork().
+ */
+void LQC_manageConnection()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+
+    if (conn->mqttCtrl == NULL)                                                 // connection managed by application
+        return;
+
+    if (conn->state > lqcConnectState_idleClosed && conn->state < lqcConnectState_messagingReady &&
+        wrkTime_isElapsed(conn->stateEnteredAt, S__stateTimeoutMillis(conn->state)))
+    {
+        PRINTF(dbgColor__warn, "ConnMgr: stalled in state=%d\r", conn->state);
+        if (conn->state >= lqcConnectState_messagingOpen)
+            S__closeMqtt();
+        S__changeConnectState(lqcConnectState_connFault);
+        return;
+    }
+
+    if (LQC_httpFallbackActive() && wrkTime_isElapsed(g_lqCloud.recoveryQueue.lastTryAt, LQC__connect_stepIntervalMillis))
+        LQC_flushSendQueue(&g_lqCloud);                                         // queued D2C goes by HTTPS while MQTT is probed
+
+    if (conn->state != lqcConnectState_messagingReady && !wrkTime_isElapsed(conn->lastStepAt, LQC__connect_stepIntervalMillis))
+        return;                                                                 // pace step retries
+    conn->lastStepAt = pMillis();
+
+    switch (conn->state)
+    {
+        case lqcConnectState_idleClosed:
+        {
+            if (conn->connectMode == lqcConnect_mqttOnDemand && !conn->connectRequested)
+            {
+                if (conn->odc_interConnectMillis == 0 || !wrkTime_isElapsed(conn->odc_disconnectAt, conn->odc_interConnectMillis))
+                    break;                                                      // radio sleeping until scheduled window (or urgent send)
+                S__openWindow();
+            }
+            providerInfo_t *provider = lqcNtwk_awaitProvider(0);                // poll, don't wait
+            if (provider != NULL && strlen(provider->name) > 0)
+                S__changeConnectState(lqcConnectState_providerReady);
+            else if (wrkTime_isElapsed(conn->stateEnteredAt, PERIOD_FROM_SECONDS(LQC__connect_providerTimeoutSecs)))
+                S__changeConnectState(lqcConnectState_connFault);
+            break;
+        }
+
+        case lqcConnectState_providerReady:
+        {
+            networkInfo_t *network = lqcNtwk_activateNetwork(conn->pdpContextId);
+            if (network != NULL && network->isActive)
+                S__changeConnectState(lqcConnectState_networkReady);
+            break;
+        }
+
+        case lqcConnectState_networkReady:
+            if (S__openMqtt() == resultCode__success)
+                S__changeConnectState(lqcConnectState_messagingOpen);
+            break;
+
+        case lqcConnectState_messagingOpen:
+        {
+            resultCode_t rslt = mqtt_connect(conn->mqttCtrl, !conn->sessionResume);
+            if (rslt == resultCode__success)
+            {
+                if (conn->sessionResume)
+                    g_lqCloud.commMetrics.sessionResumes++;
+                else
+                    g_lqCloud.commMetrics.sessionFullSetups++;
+                S__changeConnectState(lqcConnectState_messagingConnected);      // subscribe every connect, session may not have survived
+            }
+            else if (rslt == resultCode__forbidden || rslt == resultCode__badRequest || rslt == resultCode__unavailable)
+            {
+                LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_fault_hardFault, (rslt == resultCode__forbidden) ? "Not Authorized" : "Invalid Settings");
+                S__closeMqtt();
+                S__changeConnectState(lqcConnectState_connFault);
+            }
+            break;
+        }
+
+        case lqcConnectState_messagingConnected:
+        {
+            char recvTopic[mqtt__topic_nameSz];
+            snprintf(recvTopic, sizeof(recvTopic), IoTHubTemplate_C2D_recvTopic, g_lqCloud.deviceCnfg->deviceId);
+
+            if (mqtt_subscribe(conn->mqttCtrl, recvTopic, mqttQos_1) == resultCode__success)
+                S__connectionReady();
+            break;
+        }
+
+        case lqcConnectState_messagingReady:
+        {
+            bool queueEmpty = LQC_flushSendQueue(&g_lqCloud);                   // one queued message per pass
+
+            if (g_lqCloud.commMetrics.consecutiveSendFails >= LQC__send_resetAtConsecutiveFailures)
+                S__changeConnectState(lqcConnectState_sendFault);
+
+            else if (wrkTime_isElapsed(conn->linkCheckAt, PERIOD_FROM_SECONDS(LQC__connect_linkCheckSecs)))
+            {
+                conn->linkCheckAt = pMillis();
+                if (mqtt_getStatus(conn->mqttCtrl) < mqttState_connected)       // receive-only device: no send failure to detect it
+                {
+                    PRINTF(dbgColor__warn, "ConnMgr: MQTT link lost\r");
+                    S__changeConnectState(lqcConnectState_sendFault);
+                }
+            }
+
+            else if (conn->connectMode == lqcConnect_mqttOnDemand && queueEmpty && !S__cloudWorkPending() && 
+                     wrkTime_isElapsed(conn->odc_activityAt, conn->odc_holdConnectMillis))
+                S__closeWindow();
+            break;
+        }
+
+        case lqcConnectState_sendFault:
+            PRINTF(dbgColor__warn, "ConnMgr: send failures or link lost, reconnecting\r");
+            S__closeMqtt();
+            g_lqCloud.commMetrics.connectResets++;
+            LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_ntwk_disconnected, "");
+            S__changeConnectState(lqcConnectState_idleClosed);                  // reconnect immediately
+            break;
+
+        case lqcConnectState_connFault:
+        {
+            bool httpCarrying = LQC_httpFallbackActive() && g_lqCloud.commMetrics.consecutiveSendFails == 0;
+            uint32_t retrySecs = LQC_httpFallbackActive() ? LQC__transport_probeIntervalSecs : LQC__connection_retryIntervalSecs;
+
+            if (wrkTime_isElapsed(conn->stateEnteredAt, PERIOD_FROM_SECONDS(retrySecs)))
+            {
+                if (++conn->faultCnt >= LQC__connectionRetryCnt && !httpCarrying)      // repeated failures, reset the interface
+                {
+                    PRINTF(dbgColor__warn, "ConnMgr: resetting interface\r");
+                    lqcNtwk_resetIntf(resetAction_swReset);
+                    g_lqCloud.commMetrics.connectResets++;
+                    conn->faultCnt = 0;
+                }
+                if (conn->connectMode == lqcConnect_mqttOnDemand && ++conn->odc_windowFaultCnt >= LQC__connect_windowFaultCnt)
+                    S__abandonWindow();                                         // radio back to sleep, retried at next window (or urgent send)
+                else
+                    S__changeConnectState(lqcConnectState_idleClosed);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ *	\brief Millis until the connection manager next has a step, retry, window open/close or queued send to perform.
+ */
+uint32_t LQC_connectNextWakeup()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+    uint32_t stepWait = LQC_millisUntil(conn->lastStepAt, LQC__connect_stepIntervalMillis);
+    uint32_t wakeup = LQC_WAKEUP_NONE;
+
+    if (conn->mqttCtrl == NULL)                                                 // connection managed by application
+        return LQC_WAKEUP_NONE;
+
+    if (LQC_httpFallbackActive() && g_lqCloud.recoveryQueue.queueCnt > 0)
+        wakeup = LQC_millisUntil(g_lqCloud.recoveryQueue.lastTryAt, LQC__connect_stepIntervalMillis);
+
+    switch (conn->state)
+    {
+        case lqcConnectState_idleClosed:
+            if (conn->connectMode == lqcConnect_mqttOnDemand && !conn->connectRequested)
+            {
+                if (conn->odc_interConnectMillis != 0)                          // next scheduled window
+                    wakeup = MIN(wakeup, MAX(stepWait, LQC_millisUntil(conn->odc_disconnectAt, conn->odc_interConnectMillis)));
+                return wakeup;
+            }
+            return MIN(wakeup, stepWait);
+
+        case lqcConnectState_messagingReady:
+            if (g_lqCloud.recoveryQueue.queueCnt > 0 || g_lqCloud.commMetrics.consecutiveSendFails >= LQC__send_resetAtConsecutiveFailures)
+                return 0;
+            if (conn->connectMode == lqcConnect_mqttOnDemand)                   // window close after hold
+                wakeup = MIN(wakeup, LQC_millisUntil(conn->odc_activityAt, conn->odc_holdConnectMillis));
+            return MIN(wakeup, LQC_millisUntil(conn->linkCheckAt, PERIOD_FROM_SECONDS(LQC__connect_linkCheckSecs)));
+
+        case lqcConnectState_connFault:
+        {
+            uint32_t retrySecs = LQC_httpFallbackActive() ? LQC__transport_probeIntervalSecs : LQC__connection_retryIntervalSecs;
+            return MIN(wakeup, MAX(stepWait, LQC_millisUntil(conn->stateEnteredAt, PERIOD_FROM_SECONDS(retrySecs))));
+        }
+
+        default:                                                                // connecting (stall timeouts exceed step pacing), sendFault
+            return MIN(wakeup, stepWait);
+    }
+}
+
+
+/**
+ *	\brief Urgent traffic, open an on-demand connection window now (no effect in continuous mode).
+ */
+void LQC_requestConnect()
+{
+    if (LQC_workerRunning() && !LQC_onWorkerThread())
+    {
+        LQC_workerRequestConnect();                                         // worker mode: connection state is owned by the worker
+        return;
+    }
+    if (g_lqCloud.connectInfo.connectMode == lqcConnect_mqttOnDemand && g_lqCloud.connectInfo.state != lqcConnectState_messagingReady)
+        S__openWindow();
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+/**
+ *	\brief Connection is open and subscribed (or resumed), ready for cloud traffic.
+ */
+static void S__connectionReady()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+
+    conn->faultCnt = 0;
+    conn->connectRequested = false;
+    conn->odc_windowFaultCnt = 0;
+    conn->odc_activityAt = pMillis();
+    conn->linkCheckAt = pMillis();
+    g_lqCloud.commMetrics.consecutiveSendFails = 0;
+    S__changeConnectState(lqcConnectState_messagingReady);
+    LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_ntwk_connected, "");
+}
+
+
+/**
+ *	\brief Update the LQC connection state and timestamp the change.
+ */
+static void S__changeConnectState(lqcConnectState_t newState)
+{
+    PRINTF(dbgColor__info, "ConnMgr: state %d > %d (%lums)\r", g_lqCloud.connectInfo.state, newState, pMillis() - g_lqCloud.connectInfo.stateEnteredAt);
+    g_lqCloud.connectInfo.state = newState;
+    g_lqCloud.connectInfo.stateEnteredAt = pMillis();
+    g_lqCloud.isOnline = (newState == lqcConnectState_messagingReady);
+
+    if (newState == lqcConnectState_connFault)
+        LQC_trackMqttFailure();
+    else if (newState == lqcConnectState_messagingReady)
+        LQC_resumeMqtt();
+}
+
+
+/**
+ *	\brief Time allowed a connecting state to advance, before it is considered stalled.
+ */
+static uint32_t S__stateTimeoutMillis(lqcConnectState_t state)
+{
+    switch (state)
+    {
+        case lqcConnectState_providerReady:
+            return PERIOD_FROM_SECONDS(LQC__connect_networkTimeoutSecs);
+        case lqcConnectState_networkReady:
+        case lqcConnectState_messagingOpen:
+        case lqcConnectState_messagingConnected:
+            return PERIOD_FROM_SECONDS(LQC__connect_messagingTimeoutSecs);      // BGx MQTT open/connect is known to stall
+        default:
+            return PERIOD_FROM_SECONDS(LQC__connect_providerTimeoutSecs);
+    }
+}
+
+
+/**
+ *	\brief Set MQTT connection (Azure IoTHub credentials) and open the MQTT session.
+ */
+static resultCode_t S__openMqtt()
+{
+    lqcDeviceConfig_t *cnfg = g_lqCloud.deviceCnfg;
+    char userId[lqc__identity_userIdSz];
+
+    lqc_composeIothUserId(userId, sizeof(userId), cnfg->hostUrl, cnfg->deviceId);
+    mqtt_setConnection(g_lqCloud.connectInfo.mqttCtrl, cnfg->hostUrl, lqc__connection_hostPort, true, mqttVersion_311, cnfg->deviceId, userId, LQC_getSasToken());
+
+    resultCode_t rslt = mqtt_open(g_lqCloud.connectInfo.mqttCtrl);
+    if (rslt == resultCode__badRequest || rslt == resultCode__notFound)
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_fault_hardFault, "Invalid Settings");
+    else if (rslt != resultCode__success)
+        PRINTF(dbgColor__warn, "ConnMgr: MQTT open rslt=%d\r", rslt);
+    return rslt;
+}
+
+
+static void S__closeMqtt()
+{
+    mqtt_close(g_lqCloud.connectInfo.mqttCtrl);
+}
+
+
+/**
+ *	\brief On-demand: start a connection window, application wakes radio from power save.
+ */
+static void S__openWindow()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+
+    if (conn->connectRequested)
+        return;
+    conn->connectRequested = true;
+    conn->odc_windowFaultCnt = 0;
+    if (conn->state == lqcConnectState_idleClosed)
+        conn->stateEnteredAt = pMillis();                                       // provider wait timed from window open, not last close
+    PRINTF(dbgColor__info, "ConnMgr: on-demand window opening\r");
+    if (conn->powerSaveCB)
+        conn->powerSaveCB(lqcPowerSave_wake);
+}
+
+
+/**
+ *	\brief On-demand: end the connection window, application can put radio into power save (PSM/eDRX).
+ */
+static void S__closeWindow()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+
+    PRINTF(dbgColor__info, "ConnMgr: on-demand window closing, open %lums\r", pMillis() - conn->stateEnteredAt);
+    S__closeMqtt();
+    conn->odc_disconnectAt = pMillis();
+    S__changeConnectState(lqcConnectState_idleClosed);
+    LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_ntwk_disconnected, "");
+    if (conn->powerSaveCB)
+        conn->powerSaveCB(lqcPowerSave_sleep);
+}
+
+
+/**
+ *	\brief On-demand: window could not connect (LQC__connect_windowFaultCnt faults), end it without waiting for a connection.
+ */
+static void S__abandonWindow()
+{
+    lqcConnectInfo_t *conn = &g_lqCloud.connectInfo;
+
+    PRINTF(dbgColor__warn, "ConnMgr: on-demand window abandoned after %d faults\r", conn->odc_windowFaultCnt);
+    conn->connectRequested = false;
+    conn->odc_windowFaultCnt = 0;
+    conn->odc_disconnectAt = pMillis();
+    S__changeConnectState(lqcConnectState_idleClosed);
+    if (conn->powerSaveCB)
+        conn->powerSaveCB(lqcPowerSave_sleep);
+}
+
+
+/**
+ *	\brief Cloud interaction in progress that the connection must stay open for (actions, transfer).
+ */
+static bool S__cloudWorkPending()
+{
+    if (g_lqCloud.actnQueue.count > 0 || g_lqCloud.actnQueue.rejectCount > 0 || LQC_transferPending())
+        return true;
+    if (LQC_gatewaySendPending())
+        return true;
+
+    for (size_t i = 0; i < LQC__actionPendingCnt; i++)
+    {
+        if (g_lqCloud.actnPending[i].inUse)
+            return true;
+    }
+    return false;
+}
+
+#pragma endregion
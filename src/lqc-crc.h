@@ -0,0 +1,77 @@
+/******************************************************************************
+ *  \file lqc-crc.h
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ * LooUQ LQCloud CRC-32 (IEEE 802.3, reflected: zlib/Ethernet compatible)
+ *
+ * Incremental init/update/final over binary data, shared by provisioning and
+ * chunked transfers. Implementation selected at build time (define one):
+ *   LQC_CRC_NIBBLE   - 16 entry table, 64 bytes flash (smallest)
+ *   LQC_CRC_TABLE256 - 256 entry table, 1KB flash (MCU default)
+ *   LQC_CRC_SLICE8   - slice-by-8, 8KB RAM tables built on first use (host default)
+ *   LQC_CRC_SAMD_DSU - SAMD21 Device Service Unit hardware CRC, word aligned 
+ *                      runs by DSU, remainder by table
+ * ARMv8 hosts with CRC32 instructions (__ARM_FEATURE_CRC32) use them by default.
+ *****************************************************************************/
+#ifndef __LQCLOUD_CRC_H__
+#define __LQCLOUD_CRC_H__
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ *  \brief Start a CRC-32 computation.
+ *  \return Initial CRC register value.
+ */
+uint32_t lqcCrc_init();
+
+/**
+ *  \brief Add data to a CRC-32 computation, may be invoked any number of times (streamed input).
+ *  \param [in] crc Value from lqcCrc_init() or prior lqcCrc_update().
+ *  \param [in] data Data to add.
+ *  \param [in] dataSz Number of bytes.
+ *  \return Updated CRC register value.
+ */
+uint32_t lqcCrc_update(uint32_t crc, const void *data, uint32_t dataSz);
+
+/**
+ *  \brief Complete a CRC-32 computation.
+ *  \return CRC-32 of all data added.
+ */
+uint32_t lqcCrc_final(uint32_t crc);
+
+/**
+ *  \brief CRC-32 of a complete buffer (init, update, final).
+ */
+uint32_t lqcCrc_compute(const void *data, uint32_t dataSz);
+
+
+#ifdef __cplusplus
+}
+#endif // !__cplusplus
+
+#endif  /* !__LQCLOUD_CRC_H__ */
@@ -0,0 +1,338 @@
+/******************************************************************************
+ *  \file lqc-gateway.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client Gateway Mode
+ *
+ * One upstream connection (the default instance) carries D2C and C2D traffic
+ * for many child devices, each child is an LQCloud instance with its own
+ * identity, actions and send queue. Children are kept in an application
+ * supplied table, open addressed (linear probe) by a hash of the device ID
+ * for constant time lookup when demultiplexing C2D. IoT Hub only lets a
+ * connection use its own device's topics, so child traffic is carried on the
+ * gateway's topics with the child's device ID in the cId message property.
+ * Child sends are always queued and go upstream round-robin, one message per
+ * child per turn, so a busy child cannot starve the others.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "GWY"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+
+
+#pragma region Static Local Declarations
+static lqcGateway_t S__gateway;                                       // child registry, enabled by lqc_enableGateway()
+static lqcGatewayChild_t *S__findChild(const char *deviceId, uint16_t idLen);
+static bool S__upstreamReady();
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Enable gateway mode, the default instance's connection carries traffic for child device instances.
+ *
+ *	\param [in] childTable - Application table for child registry, size ~1.33x the number of children (lookup stays fast).
+ *  \param [in] childTableSz - Number of entries in childTable.
+ */
+void lqc_enableGateway(lqcGatewayChild_t *childTable, uint16_t childTableSz)
+{
+    ASSERT(childTable != NULL && childTableSz > 0);
+
+    memset(childTable, 0, childTableSz * sizeof(lqcGatewayChild_t));
+    S__gateway.children = childTable;
+    S__gateway.tableSz = childTableSz;
+    S__gateway.childCnt = 0;
+    S__gateway.cursor = 0;
+    S__gateway.actionCursor = 0;
+}
+
+
+/**
+ *	\brief Register a child device, sends from the child instance go upstream over the gateway connection.
+ *
+ *	\param [in] childLqc - Child instance (lqc_createInstance()), its device config holds the child's device ID.
+ *  \param [in] queueBuffer - Child send queue buffer, child messages wait here for their upstream turn.
+ *  \param [in] queueBufferSz - Size of queueBuffer.
+ *  \return True if registered; false if table is full (75% load) or child already registered.
+ */
+bool lqc_gatewayAddChild(lqcHandle_t childLqc, char *queueBuffer, uint16_t queueBufferSz)
+{
+    lqcGateway_t *gw = &S__gateway;
+    const char *deviceId = childLqc->deviceCnfg->deviceId;
+    uint16_t idLen = strlen(deviceId);
+
+    if (gw->children == NULL || gw->childCnt >= gw->tableSz - gw->tableSz / 4 || S__findChild(deviceId, idLen) != NULL)
+        return false;
+
+    uint32_t idHash = LQC_hashKey(deviceId, idLen);
+    uint16_t slot = idHash % gw->tableSz;
+    while (gw->children[slot].idHash != 0)
+        slot = (slot + 1) % gw->tableSz;
+
+    gw->children[slot].idHash = idHash;
+    gw->children[slot].lqc = childLqc;
+    gw->childCnt++;
+
+    childLqc->isGatewayChild = true;
+    childLqc->sendMessageCB = g_lqCloud.sendMessageCB;                      // upstream connection, cId property carries child identity
+    childLqc->recoveryQueue.queueBuffer = queueBuffer;
+    childLqc->recoveryQueue.bufferSz = queueBufferSz;
+    childLqc->recoveryQueue.usedSz = 0;
+    childLqc->recoveryQueue.queueCnt = 0;
+    return true;
+}
+
+
+/**
+ *	\brief Remove a child device from the gateway, messages still queued for the child are discarded.
+ *  \return True if child was registered.
+ */
+bool lqc_gatewayRemoveChild(const char *deviceId)
+{
+    lqcGateway_t *gw = &S__gateway;
+    lqcGatewayChild_t *child = S__findChild(deviceId, strlen(deviceId));
+
+    if (child == NULL)
+        return false;
+
+    child->lqc->isGatewayChild = false;
+    child->lqc->recoveryQueue.queueCnt = 0;
+    child->lqc->recoveryQueue.usedSz = 0;
+
+    /* linear probe delete: shift following entries of the probe run back, so no lookup chain is broken */
+    uint16_t empty = child - gw->children;
+    uint16_t next = empty;
+    while (true)
+    {
+        next = (next + 1) % gw->tableSz;
+        if (gw->children[next].idHash == 0)
+            break;
+        uint16_t home = gw->children[next].idHash % gw->tableSz;
+        bool movable = (empty <= next) ? (home <= empty || home > next) : (home <= empty && home > next);
+        if (movable)
+        {
+            gw->children[empty] = gw->children[next];
+            empty = next;
+        }
+    }
+    memset(&gw->children[empty], 0, sizeof(lqcGatewayChild_t));
+    gw->childCnt--;
+    return true;
+}
+
+
+/**
+ *	\brief Get a child device's instance.
+ *  \return Child instance handle, NULL if not registered.
+ */
+lqcHandle_t lqc_gatewayFindChild(const char *deviceId)
+{
+    lqcGatewayChild_t *child = S__findChild(deviceId, strlen(deviceId));
+    return (child != NULL) ? child->lqc : NULL;
+}
+
+
+/**
+ *	\brief Gateway C2D receiver, demultiplexes by the cId message property to the child instance.
+ *
+ *  C2D for all children arrives on the gateway's own C2D topic. Messages without a cId (or for an unregistered child, 
+ *  or received with gateway mode off) are passed to lqc_receiveMsg() for the gateway.
+ *  \param [in] message - Message body.
+ *  \param [in] messageSz - Size of message body.
+ *  \param [in] props - Topic properties (query string).
+ */
+void lqc_gatewayReceiveMsg(char *message, uint16_t messageSz, const char *props)
+{
+    char childId[SET_PROPLEN(lqc__identity_deviceIdSz)];
+    uint8_t idLen = LQC_peekPropValue(props, "cId", childId, sizeof(childId));
+    lqcGatewayChild_t *child = (idLen > 0) ? S__findChild(childId, idLen) : NULL;
+
+    if (child != NULL)
+        lqcInst_receiveMsg(child->lqc, message, messageSz, props);
+    else
+        lqc_receiveMsg(message, messageSz, props);
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Rewrite a child's D2C topic for the upstream connection: device segment set to the gateway's ID (the only
+ *  device topic the connection may publish to) and the child's ID appended as the cId message property.
+ *  \return False if the rewritten topic does not fit.
+ */
+bool LQC_gatewayRewriteTopic(lqCloudDevice_t *lqc, const char *topic, char *gwTopic, uint16_t gwTopicSz)
+{
+    const char *postamble = topic;
+
+    if (strncmp(topic, "devices/", 8) == 0 && (postamble = strchr(topic + 8, '/')) == NULL)
+        return false;
+
+    uint16_t len = snprintf(gwTopic, gwTopicSz, "devices/%s%s&cId=%s", g_lqCloud.deviceCnfg->deviceId, postamble, lqc->deviceCnfg->deviceId);
+    return len < gwTopicSz;
+}
+
+
+/**
+ *	\brief Test for child messages waiting for upstream, holds an on-demand connection window open.
+ */
+bool LQC_gatewaySendPending()
+{
+    lqcGateway_t *gw = &S__gateway;
+
+    for (size_t i = 0; gw->children != NULL && i < gw->tableSz; i++)
+    {
+        if (gw->children[i].idHash != 0 && gw->children[i].lqc->recoveryQueue.queueCnt > 0)
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ *	\brief Service child upstream sends, invoked with the network work (lqc_doWork() or the network worker).
+ *
+ *  Visits up to LQC__gateway_childVisitCnt children from where the last pass ended: while upstream is ready, sends one
+ *  queued message for each (up to LQC__gateway_sendBudget a pass).
+ */
+void LQC_doGatewayWork()
+{
+    lqcGateway_t *gw = &S__gateway;
+
+    if (gw->children == NULL || gw->childCnt == 0)
+        return;
+
+    bool upstreamReady = S__upstreamReady();
+    uint8_t sendBudget = LQC__gateway_sendBudget;
+    uint16_t visits = MIN(gw->tableSz, LQC__gateway_childVisitCnt);
+
+    for (size_t i = 0; i < visits; i++)
+    {
+        lqcGatewayChild_t *child = &gw->children[gw->cursor];
+        gw->cursor = (gw->cursor + 1) % gw->tableSz;
+
+        if (child->idHash == 0)
+            continue;
+
+        if (child->lqc->recoveryQueue.queueCnt > 0)
+        {
+            if (!upstreamReady)
+                LQC_requestConnect();                                       // on-demand: child traffic opens the window
+            else if (sendBudget > 0)
+            {
+                uint8_t queuedCnt = child->lqc->recoveryQueue.queueCnt;
+                g_lqCloud.connectInfo.odc_activityAt = pMillis();           // on-demand window held open while child traffic
+                LQC_flushSendQueue(child->lqc);
+                if (child->lqc->recoveryQueue.queueCnt == queuedCnt)        // upstream send failed
+                {
+                    g_lqCloud.commMetrics.consecutiveSendFails++;           // connection manager resets upstream on repeated failures
+                    upstreamReady = false;
+                }
+                sendBudget--;
+            }
+        }
+    }
+}
+
+
+/**
+ *	\brief Dispatch child actions, invoked from lqc_doWork() on the application thread (also in worker mode), so
+ *  application action callbacks for children run where they do for the default instance.
+ *
+ *  Visits up to LQC__gateway_childVisitCnt children from where the last pass ended.
+ */
+void LQC_doGatewayActionWork()
+{
+    lqcGateway_t *gw = &S__gateway;
+
+    if (gw->children == NULL || gw->childCnt == 0)
+        return;
+
+    uint16_t visits = MIN(gw->tableSz, LQC__gateway_childVisitCnt);
+    for (size_t i = 0; i < visits; i++)
+    {
+        lqcGatewayChild_t *child = &gw->children[gw->actionCursor];
+        gw->actionCursor = (gw->actionCursor + 1) % gw->tableSz;
+
+        if (child->idHash == 0)
+            continue;
+        LQC_dispatchActionRequests(child->lqc);
+        LQC_checkActionTimeouts(child->lqc);
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+static lqcGatewayChild_t *S__findChild(const char *deviceId, uint16_t idLen)
+{
+    lqcGateway_t *gw = &S__gateway;
+
+    if (gw->children == NULL)
+        return NULL;
+
+    uint32_t idHash = LQC_hashKey(deviceId, idLen);
+    uint16_t slot = idHash % gw->tableSz;
+
+    for (size_t probes = 0; probes < gw->tableSz && gw->children[slot].idHash != 0; probes++)
+    {
+        lqcGatewayChild_t *child = &gw->children[slot];
+        const char *childId = child->lqc->deviceCnfg->deviceId;
+
+        if (child->idHash == idHash && strncmp(childId, deviceId, idLen) == 0 && childId[idLen] == '\0')
+            return child;
+        slot = (slot + 1) % gw->tableSz;
+    }
+    return NULL;
+}
+
+
+static bool S__upstreamReady()
+{
+    return g_lqCloud.connectInfo.mqttCtrl == NULL || g_lqCloud.connectInfo.state == lqcConnectState_messagingReady;
+}
+
+#pragma endregion
@@ -0,0 +1,585 @@
+/******************************************************************************
+ *  \file lqc-http.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client HTTPS Transport
+ *
+ * D2C fallback for devices that cannot hold an MQTT/TLS session. Messages are
+ * POSTed to the IoTHub REST events endpoint, the MQTT topic properties (evT,
+ * evC, evN, etc.) are sent as iothub-app-* headers so the cloud ingests both
+ * transports the same. The connection manager keeps probing MQTT in the
+ * background and D2C returns to MQTT once it reconnects.
+ *
+ * Sensor data pump: sensors (lqcDeviceType_sensor) hold no MQTT session. D2C
+ * messages are appended to an IoTHub batch (JSON array, one entry per message
+ * with its properties) and POSTed once per interval; after the post pending
+ * C2D (action requests) are fetched from the deviceBound endpoint into the
+ * now free batch buffer and queued like MQTT received actions.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "HTP"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+#define MAX(x, y) (((x)>(y)) ? (x):(y))
+
+#pragma region Static Local Declarations
+static lqcTransport_t S__transport;                                    // D2C transport, MQTT with optional HTTPS fallback
+static lqcDataPump_t S__dataPump;                                      // sensor HTTP data pump
+static void S__setHttpConnection(httpCtrl_t *httpCtrl);
+static uint16_t S__composeAuthHeaders(const char *contentHeaders);
+static uint16_t S__composePropertyHeaders(const char *props, char *headers, uint16_t headersSz);
+static uint16_t S__composeBatchEntry(const char *topic, const char *body, char *entry, uint16_t entrySz);
+static uint16_t S__appendJsonEscaped(char *dest, uint16_t destSz, const char *src, uint16_t srcLen);
+static bool S__postBatch();
+static bool S__fetchC2D();
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Enable HTTPS POST as the fallback D2C transport.
+ *
+ *	\param [in] httpCtrl - HTTP control, initialized by application (http_initControl).
+ *  \param [in] failoverAfter - Consecutive MQTT failures before switching, 0 = default.
+ */
+void lqc_enableHttpFallback(httpCtrl_t *httpCtrl, uint8_t failoverAfter)
+{
+    lqcTransport_t *xport = &S__transport;
+
+    S__setHttpConnection(httpCtrl);
+    xport->failoverAfter = failoverAfter ? failoverAfter : LQC__transport_failoverAfterDefault;
+    xport->active = lqcMessagingProto_mqtt;
+    xport->mqttFailCnt = 0;
+}
+
+
+/**
+ *	\brief Enable sensor data pump, D2C batched into one HTTPS POST per interval.
+ *
+ *	\param [in] httpCtrl - HTTP control, initialized by application (http_initControl) with lqc_receiveHttp receive callback.
+ *  \param [in] batchBuffer - Batch buffer, D2C messages accumulate here between posts.
+ *  \param [in] batchBufferSz - Size of batchBuffer.
+ *  \param [in] batchIntervalSecs - Seconds between batch posts.
+ */
+void lqc_enableDataPump(httpCtrl_t *httpCtrl, char *batchBuffer, uint16_t batchBufferSz, uint32_t batchIntervalSecs)
+{
+    lqcDataPump_t *pump = &S__dataPump;
+
+    ASSERT(g_lqCloud.deviceType == lqcDeviceType_sensor);
+    S__setHttpConnection(httpCtrl);
+
+    pump->batchBuffer = batchBuffer;
+    pump->batchBufferSz = batchBufferSz;
+    pump->batchLen = 0;
+    pump->batchCnt = 0;
+    pump->postNow = false;
+    pump->intervalMillis = PERIOD_FROM_SECONDS(batchIntervalSecs);
+    pump->lastPostAt = pMillis();
+}
+
+
+/**
+ *	\brief Data pump HTTP receive, C2D response (headers and body) is collected in the batch buffer (batch already posted).
+ *  Error responses are not collected, their body is not an action request.
+ */
+void lqc_receiveHttp(dataCntxt_t dataCntxt, uint16_t httpStatus, char *recvData, uint16_t dataSz)
+{
+    lqcDataPump_t *pump = &S__dataPump;
+    (void)dataCntxt;                                                            // single HTTP context, the data pump's
+
+    if (httpStatus < 200 || httpStatus > 299)
+        return;
+    if (pump->batchBuffer == NULL || pump->batchCnt > 0)                        // batch not yet sent, buffer in use
+        return;
+
+    uint16_t copySz = MIN(dataSz, pump->batchBufferSz - pump->rxLen - 1);
+    memcpy(pump->batchBuffer + pump->rxLen, recvData, copySz);
+    pump->rxLen += copySz;
+    pump->batchBuffer[pump->rxLen] = '\0';
+}
+
+
+/**
+ *	\brief Get the transport currently carrying D2C messages.
+ */
+lqcMessagingProto_t lqc_getActiveTransport()
+{
+    return LQC_httpFallbackActive() ? lqcMessagingProto_http : lqcMessagingProto_mqtt;
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Send a D2C message by HTTPS POST to the IoTHub events endpoint.
+ *
+ *  \param [in] topic - Fully formed MQTT topic, properties following .../messages/events/ become iothub-app-* headers.
+ *  \param [in] body - Message body (JSON).
+ *  \param [in] timeoutSeconds - Request timeout.
+ *  \return resultCode__success if accepted by IoTHub (2xx), otherwise HTTP style failure code.
+ */
+resultCode_t LQC_sendHttp(const char *topic, const char *body, uint8_t timeoutSeconds)
+{
+    lqcTransport_t *xport = &S__transport;
+    char url[LQC__http_urlSz];
+
+    const char *props = strstr(topic, "/messages/events/");
+    if (props == NULL)
+        return resultCode__badRequest;
+    props += 17;                                                                // past "/messages/events/"
+
+    snprintf(url, sizeof(url), IotHubTemplate_http_D2CUrl, g_lqCloud.deviceCnfg->deviceId);
+
+    uint16_t hdrsLen = S__composeAuthHeaders("iothub-contenttype: application/json\r\niothub-contentencoding: utf-8\r\n");
+    if (hdrsLen == 0)
+        return resultCode__internalError;
+    hdrsLen += S__composePropertyHeaders(props, xport->httpHeaders + hdrsLen, sizeof(xport->httpHeaders) - hdrsLen);
+
+    uint32_t postStart = pMillis();
+    resultCode_t rslt = http_post(xport->httpCtrl, url, body, strlen(body), false, timeoutSeconds);
+    g_lqCloud.commMetrics.sendLastDuration = pMillis() - postStart;
+
+    PRINTF(dbgColor__cyan, "HTTP D2C: rslt=%d, dur=%d\r", rslt, g_lqCloud.commMetrics.sendLastDuration);
+    return (rslt >= resultCode__success && rslt < 300) ? resultCode__success : rslt;        // IoTHub responds 204 (no content)
+}
+
+
+/**
+ *	\brief D2C messages are being sent by HTTPS (MQTT unavailable).
+ */
+bool LQC_httpFallbackActive()
+{
+    return S__transport.httpCtrl != NULL && S__transport.active == lqcMessagingProto_http;
+}
+
+
+/**
+ *	\brief Tally an MQTT send or connect failure, switch D2C to HTTPS at the failover threshold.
+ */
+void LQC_trackMqttFailure()
+{
+    lqcTransport_t *xport = &S__transport;
+
+    if (xport->httpCtrl == NULL || xport->active == lqcMessagingProto_http)
+        return;
+
+    if (++xport->mqttFailCnt >= xport->failoverAfter)
+    {
+        PRINTF(dbgColor__warn, "Transport: MQTT failed %d times, HTTPS fallback\r", xport->mqttFailCnt);
+        xport->active = lqcMessagingProto_http;
+        xport->switchedAt = pMillis();
+        xport->failoverCnt++;
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_info, "HTTPS Fallback");
+    }
+}
+
+
+/**
+ *	\brief MQTT send succeeded, clear failure tally.
+ */
+void LQC_trackMqttSuccess()
+{
+    S__transport.mqttFailCnt = 0;
+}
+
+
+/**
+ *	\brief MQTT connection (re)established by connection manager, return D2C to MQTT if on fallback.
+ */
+void LQC_resumeMqtt()
+{
+    lqcTransport_t *xport = &S__transport;
+
+    if (LQC_httpFallbackActive())
+    {
+        PRINTF(dbgColor__info, "Transport: MQTT restored after %lus\r", (pMillis() - xport->switchedAt) / 1000);
+        xport->active = lqcMessagingProto_mqtt;
+        xport->mqttFailCnt = 0;
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_info, "MQTT Restored");
+    }
+}
+
+
+/**
+ *	\brief Sensor data pump is enabled, D2C is batched.
+ */
+bool LQC_dataPumpEnabled()
+{
+    return g_lqCloud.deviceType == lqcDeviceType_sensor && S__dataPump.batchBuffer != NULL;
+}
+
+
+/**
+ *	\brief Add a D2C message to the data pump batch, a full batch is posted early to make room.
+ *  \return lqcSendResult_queued, or lqcSendResult_dropped if the message does not fit.
+ */
+lqcSendResult_t LQC_appendToBatch(const char *topic, const char *body)
+{
+    lqcDataPump_t *pump = &S__dataPump;
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        uint16_t entryLen = S__composeBatchEntry(topic, body, pump->batchBuffer + pump->batchLen, pump->batchBufferSz - pump->batchLen - 1);   // reserve closing ]
+        if (entryLen > 0)
+        {
+            pump->batchLen += entryLen;
+            pump->batchCnt++;
+            if (strstr(topic, "evT=aRsp") != NULL)
+                pump->postNow = true;                                           // cloud is waiting on action response
+            return lqcSendResult_queued;
+        }
+        pump->batchBuffer[pump->batchLen] = '\0';
+        if (pump->batchCnt == 0 || !S__postBatch())                             // too large for empty batch, or post failed
+            break;
+    }
+
+    if (strstr(topic, "evT=alrt") != NULL)
+        LQC_ATOMIC_INC(g_lqCloud.droppedAlrtMsgCnt);
+    else
+        LQC_ATOMIC_INC(g_lqCloud.droppedTeleMsgCnt);
+    return lqcSendResult_dropped;
+}
+
+
+/**
+ *	\brief Millis until the data pump posts its batch (and polls C2D).
+ */
+uint32_t LQC_dataPumpNextWakeup()
+{
+    lqcDataPump_t *pump = &S__dataPump;
+
+    if (!LQC_dataPumpEnabled())
+        return LQC_WAKEUP_NONE;
+    return pump->postNow ? 0 : LQC_millisUntil(pump->lastPostAt, pump->intervalMillis);
+}
+
+
+/**
+ *	\brief Post the batch at interval (or now for action responses), then fetch pending C2D. Invoked from lqc_doWork().
+ */
+void LQC_doDataPumpWork()
+{
+    lqcDataPump_t *pump = &S__dataPump;
+
+    if (!LQC_dataPumpEnabled() || !(pump->postNow || wrkTime_isElapsed(pump->lastPostAt, pump->intervalMillis)))
+        return;
+
+    pump->lastPostAt = pMillis();
+    if (pump->batchCnt > 0 && !S__postBatch())
+        return;                                                                 // batch retained, retry next interval
+
+    for (uint8_t i = 0; i < LQC__dataPump_c2dPollMax; i++)
+    {
+        if (!S__fetchC2D())
+            break;
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+/**
+ *	\brief Set HTTPS connection to IoTHub host, custom headers (authorization, properties) composed per request.
+ */
+static void S__setHttpConnection(httpCtrl_t *httpCtrl)
+{
+    char hostUrl[lqc__identity_hostUrlSz + 9];
+
+    ASSERT(g_lqCloud.deviceCnfg != NULL);                                       // lqc_create() first, host from device config
+    S__transport.httpCtrl = httpCtrl;
+
+    snprintf(hostUrl, sizeof(hostUrl), "https://%s", g_lqCloud.deviceCnfg->hostUrl);
+    http_setConnection(httpCtrl, hostUrl, LQC__http_hostPort);
+    http_enableCustomHdrs(httpCtrl, S__transport.httpHeaders, sizeof(S__transport.httpHeaders));
+}
+
+
+/**
+ *	\brief Start request custom headers with SAS authorization followed by content headers.
+ *  \return Length of headers, 0 if they do not fit.
+ */
+static uint16_t S__composeAuthHeaders(const char *contentHeaders)
+{
+    uint16_t hdrsLen = snprintf(S__transport.httpHeaders, sizeof(S__transport.httpHeaders), "Authorization: %s\r\n%s", LQC_getSasToken(), contentHeaders);
+    return (hdrsLen < sizeof(S__transport.httpHeaders)) ? hdrsLen : 0;
+}
+
+
+/**
+ *	\brief Convert topic properties (name=value&...) to IoTHub application property headers.
+ *  \return Length of headers written, properties that do not fit are omitted.
+ */
+static uint16_t S__composePropertyHeaders(const char *props, char *headers, uint16_t headersSz)
+{
+    uint16_t hdrsLen = 0;
+
+    while (*props != '\0')
+    {
+        const char *propEnd = strchr(props, '&');
+        uint16_t propLen = propEnd ? (uint16_t)(propEnd - props) : (uint16_t)strlen(props);
+        const char *valueAt = memchr(props, '=', propLen);
+
+        if (valueAt != NULL && valueAt > props)
+        {
+            int nameLen = valueAt - props;
+            int valueLen = propLen - nameLen - 1;
+            uint16_t hdrLen = snprintf(headers + hdrsLen, headersSz - hdrsLen, IotHubTemplate_http_appPropertyHdr, nameLen, props, valueLen, valueAt + 1);
+            if (hdrLen >= headersSz - hdrsLen)
+            {
+                headers[hdrsLen] = '\0';                                        // drop truncated header
+                PRINTF(dbgColor__warn, "HTTP D2C: headers full, properties omitted\r");
+                break;
+            }
+            hdrsLen += hdrLen;
+        }
+        if (propEnd == NULL)
+            break;
+        props = propEnd + 1;
+    }
+    return hdrsLen;
+}
+
+
+
+/**
+ *	\brief Compose IoTHub batch entry for a message: {"body":"..","base64Encoded":false,"properties":{"iothub-app-name":"value",..}}
+ *  \details The entry is prefixed with [ (first) or , (following); topic properties become application properties.
+ *  \return Length of entry, 0 if it does not fit.
+ */
+static uint16_t S__composeBatchEntry(const char *topic, const char *body, char *entry, uint16_t entrySz)
+{
+    const char *props = strstr(topic, "/messages/events/");
+    if (props == NULL)
+        return 0;
+    props += 17;
+
+    uint16_t len = snprintf(entry, entrySz, "%c{\"body\":\"", (S__dataPump.batchCnt == 0) ? '[' : ',');
+    if (len >= entrySz)
+        return 0;
+    uint16_t bodyLen = S__appendJsonEscaped(entry + len, entrySz - len, body, strlen(body));
+    if (bodyLen == 0 && body[0] != '\0')
+        return 0;
+    len += bodyLen;
+    len += snprintf(entry + len, entrySz - len, "\",\"base64Encoded\":false,\"properties\":{");
+    if (len >= entrySz)
+        return 0;
+
+    bool firstProp = true;
+    while (*props != '\0')
+    {
+        const char *propEnd = strchr(props, '&');
+        uint16_t propLen = propEnd ? (uint16_t)(propEnd - props) : (uint16_t)strlen(props);
+        const char *valueAt = memchr(props, '=', propLen);
+
+        if (valueAt != NULL && valueAt > props)
+        {
+            int nameLen = valueAt - props;
+            int valueLen = propLen - nameLen - 1;
+            len += snprintf(entry + len, entrySz - len, "%s\"iothub-app-%.*s\":\"%.*s\"", firstProp ? "" : ",", nameLen, props, valueLen, valueAt + 1);
+            if (len >= entrySz)
+                return 0;
+            firstProp = false;
+        }
+        if (propEnd == NULL)
+            break;
+        props = propEnd + 1;
+    }
+    len += snprintf(entry + len, entrySz - len, "}}");
+    return (len < entrySz) ? len : 0;
+}
+
+
+/**
+ *	\brief Copy src into dest as JSON string content (quote, backslash and control chars escaped).
+ *  \return Length written, 0 if it does not fit.
+ */
+static uint16_t S__appendJsonEscaped(char *dest, uint16_t destSz, const char *src, uint16_t srcLen)
+{
+    uint16_t len = 0;
+
+    for (uint16_t i = 0; i < srcLen; i++)
+    {
+        char c = src[i];
+        if (c == '"' || c == '\\')
+        {
+            if (len + 2 >= destSz)
+                return 0;
+            dest[len++] = '\\';
+            dest[len++] = c;
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            if (len + 6 >= destSz)
+                return 0;
+            len += snprintf(dest + len, destSz - len, "\\u%04x", c);
+        }
+        else
+        {
+            if (len + 1 >= destSz)
+                return 0;
+            dest[len++] = c;
+        }
+    }
+    dest[len] = '\0';
+    return len;
+}
+
+
+/**
+ *	\brief POST the data pump batch to IoTHub, batch is cleared on success.
+ */
+static bool S__postBatch()
+{
+    lqcDataPump_t *pump = &S__dataPump;
+    char url[LQC__http_urlSz];
+    char contentHdrs[60];
+
+    snprintf(url, sizeof(url), IotHubTemplate_http_D2CUrl, g_lqCloud.deviceCnfg->deviceId);
+    snprintf(contentHdrs, sizeof(contentHdrs), "Content-Type: %s\r\n", IotHubTemplate_http_batchContentType);
+    if (S__composeAuthHeaders(contentHdrs) == 0)
+        return false;
+
+    pump->batchBuffer[pump->batchLen] = ']';                                    // close batch array, space reserved at append
+    uint32_t postStart = pMillis();
+    resultCode_t rslt = http_post(S__transport.httpCtrl, url, pump->batchBuffer, pump->batchLen + 1, false, LQC__dataPump_rqstTimeoutSecs);
+    g_lqCloud.commMetrics.sendLastDuration = pMillis() - postStart;
+    pump->batchBuffer[pump->batchLen] = '\0';
+
+    PRINTF(dbgColor__cyan, "DataPump: batch cnt=%d, sz=%d, rslt=%d, dur=%d\r", pump->batchCnt, pump->batchLen + 1, rslt, g_lqCloud.commMetrics.sendLastDuration);
+
+    if (rslt < resultCode__success || rslt >= 300)
+    {
+        g_lqCloud.isOnline = false;
+        g_lqCloud.deviceState = lqcDeviceState_offline;
+        LQC_ATOMIC_INC(g_lqCloud.commMetrics.sendFailures);
+        LQC_ATOMIC_INC(g_lqCloud.commMetrics.consecutiveSendFails);
+        return false;
+    }
+
+    g_lqCloud.isOnline = true;
+    LQC_ATOMIC_ADD(g_lqCloud.commMetrics.sendSucceeds, pump->batchCnt);
+    LQC_ATOMIC_STORE(g_lqCloud.commMetrics.consecutiveSendFails, 0);
+    g_lqCloud.commMetrics.sendMaxDuration = MAX(g_lqCloud.commMetrics.sendMaxDuration, g_lqCloud.commMetrics.sendLastDuration);
+    pump->batchLen = 0;
+    pump->batchCnt = 0;
+    pump->postNow = false;
+    return true;
+}
+
+
+/**
+ *	\brief Fetch one pending C2D message (action request), queue it and complete it with IoTHub.
+ *  \details Response headers carry the properties (iothub-app-*, iothub-messageid) and the lock token (ETag).
+ *  \return True if a message was received (more may be pending).
+ */
+static bool S__fetchC2D()
+{
+    lqcDataPump_t *pump = &S__dataPump;
+    char url[LQC__http_urlSz + LQC__http_etagSz];
+    char props[mqtt__topic_bufferSz] = {0};
+    char etag[LQC__http_etagSz] = {0};
+    uint16_t propsLen = 0;
+
+    snprintf(url, sizeof(url), IotHubTemplate_http_C2DUrl, g_lqCloud.deviceCnfg->deviceId);
+    if (S__composeAuthHeaders("") == 0)
+        return false;
+
+    pump->rxLen = 0;
+    pump->batchBuffer[0] = '\0';
+    resultCode_t rslt = http_get(S__transport.httpCtrl, url, true, LQC__dataPump_rqstTimeoutSecs);
+    if (rslt != resultCode__success)                                            // 204: no C2D pending
+        return false;
+    if (http_readPage(S__transport.httpCtrl, LQC__dataPump_rqstTimeoutSecs) != resultCode__success)
+        return false;
+
+    char *body = strstr(pump->batchBuffer, "\r\n\r\n");
+    if (body == NULL)
+        return false;
+    *body = '\0';                                                               // headers are a string, body follows
+    body += 4;
+
+    char *line = pump->batchBuffer;
+    while (line != NULL && *line != '\0')
+    {
+        char *lineEnd = strstr(line, "\r\n");
+        if (lineEnd != NULL)
+            *lineEnd = '\0';
+
+        char *valueAt = strstr(line, ": ");
+        if (valueAt != NULL)
+        {
+            *valueAt = '\0';
+            valueAt += 2;
+            if (strncasecmp(line, "iothub-app-", 11) == 0)
+                propsLen += snprintf(props + propsLen, sizeof(props) - propsLen, "%s%s=%s", propsLen ? "&" : "", line + 11, valueAt);
+            else if (strcasecmp(line, "iothub-messageid") == 0)
+                propsLen += snprintf(props + propsLen, sizeof(props) - propsLen, "%s$.mid=%s", propsLen ? "&" : "", valueAt);
+            else if (strcasecmp(line, "ETag") == 0)
+                strncpy(etag, valueAt + (valueAt[0] == '"'), sizeof(etag) - 1);
+            propsLen = MIN(propsLen, sizeof(props) - 1);
+        }
+        line = lineEnd ? lineEnd + 2 : NULL;
+    }
+
+    char *etagEnd = strchr(etag, '"');
+    if (etagEnd != NULL)
+        *etagEnd = '\0';
+
+    PRINTF(dbgColor__cyan, "DataPump: C2D props=%s\r", props);
+    lqc_receiveMsg(body, strlen(body), props);                                  // queued, performed from lqc_doWork()
+
+    if (etag[0] != '\0')                                                        // complete, IoTHub would redeliver after lock timeout
+    {
+        snprintf(url, sizeof(url), IotHubTemplate_http_C2DCompleteUrl, g_lqCloud.deviceCnfg->deviceId, etag);
+        S__composeAuthHeaders("");
+        http_delete(S__transport.httpCtrl, url, LQC__dataPump_rqstTimeoutSecs);
+    }
+    return true;
+}
+
+#pragma endregion
@@ -36,16 +36,42 @@
 
 #include <lqcloud.h>
 
+/* Thread-safe mode: build with LQC_THREADSAFE defined to call the send APIs from multiple RTOS tasks or threads. Counters
+ * shared between producers and the network worker are updated atomically. Requires GCC __atomic builtins (Cortex-M3+, Linux).
+ */
+#ifdef LQC_THREADSAFE
+    #define LQC_ATOMIC_INC(v)       __atomic_add_fetch(&(v), 1, __ATOMIC_RELAXED)
+    #define LQC_ATOMIC_ADD(v, n)    __atomic_add_fetch(&(v), (n), __ATOMIC_RELAXED)
+    #define LQC_ATOMIC_STORE(v, x)  __atomic_store_n(&(v), (x), __ATOMIC_RELAXED)
+    #define LQC_TRYLOCK(f)          (!__atomic_test_and_set(&(f), __ATOMIC_ACQUIRE))
+    #define LQC_TRYUNLOCK(f)        __atomic_clear(&(f), __ATOMIC_RELEASE)
+    #define LQC_LOCK()              LQC_workerLock()
+    #define LQC_UNLOCK()            LQC_workerUnlock()
+#else
+    #define LQC_ATOMIC_INC(v)       (++(v))
+    #define LQC_ATOMIC_ADD(v, n)    ((v) += (n))
+    #define LQC_ATOMIC_STORE(v, x)  ((v) = (x))
+    #define LQC_TRYLOCK(f)          (!(f) && ((f) = true))
+    #define LQC_TRYUNLOCK(f)        ((f) = false)
+    #define LQC_LOCK()
+    #define LQC_UNLOCK()
+#endif
+
 #include <ltemc-tls.h>
 #include <ltemc-mqtt.h>                             // REQUIRED communications for now!
 #include <ltemc-http.h>
 
 #include "lqc-ntwk.h"
+#include "lqc-coap.h"
 // #include "lqc-mqtt.h"
 // #include "lqc-http.h"
 
 #define PRODUCT "LC"
 
+#ifndef PERIOD_FROM_SECONDS
+#define PERIOD_FROM_SECONDS(period)  ((period) * 1000)
+#endif
+
 enum 
 {
     LQC__connectionRetryCnt = 3,
@@ -62,8 +88,20 @@ enum
     LOOUQ_FLASHDICTKEY__LQCDEVICECONFIG = 201,
     DVCSTATUS_SZ = 61,
     LQC_EVNTCLASS_SZ = 5,
-    LQCACTN_BUF_SZ = 80,                                    /// good averaged for up to a couple params
-    LQCACTN_LQCACTIONS_BODY_SZ = 180                        /// calculated from actual JSON
+    LQCACTN_APPLENTRY_SZ = 14 + LQC__action_nameSz + LQC__action_paramsListSz,  /// {"n":"","p":""}, (16) + name + paramList (less NULLs)
+    LQCACTN_LQCACTIONS_BODY_SZ = 208,                       /// calculated from actual JSON (built-in actions, envelope)
+    LQCACTN_INFO_SZ = LQC__actionInfoSz,                    /// getactn catalogue, built-in actions (LQCACTN_LQCACTIONS_BODY_SZ) + LQC__actionCnt entries
+    LQC__actionRecentMagic = 0x4C515242,                    /// "LQRB" recent actions cache valid (FIFO ring layout)
+    LQC__http_hostPort = 443,
+    LQC__http_urlSz = 100,                                  /// REST relative URL (device ID + api-version)
+    LQC__http_headersSz = 480,                              /// custom request headers: SAS authorization + message properties
+    LQC__http_etagSz = 40,                                  /// C2D lock token (GUID), HTTP C2D complete
+    LQC__dataPump_rqstTimeoutSecs = 30,
+    LQC__sas_keySz = 64,                                    /// SAS renewal: decoded device key (IoT Hub keys are 32 or 64 bytes)
+    LQC__sas_tokenSz = lqc__identity_hostUrlSz + lqc__identity_deviceIdSz + lqc__identity_signatureSz + 41,  /// SAS token composed from config
+    LQC__worker_eventMsgSz = 41,                            /// worker mode: event message copied to the completion queue (incl NULL)
+    LQC__coap_blockSz = 16 << LQC__coap_blockSzx,
+    LQC__coap_datagramSz = 24 + LQMQ_TOPIC_PUB_MAXSZ + LQC__coap_blockSz    /// header, token, options (path/query from topic), payload
 };
 
 
@@ -88,9 +126,290 @@ typedef struct lqcApplAction_tag
     char name[LQC__action_nameSz];              /// Action name, know by LQ Cloud.
     lqcAction_func actionCB;                    /// Action function to be invoked, to perform device action.
     char paramList[LQC__action_paramsListSz];   /// this is used for registration with LQ Cloud, function will receive a propsDict_t parameter.
+
+    uint16_t budgetMillis;                      /// execution time allowed action function, 0 = none
+    uint16_t execCnt;                           /// times action performed
+    uint16_t execLastMillis;                    /// duration of last action function invoke
+    uint16_t execMaxMillis;
+    uint16_t execOverBudgetCnt;
+    uint16_t execHistogram[LQC__actionStat_histBins];
+    uint32_t rspLastMillis;                     /// last round trip: request received to response sent (incl. queue wait and deferred completion)
+    uint32_t rspMaxMillis;
 } lqcApplAction_t;
 
 
+/**
+ *  \brief Inbound action request header, copied from the transport receive callback for later dispatch by lqc_doWork().
+ *  \details In the queue buffer the header is followed by props (HTTP query string format) and msg (JSON), each NULL terminated.
+*/
+typedef struct lqcActionRqst_tag
+{
+    uint32_t recvAt;                                /// millis tick at receive
+    uint16_t propsSz;
+    uint16_t msgSz;
+} lqcActionRqst_t;
+
+
+/**
+ *  \brief Action request that will not be dispatched, LQCloud responds to it automatically with resultCode.
+*/
+typedef struct lqcActionReject_tag
+{
+    char msgId[SET_PROPLEN(LQC__action_MsgIdSz)];
+    char name[SET_PROPLEN(LQC__action_nameSz)];
+    lqcEventClass_t eventClass;
+    uint16_t resultCode;
+} lqcActionReject_t;
+
+
+/**
+ *  \brief Bounded FIFO decoupling action receive (transport callback) from action execution (lqc_doWork).
+*/
+typedef struct lqcActionQueue_tag
+{
+    char *buffer;                                   /// application buffer (lqc_setActionQueue()), packed requests, oldest at offset 0
+    uint16_t bufferSz;                              /// 0 = no queue, requests are performed from the receive callback
+    uint16_t bufferUsed;
+    uint8_t count;
+
+    lqcActionReject_t rejects[LQC__actionRejectCnt];
+    uint8_t rejectHead;
+    uint8_t rejectTail;
+    uint8_t rejectCount;
+
+    uint8_t dispatchBudget;                         /// requests (and rejects) serviced per lqc_doWork() pass
+} lqcActionQueue_t;
+
+
+/**
+ *  \brief In-flight action, correlates the request (mId) with its eventual response (aCId).
+*/
+typedef struct lqcActionCorrelation_tag
+{
+    char msgId[SET_PROPLEN(LQC__action_MsgIdSz)];   /// Action request mId, will be aCId (correlation ID).
+    char name[SET_PROPLEN(LQC__action_nameSz)];     /// Action name, response evN.
+    lqcEventClass_t eventClass;
+    bool inUse;
+    bool deferred;                                  /// action function will respond later via lqc_completeAction()
+    uint8_t generation;                             /// incremented on release, invalidates stale handles
+    uint32_t startAt;
+    uint32_t timeoutMillis;
+    uint32_t midHash;                               /// recent actions cache key, result code recorded at response
+    uint32_t recvAt;                                /// request receive, for round trip timing
+    int8_t applIndx;                                /// applActions index, -1 if LQCloud built-in action
+} lqcActionCorrelation_t;
+
+
+/**
+ *  \brief Chunked C2D transfer in progress, payload is streamed to the application sink (or arena) as fragments arrive.
+*/
+typedef struct lqcTransfer_tag
+{
+    char xferId[SET_PROPLEN(LQC__transfer_idSz)];
+    char name[SET_PROPLEN(LQC__transfer_nameSz)];
+    bool active;
+    uint32_t totalLen;                              /// xLen: payload length
+    uint32_t offset;                                /// payload bytes received (in order)
+    uint32_t crc;                                   /// running CRC-32 of received payload
+    uint32_t expectedCrc;                           /// xCrc: CRC-32 of complete payload
+    uint16_t nextSeq;                               /// next fragment sequence expected
+    uint8_t window;                                 /// xWin: fragments between acks
+    uint8_t sinceAck;
+    uint32_t lastRecvAt;
+
+    bool ackPending;                                /// ack is sent from lqc_doWork(), not the receive callback
+    uint16_t ackResult;
+    char completedId[SET_PROPLEN(LQC__transfer_idSz)];  /// last completed transfer, redeliveries of its fragments are re-acked
+    uint16_t completedSeqCnt;                           /// fragments in last completed transfer (its final ack xSeq)
+
+    lqcTransferSink_func sinkCB;
+    uint8_t *arena;
+    uint32_t arenaSz;
+} lqcTransfer_t;
+
+
+/**
+ *  \brief Connection manager state, connection is brought up one step per lqc_doWork() pass.
+*/
+typedef struct lqcConnectInfo_tag
+{
+    mqttCtrl_t *mqttCtrl;                           /// NULL if connection is managed by application
+    uint8_t pdpContextId;
+    lqcConnectState_t state;
+    uint32_t stateEnteredAt;
+    uint32_t lastStepAt;                            /// last connection step attempt, paces retries
+    uint8_t faultCnt;                               /// consecutive connection faults, interface reset at LQC__connectionRetryCnt
+    uint32_t linkCheckAt;                           /// last MQTT status poll while messagingReady
+
+    lqcConnect_t connectMode;
+    bool connectRequested;                          /// on-demand: urgent traffic, open connection now
+    uint32_t odc_interConnectMillis;                /// on-demand: scheduled window interval
+    uint32_t odc_holdConnectMillis;                 /// on-demand: hold open after last activity
+    uint32_t odc_disconnectAt;                      /// on-demand: last window closed
+    uint32_t odc_activityAt;                        /// on-demand: last send/receive
+    uint8_t odc_windowFaultCnt;                     /// on-demand: connection faults in the current window
+    lqcPowerSave_func powerSaveCB;
+
+    bool sessionResume;                             /// connect with clean-session false
+} lqcConnectInfo_t;
+
+
+/** 
+ *  \brief D2C transport selection, HTTPS fallback when MQTT cannot be held.
+*/
+typedef struct lqcTransport_tag
+{
+    httpCtrl_t *httpCtrl;                           /// NULL if HTTP fallback not enabled
+    lqcMessagingProto_t active;                     /// transport carrying D2C messages
+    uint8_t failoverAfter;                          /// consecutive MQTT failures before fallback
+    uint8_t mqttFailCnt;                            /// consecutive MQTT failures (send or connect)
+    uint16_t failoverCnt;                           /// times switched to HTTPS
+    uint32_t switchedAt;
+    char httpHeaders[LQC__http_headersSz];          /// custom headers buffer (http_enableCustomHdrs)
+} lqcTransport_t;
+
+
+/** 
+ *  \brief Sensor data pump, D2C batched into one HTTPS POST per interval.
+*/
+typedef struct lqcDataPump_tag
+{
+    char *batchBuffer;                              /// NULL if data pump not enabled; JSON batch, then C2D response after post
+    uint16_t batchBufferSz;
+    uint16_t batchLen;
+    uint16_t batchCnt;                              /// messages in batch
+    bool postNow;                                   /// action response in batch, cloud waiting
+    uint32_t intervalMillis;
+    uint32_t lastPostAt;
+    uint16_t rxLen;                                 /// C2D response received into batchBuffer
+} lqcDataPump_t;
+
+
+/** 
+ *  \brief ISR event record and definitions, records are written by ISR (head) and expanded by lqc_doWork() (tail).
+*/
+typedef struct lqcIsrEvent_tag
+{
+    uint32_t timestamp;                             /// millis at capture
+    int32_t values[LQC__isrEvent_valueCnt];
+    uint8_t eventId;
+} lqcIsrEvent_t;
+
+typedef struct lqcIsrEventDef_tag
+{
+    uint8_t eventId;
+    lqcIsrEventType_t eventType;
+    const char *evntName;                           /// NULL = unused definition
+    const char *valueNames;
+} lqcIsrEventDef_t;
+
+typedef struct lqcIsrRing_tag
+{
+    lqcIsrEvent_t records[LQC__isrEventCnt];
+    volatile uint8_t head;                          /// free running, written only by ISR
+    volatile uint8_t tail;                          /// free running, written only by lqc_doWork()
+    volatile uint16_t droppedCnt;                   /// written only by ISR
+    uint16_t droppedReported;
+    lqcIsrEventDef_t defs[LQC__isrEventDefCnt];
+} lqcIsrRing_t;
+
+
+/** 
+ *  \brief Thread-safe send ring, bounded multi-producer/single-consumer (per slot sequence numbers, no locks).
+*/
+typedef struct lqcSendRing_tag
+{
+    lqcSendSlot_t *slots;                           /// NULL if thread-safe send not enabled
+    uint32_t mask;                                  /// slot count - 1
+    uint32_t enqueuePos;                            /// producers, claimed by compare-and-swap
+    uint32_t dequeuePos;                            /// network worker only
+    uint32_t fullCnt;                               /// sends dropped, ring full or message larger than a slot
+} lqcSendRing_t;
+
+
+/** 
+ *  \brief Timer scheduler, binary min-heap of running timers ordered by deadline.
+*/
+typedef struct lqcScheduler_tag
+{
+    lqcTimer_t *heap[LQC__schedulerTimerCnt];
+    uint8_t count;
+} lqcScheduler_t;
+
+
+/** 
+ *  \brief Worker mode, event notification raised on the network worker awaiting delivery on the application thread.
+*/
+typedef struct lqcCompletion_tag
+{
+    lqcHandle_t lqc;
+    const char *eventTag;                           /// appEvent_* tags are string literals, not copied
+    char eventMsg[LQC__worker_eventMsgSz];
+} lqcCompletion_t;
+
+
+/** 
+ *  \brief Worker mode, network worker control and completion queue (mutex protected).
+*/
+typedef struct lqcWorker_tag
+{
+    lqcPlatformHooks_t *hooks;                      /// NULL if worker mode not enabled
+    void *mutex;
+    void *thread;                                   /// worker thread/task handle (hooks->currentThread()), set as the worker starts
+    bool running;
+    bool connectRequested;                          /// on-demand connect requested from an application thread
+    lqcCompletion_t completions[LQC__worker_completionCnt];
+    uint8_t completionHead;
+    uint8_t completionTail;
+    uint8_t completionCnt;
+    uint16_t completionDroppedCnt;
+} lqcWorker_t;
+
+
+/** 
+ *  \brief SAS token cache: composed (config signature) or generated (device key) once, renewed ahead of expiry.
+*/
+typedef struct lqcSasToken_tag
+{
+    char token[LQC__sas_tokenSz];                   /// current token, empty if not composed
+    uint32_t expiry;                                /// se= of current token (Unix seconds), 0 if unknown
+    uint32_t sourceCrc;                             /// CRC of host\device\signature token was composed from
+    uint8_t key[LQC__sas_keySz];                    /// device key (decoded), keySz 0 = use config signature
+    uint8_t keySz;
+    uint32_t ttlSecs;
+    lqcEpochTime_func epochTimeCB;                  /// NULL if expiry not tracked
+    bool expiredNotified;                           /// config signature mode: application notified of expiry
+} lqcSasToken_t;
+
+
+/** 
+ *  \brief Gateway mode, child registry and round-robin service position.
+*/
+typedef struct lqcGateway_tag
+{
+    lqcGatewayChild_t *children;                    /// NULL if gateway mode not enabled; open addressed by device ID hash
+    uint16_t tableSz;
+    uint16_t childCnt;
+    uint16_t cursor;                                /// next child serviced for upstream sends (round-robin)
+    uint16_t actionCursor;                          /// next child serviced for action dispatch (application thread)
+} lqcGateway_t;
+
+
+/** 
+ *  \brief CoAP transport exchange state, one exchange (message, or block) outstanding.
+*/
+typedef struct lqcCoapCtrl_tag
+{
+    lqcCoapSendDatagram_func sendDatagramCB;
+    bool confirmable;
+    uint16_t msgId;                                 /// last CoAP message ID sent
+    uint32_t token;                                 /// last request token (4 bytes)
+    bool acked;                                     /// empty ACK received, separate response to follow
+    bool rspReceived;
+    uint8_t rspCode;                                /// CoAP response code (class << 5 | detail)
+} lqcCoapCtrl_t;
+
+
 typedef struct lqcPendingEvents_tag
 {
     bool startAlert;
@@ -108,13 +427,19 @@ typedef struct lqcCommMetrics_tag       /// Note: diagnostic counters below can
     uint16_t sendSucceeds;              /// tally of successful sends
     uint8_t sendFailures;               /// tally of failed sends, consective or not in metrics period
     uint8_t consecutiveSendFails;       /// consecutive send failures; not reset on metrics reset, reset on send successful
+    uint16_t sessionResumes;            /// connects with a persistent session (clean-session false)
+    uint16_t sessionFullSetups;         /// connects with a clean session
 } lqcCommMetrics_t;
 
 
+/**
+ *  \brief Messages sent while not connected, packed FIFO in an application supplied buffer: [topicSz][bodySz][topic\0][body\0]
+*/
 typedef struct lqcRecoveryQueue_tag
 {
     char * queueBuffer;
     uint16_t bufferSz;
+    uint16_t usedSz;
     uint8_t queueCnt;
 
     uint32_t lastTryAt;
@@ -155,23 +480,29 @@ typedef struct lqCloudDevice_tag
     lqcDeviceConfig_t *deviceCnfg;                                  /// device communications settings
     char deviceKey[SET_PROPLEN(lqc__identity_deviceKeySz)];
 
-    // mqttCtrl_t *mqttCtrl;                                        /// MQTT connection to access LQCloud (interactive)
-    // httpCtrl_t *httpCtrl;                                        /// HTTP connection to access LQCloud (sensor)
+    lqcConnectInfo_t connectInfo;                               /// MQTT connection to access LQCloud (interactive), when managed by LQCloud
+    bool isGatewayChild;                                        /// Instance is a gateway child, sends go upstream via the gateway
     // streamCtrl_t *protoCtrl;
 
     uint8_t resetCause;
     bool isOnline;                                              /// Indicates that a viable "connection" exists. HTTP last request/MQTT connection succeeded
     lqcDeviceState_t deviceState;                                   
     uint32_t deviceStateChangeAt;
+    uint32_t bootMillis;                                        /// Millis from MCU boot to first running (boot message queued), 0 until then
+    bool bootPending;                                           /// Boot message not yet accepted (sent or queued), retried from lqc_doWork()
     uint16_t lastMsgId;
 
     lqcApplAction_t applActions[LQC__actionCnt];                /// Application invokable public methods (registered with LQ Cloud). LQ Cloud validates requests prior to messaging device.
-    char actnMsgId[SET_PROPLEN(LQC__action_MsgIdSz)];           /// Action request mId, will be aCId (correlation ID).
-    char actnName[SET_PROPLEN(LQC__action_nameSz)];             /// Last action requested by cloud. Is reset on action request receive.
-    uint16_t actnResult;                                        /// Action result code for last action request. 
+    char *actnInfo;                                             /// Cached getactn response body (application buffer, lqc_setActionInfoCache()), NULL = built per request
+    uint16_t actnInfoLen;                                       /// actnInfo content length, 0 = rebuild required
+    lqcActionCorrelation_t actnPending[LQC__actionPendingCnt];  /// Actions in-flight, awaiting response
+    int8_t actnCurrent;                                         /// actnPending index of the action being performed, -1 if none
+    uint16_t actnResult;                                        /// Action result code for last action response.
+    lqcActionQueue_t actnQueue;                                 /// Received action requests awaiting dispatch from lqc_doWork()
+    lqcRecentActions_t *actnRecent;                             /// Recently received action requests (duplicate suppression), defaults to actnRecentLocal
+    lqcRecentActions_t actnRecentLocal;
     diagnosticInfo_t *diagnosticsInfo;
     lqcCommMetrics_t commMetrics;                               /// Internal operations tracking counters
-    appEventResponse_t appEventResponse;                        /// struct containing optional application response to an appEvent message (callback)
 
     lqcSendMessage_func sendMessageCB;
     applEvntNotify_func applEvntNotifyCB;                       /// Application notification and action/info request callback
@@ -181,6 +512,8 @@ typedef struct lqCloudDevice_tag
     lqcRecoveryQueue_t recoveryQueue;
     uint16_t droppedAlrtMsgCnt;
     uint16_t droppedTeleMsgCnt;
+    uint16_t droppedActnRqstCnt;                                /// action requests discarded without a response (queue and reject list full)
+    uint16_t duplicateActnRqstCnt;                              /// action requests redelivered by cloud, not performed again
 } lqCloudDevice_t;
 
 
@@ -193,7 +526,7 @@ extern "C"
 /* Version 0.2.1
 */
 bool LQC_tryConnect();
-lqcSendResult_t LQC_trySend(const char *topic, const char *body, bool queueOnFail, uint8_t timeoutSeconds);
+lqcSendResult_t LQC_trySend(lqCloudDevice_t *lqc, const char *topic, const char *body, bool queueOnFail, uint8_t timeoutSeconds);
 
 
 
@@ -201,8 +534,11 @@ lqcSendResult_t LQC_trySend(const char *topic, const char *body, bool queueOnFai
 
 /* LQCloud Internal Use Functions LQC_ prefix
 * These are not defined static because they are used across compilation units.
+* Functions taking an lqCloudDevice_t pointer operate on that instance; g_lqCloud is the default instance and the only
+* one serviced by the connection manager and the alternate transports (HTTP fallback, data pump, CoAP).
 ------------------------------------------------------------------------------------------------ */
-void LQC_invokeAppEventCBRequest(const char *eventTag, const char *eventMsg);
+void LQC_invokeAppEventCBRequest(lqCloudDevice_t *lqc, const char *eventTag, const char *eventMsg);
+bool LQC_requestAppEventResponse(lqCloudDevice_t *lqc, const char *eventTag, appEventResponse_t *response);
 void LQC_faultHandler(const char *faultMsg);
 
 
@@ -210,25 +546,91 @@ void LQC_faultHandler(const char *faultMsg);
 uint16_t LQC_getMsgId();
 lqcSendResult_t LQC_sendToCloud(const char *topic, const char *body, bool retryFailed, uint8_t timeoutSeconds);
 
-void LQC_doStartEvents();
+void LQC_doStartEvents(lqCloudDevice_t *lqc);
 
 // cloud alerts
 /**
- *  \brief Send device started Alert message to LQCloud.
- *  \return lqcSendResult enum value describing outcome
+ *  \brief Send boot Alert message to LQCloud: device, reset cause, network and any pending diagnostics in one message.
+ *  \return lqcSendResult enum value describing outcome, queued until connected if not online
 */
-lqcSendResult_t LQC_sendDeviceStarted();
+lqcSendResult_t LQC_sendBootMessage(lqCloudDevice_t *lqc);
 
-lqcSendResult_t LQC_sendDiagnosticsAlert(diagnosticInfo_t * diagInfo);
+lqcSendResult_t LQC_sendDiagnosticsAlert(lqCloudDevice_t *lqc, diagnosticInfo_t * diagInfo);
 
-lqcSendResult_t LQC_sendAlert(lqcEventClass_t alrtClass, const char *alrtName, const char *alrtSummary, const char *bodyJson);
+lqcSendResult_t LQC_sendAlert(lqCloudDevice_t *lqc, lqcEventClass_t alrtClass, const char *alrtName, const char *alrtSummary, const char *bodyJson);
 
 // cloud actions
-void LQC_processIncomingActionRequest(const char *actnName, keyValueDict_t actnParams, const char *msgBody);
+void LQC_processIncomingActionRequest(lqCloudDevice_t *lqc, const char *actnName, keyValueDict_t actnParams, const char *msgBody);
+void LQC_enqueueActionRequest(lqCloudDevice_t *lqc, const char *message, uint16_t messageSz, const char *props);
+void LQC_dispatchActionRequests(lqCloudDevice_t *lqc);
+void LQC_checkActionTimeouts(lqCloudDevice_t *lqc);
+void LQC_initRecentActions(lqCloudDevice_t *lqc, lqcRecentActions_t *recentActions);
+uint8_t LQC_peekPropValue(const char *props, const char *key, char *value, uint8_t valueSz);
+uint32_t LQC_hashKey(const char *key, uint16_t keyLen);
+
+// cloud chunked transfers
+bool LQC_receiveTransferChunk(const char *message, uint16_t messageSz, const char *props);
+bool LQC_isTransferChunk(const char *props);
+void LQC_doTransferWork();
+
+// connection manager
+void LQC_manageConnection();
+void LQC_requestConnect();
+bool LQC_flushSendQueue(lqCloudDevice_t *lqc);
+void LQC_drainSendRing();
+
+// transport (HTTP fallback)
+resultCode_t LQC_sendHttp(const char *topic, const char *body, uint8_t timeoutSeconds);
+bool LQC_httpFallbackActive();
+void LQC_trackMqttFailure();
+void LQC_trackMqttSuccess();
+void LQC_resumeMqtt();
+bool LQC_dataPumpEnabled();
+lqcSendResult_t LQC_appendToBatch(const char *topic, const char *body);
+void LQC_doDataPumpWork();
+
+// ISR events
+void LQC_doIsrEventWork();
+bool LQC_isrEventsPending();
+
+// scheduler
+void LQC_doSchedulerWork();
+uint32_t LQC_schedulerNextWakeup();
+
+// next wakeup
+uint32_t LQC_millisUntil(uint32_t startAt, uint32_t periodMillis);
+void LQC_signalWakeup();
+uint32_t LQC_actionsNextWakeup(lqCloudDevice_t *lqc);
+uint32_t LQC_connectNextWakeup();
+uint32_t LQC_dataPumpNextWakeup();
+uint32_t LQC_transferNextWakeup();
+bool LQC_transferPending();
+
+// gateway mode
+bool LQC_gatewayRewriteTopic(lqCloudDevice_t *lqc, const char *topic, char *gwTopic, uint16_t gwTopicSz);
+bool LQC_gatewaySendPending();
+void LQC_doGatewayWork();
+void LQC_doGatewayActionWork();
+
+// worker mode
+void LQC_doNetworkWork();
+bool LQC_workerRunning();
+bool LQC_onWorkerThread();
+void LQC_startWorker();
+void LQC_workerRequestConnect();
+bool LQC_workerCompletionsPending();
+void LQC_postCompletion(lqCloudDevice_t *lqc, const char *eventTag, const char *eventMsg);
+void LQC_deliverCompletions();
+void LQC_workerLock();
+void LQC_workerUnlock();
+
+// SAS token
+const char *LQC_getSasToken();
+void LQC_doSasWork();
 
 // metrics
-void LQC_composeCommMetricsReport(char *report, uint8_t bufferSz);
-void LQC_clearCommMetrics();
+void LQC_composeCommMetricsReport(lqCloudDevice_t *lqc, char *report, uint8_t bufferSz);
+void LQC_clearMetrics(lqCloudDevice_t *lqc, lqcMetricsType_t metricType);
 
 #ifdef __cplusplus
 }
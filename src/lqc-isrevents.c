@@ -0,0 +1,223 @@
+/******************************************************************************
+ *  \file lqc-isrevents.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client ISR Event Capture
+ *
+ * Interrupt handlers record small fixed-size events (ID, timestamp, a few
+ * values) into a single-producer/single-consumer ring; recording is a handful
+ * of stores, no blocking. lqc_doWork() later expands each record into an
+ * alert or telemetry message per the event's registered definition.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "ISR"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+
+
+#pragma region Static Local Declarations
+static lqcIsrRing_t S__isrRing;                                        // ISR captured events awaiting expansion
+static lqcIsrEventDef_t *S__findEventDef(uint8_t eventId);
+static void S__expandEvent(lqcIsrEventDef_t *eventDef, lqcIsrEvent_t *event, uint16_t droppedCnt);
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Define how records for an ISR event ID are expanded into alerts or telemetry.
+ *
+ *	\param [in] eventId - Application event ID, recorded by lqc_isrRecordEvent().
+ *  \param [in] eventType - Send as telemetry or alert.
+ *  \param [in] evntName - Telemetry/alert name (application constant, not copied).
+ *  \param [in] valueNames - Comma separated property names for the values (application constant), NULL for "v" array.
+ *  \return False if no definition slots remain.
+ */
+bool lqc_registerIsrEvent(uint8_t eventId, lqcIsrEventType_t eventType, const char *evntName, const char *valueNames)
+{
+    lqcIsrEventDef_t *eventDef = S__findEventDef(eventId);
+
+    for (size_t i = 0; eventDef == NULL && i < LQC__isrEventDefCnt; i++)
+    {
+        if (S__isrRing.defs[i].evntName == NULL)
+            eventDef = &S__isrRing.defs[i];
+    }
+    if (eventDef == NULL)
+        return false;
+
+    eventDef->eventId = eventId;
+    eventDef->eventType = eventType;
+    eventDef->valueNames = valueNames;
+    eventDef->evntName = evntName;
+    return true;
+}
+
+
+/**
+ *	\brief Record an event, invoked from interrupt context. Wait-free: ring full drops (and counts) the event.
+ *
+ *  Single producer, record only from ISRs at one priority level (or with nesting disabled).
+ */
+bool lqc_isrRecordEvent(uint8_t eventId, int32_t value0, int32_t value1, int32_t value2)
+{
+    lqcIsrRing_t *ring = &S__isrRing;
+    uint8_t head = ring->head;
+
+    if ((uint8_t)(head - ring->tail) == LQC__isrEventCnt)
+    {
+        ring->droppedCnt++;
+        return false;
+    }
+
+    lqcIsrEvent_t *event = &ring->records[head & (LQC__isrEventCnt - 1)];
+    event->timestamp = pMillis();
+    event->eventId = eventId;
+    event->values[0] = value0;
+    event->values[1] = value1;
+    event->values[2] = value2;
+
+    __atomic_signal_fence(__ATOMIC_RELEASE);                                // record complete before it is published
+    ring->head = head + 1;
+    LQC_signalWakeup();                                                     // Linux hosts: wake poll/epoll loop (write is signal-safe)
+    return true;
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+bool LQC_isrEventsPending()
+{
+    return S__isrRing.tail != S__isrRing.head;
+}
+
+
+/**
+ *	\brief Expand recorded ISR events into alerts/telemetry, invoked from lqc_doWork(). Up to LQC__isrEvent_expandBudget per pass.
+ */
+void LQC_doIsrEventWork()
+{
+    lqcIsrRing_t *ring = &S__isrRing;
+
+    for (size_t i = 0; i < LQC__isrEvent_expandBudget && ring->tail != ring->head; i++)
+    {
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);                            // head read before record content
+        lqcIsrEvent_t event = ring->records[ring->tail & (LQC__isrEventCnt - 1)];
+        __atomic_signal_fence(__ATOMIC_RELEASE);
+        ring->tail++;                                                       // slot free to ISR once copied, before the (blocking) send
+
+        lqcIsrEventDef_t *eventDef = S__findEventDef(event.eventId);
+        if (eventDef == NULL)
+        {
+            PRINTF(dbgColor__warn, "IsrEvent: id=%d not registered\r", event.eventId);
+            continue;
+        }
+
+        uint16_t droppedCnt = ring->droppedCnt;
+        S__expandEvent(eventDef, &event, droppedCnt - ring->droppedReported);
+        ring->droppedReported = droppedCnt;
+    }
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+static lqcIsrEventDef_t *S__findEventDef(uint8_t eventId)
+{
+    for (size_t i = 0; i < LQC__isrEventDefCnt; i++)
+    {
+        if (S__isrRing.defs[i].evntName != NULL && S__isrRing.defs[i].eventId == eventId)
+            return &S__isrRing.defs[i];
+    }
+    return NULL;
+}
+
+
+/**
+ *	\brief Compose the record as a JSON object ({"ts":..,"age":..,"<name>":value,..}) and send it.
+ *
+ *  age is millis from capture to expansion; drops is included when events were lost to a full ring since the last record sent.
+ */
+static void S__expandEvent(lqcIsrEventDef_t *eventDef, lqcIsrEvent_t *event, uint16_t droppedCnt)
+{
+    char body[lqc__msg_bodySz];
+    uint16_t bodyLen;
+    uint16_t bodyMax = sizeof(body) - 2;                                        // room for closing brace
+    const char *valueName = eventDef->valueNames;
+
+    bodyLen = snprintf(body, sizeof(body), "{\"ts\":%lu,\"age\":%lu", (unsigned long)event->timestamp, (unsigned long)(pMillis() - event->timestamp));
+    bodyLen = MIN(bodyLen, bodyMax);
+    if (droppedCnt > 0)
+    {
+        bodyLen += snprintf(body + bodyLen, sizeof(body) - bodyLen, ",\"drops\":%d", droppedCnt);
+        bodyLen = MIN(bodyLen, bodyMax);
+    }
+
+    if (valueName == NULL)
+    {
+        bodyLen += snprintf(body + bodyLen, sizeof(body) - bodyLen, ",\"v\":[%ld,%ld,%ld]", (long)event->values[0], (long)event->values[1], (long)event->values[2]);
+        bodyLen = MIN(bodyLen, bodyMax);
+    }
+    else
+    {
+        for (size_t i = 0; i < LQC__isrEvent_valueCnt && *valueName != '\0'; i++)
+        {
+            const char *nameEnd = strchr(valueName, ',');
+            uint16_t nameLen = (nameEnd != NULL) ? (uint16_t)(nameEnd - valueName) : (uint16_t)strlen(valueName);
+
+            bodyLen += snprintf(body + bodyLen, sizeof(body) - bodyLen, ",\"%.*s\":%ld", nameLen, valueName, (long)event->values[i]);
+            bodyLen = MIN(bodyLen, bodyMax);                                    // long value names: truncated, not past body
+            valueName += nameLen + ((nameEnd != NULL) ? 1 : 0);
+        }
+    }
+    snprintf(body + bodyLen, sizeof(body) - bodyLen, "}");
+
+    if (eventDef->eventType == lqcIsrEventType_alert)
+        LQC_sendAlert(&g_lqCloud, lqcEventClass_application, eventDef->evntName, "", body);
+    else
+        lqcInst_sendTelemetry(&g_lqCloud, eventDef->evntName, "", body);
+}
+
+#pragma endregion
@@ -54,19 +54,30 @@ extern diagnosticControl_t g_diagControl;
  */
 void lqc_reportCommMetrics()
 {
-    char alrtSummary[40];
-    char alrtBody[120] = {0};
+    lqcInst_reportCommMetrics(&g_lqCloud);
+}
 
-    snprintf(alrtSummary, sizeof(alrtSummary), "%s CommMetrics", g_lqCloud.deviceCnfg->deviceLabel);
-    LQC_composeCommMetricsReport(alrtBody, sizeof(alrtBody));
-    LQC_sendAlert(lqcEventClass_lqcloud, "CommMetricsReport", alrtSummary, alrtBody);
 
-    g_lqCloud.commMetrics.metricsStart = pMillis;                       // reset LQC comm metrics
-    g_lqCloud.commMetrics.connectResets = 0;
-    g_lqCloud.commMetrics.sendLastDuration = 0;
-    g_lqCloud.commMetrics.sendMaxDuration = 0;
-    g_lqCloud.commMetrics.sendSucceeds = 0;
-    g_lqCloud.commMetrics.sendFailures = 0;
+/**
+ *	\brief Send the comm metrics of a specific LQCloud instance, metrics are reset once sent.
+ */
+void lqcInst_reportCommMetrics(lqcHandle_t lqc)
+{
+    char alrtSummary[40];
+    char alrtBody[160] = {0};
+
+    snprintf(alrtSummary, sizeof(alrtSummary), "%s CommMetrics", lqc->deviceCnfg->deviceLabel);
+    LQC_composeCommMetricsReport(lqc, alrtBody, sizeof(alrtBody));
+    LQC_sendAlert(lqc, lqcEventClass_lqcloud, "CommMetricsReport", alrtSummary, alrtBody);
+
+    lqc->commMetrics.metricsStart = pMillis;                            // reset LQC comm metrics
+    lqc->commMetrics.connectResets = 0;
+    lqc->commMetrics.sendLastDuration = 0;
+    lqc->commMetrics.sendMaxDuration = 0;
+    lqc->commMetrics.sendSucceeds = 0;
+    lqc->commMetrics.sendFailures = 0;
+    lqc->commMetrics.sessionResumes = 0;
+    lqc->commMetrics.sessionFullSetups = 0;
 }
 
 
@@ -83,7 +94,7 @@ void lqc_reportDiagnostics()
     snprintf(alrtSummary, sizeof(alrtSummary), "%s Diags", g_lqCloud.deviceCnfg->deviceLabel);
     LQC_composeDiagnosticsReport(alrtBody, sizeof(alrtBody));
 
-    LQC_sendAlert(lqcEventClass_lqcloud, "DiagnosticsReport", alrtSummary, alrtBody);
+    LQC_sendAlert(&g_lqCloud, lqcEventClass_lqcloud, "DiagnosticsReport", alrtSummary, alrtBody);
 }
 
 
@@ -100,26 +111,29 @@ void lqc_reportFault()
     snprintf(alrtSummary, sizeof(alrtSummary), "%s Diags", g_lqCloud.deviceCnfg->deviceLabel);
     LQC_composeFaultReport(alrtBody, sizeof(alrtBody));
 
-    LQC_sendAlert(lqcEventClass_lqcloud, "FaultReport", alrtSummary, alrtBody);
+    LQC_sendAlert(&g_lqCloud, lqcEventClass_lqcloud, "FaultReport", alrtSummary, alrtBody);
 }
 
 
-void LQC_composeCommMetricsReport(char *report, uint8_t bufferSz)
+void LQC_composeCommMetricsReport(lqCloudDevice_t *lqc, char *report, uint8_t bufferSz)
 {
-    snprintf(report, bufferSz, "{\"resets\":%d,\"sndMaxDur\":%d,\"sndLstDur\":%d,\"succeedCnt\":%d, \"failCnt\":%d}\r", 
-             g_lqCloud.commMetrics.connectResets,
-             g_lqCloud.commMetrics.sendMaxDuration,
-             g_lqCloud.commMetrics.sendLastDuration,
-             g_lqCloud.commMetrics.sendSucceeds,
-             g_lqCloud.commMetrics.sendFailures
+    snprintf(report, bufferSz, "{\"resets\":%d,\"sndMaxDur\":%d,\"sndLstDur\":%d,\"succeedCnt\":%d, \"failCnt\":%d,\"resumeCnt\":%d,\"fullSetupCnt\":%d,\"bootMs\":%lu}\r", 
+             lqc->commMetrics.connectResets,
+             lqc->commMetrics.sendMaxDuration,
+             lqc->commMetrics.sendLastDuration,
+             lqc->commMetrics.sendSucceeds,
+             lqc->commMetrics.sendFailures,
+             lqc->commMetrics.sessionResumes,
+             lqc->commMetrics.sessionFullSetups,
+             (unsigned long)lqc->bootMillis
     );
 }
 
-void LQC_clearMetrics(lqcMetricsType_t metricType)
+void LQC_clearMetrics(lqCloudDevice_t *lqc, lqcMetricsType_t metricType)
 {
     if (metricType == lqcMetricsType_metrics || metricType == lqcMetricsType_all)
     {
-        memset(&g_lqCloud.commMetrics, 0, sizeof(lqcCommMetrics_t));
+        memset(&lqc->commMetrics, 0, sizeof(lqcCommMetrics_t));
     }
     if (metricType == lqcMetricsType_diagnostics || metricType == lqcMetricsType_all)
     {
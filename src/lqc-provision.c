@@ -40,19 +40,114 @@
 
 #define SRCFILE "PRO"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
 #include "lqc-provision.h"
+#include "lqc-crc.h"
+#include <ctype.h>
+#include <stddef.h>
 
 
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
 
-char *pProvBffr;
+#define FIELD_SEP '^'
+#define CHECK_SEP '~'
+
+static lqcProvisionParser_t *S__provParser;                                     // parser for the request in progress (recv callback context)
 static void httpRecvCB(dataCntxt_t dataCntxt, uint16_t httpStatus, char *recvData, uint16_t dataSz);
+static void S__parserInit(lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig);
+static bool S__parserComplete(lqcProvisionParser_t *parser);
+static bool S__requestConfig(const char *hostUrl, const char *deviceId, const char *validation, const char *ifNoneMatch, lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig, resultCode_t *httpRslt);
+static bool S__readCache(lqcProvisionCache_t *cache, const char *deviceId);
+static void S__writeCache(lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig);
+
+static lqcProvisionCacheRead_func S__cacheReadCB;
+static lqcProvisionCacheWrite_func S__cacheWriteCB;
 
 bool lqcProvision_readLQCCnfig(const char *hostUrl, const char *deviceId, const char *validation, lqcDeviceConfig_t * deviceConfig)
 {
-    /* This uses a local (stack) control\buffer for HTTP, also the application recv buffer (provBuf) is local here and referenced by ptr.
-     * This allows the minimum RAM object lifetime.
+    lqcProvisionParser_t parser;
+    resultCode_t httpRslt;
+
+    if (!S__requestConfig(hostUrl, deviceId, validation, NULL, &parser, deviceConfig, &httpRslt))
+        return false;
+    S__writeCache(&parser, deviceConfig);
+    return true;
+}
+
+
+/**
+ *	\brief Enable the provisioning cache, validated configs are persisted through the application's storage functions.
+ */
+void lqcProvision_enableCache(lqcProvisionCacheRead_func cacheReadCB, lqcProvisionCacheWrite_func cacheWriteCB)
+{
+    S__cacheReadCB = cacheReadCB;
+    S__cacheWriteCB = cacheWriteCB;
+}
+
+
+/**
+ *	\brief Get device config: from the cache if valid for this device (no network), otherwise from the provisioning service.
+ *
+ *  \param [out] fromCache - Optional, set true if config came from the cache (refresh with lqcProvision_refresh() later).
+ *  \return True if deviceConfig is valid.
+ */
+bool lqcProvision_getConfig(const char *hostUrl, const char *deviceId, const char *validation, lqcDeviceConfig_t *deviceConfig, bool *fromCache)
+{
+    lqcProvisionCache_t cache;
+
+    if (fromCache != NULL)
+        *fromCache = false;
+    if (S__readCache(&cache, deviceId))
+    {
+        memcpy(deviceConfig, &cache.deviceConfig, sizeof(lqcDeviceConfig_t));
+        if (fromCache != NULL)
+            *fromCache = true;
+        PRINTF(dbgColor__dMagenta, "Provision: cached config v%s\r", cache.version);
+        return true;
+    }
+    return lqcProvision_readLQCCnfig(hostUrl, deviceId, validation, deviceConfig);
+}
+
+
+/**
+ *	\brief Refresh the cached config by conditional request, the service answers 304 (no body) if the package is unchanged.
+ *
+ *  \param [out] deviceConfig - Updated only if result is lqcProvisionRefresh_updated.
+ *  \return Refresh outcome, on updated the application should reconnect with the new config.
+ */
+lqcProvisionRefresh_t lqcProvision_refresh(const char *hostUrl, const char *deviceId, const char *validation, lqcDeviceConfig_t *deviceConfig)
+{
+    lqcProvisionCache_t cache;
+    lqcDeviceConfig_t refreshedConfig;
+    lqcProvisionParser_t parser;
+    resultCode_t httpRslt;
+    char etag[12] = {0};
+
+    if (S__readCache(&cache, deviceId))
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)cache.packageCrc);     // package CRC is the entity tag
+
+    if (!S__requestConfig(hostUrl, deviceId, validation, (etag[0] != '\0') ? etag : NULL, &parser, &refreshedConfig, &httpRslt))
+        return (httpRslt == lqcProvision__httpNotModified) ? lqcProvisionRefresh_notModified : lqcProvisionRefresh_failed;
+
+    if (etag[0] != '\0' && lqcCrc_final(parser.crc) == cache.packageCrc)
+        return lqcProvisionRefresh_notModified;                                 // service ignored If-None-Match, same package
+
+    memcpy(deviceConfig, &refreshedConfig, sizeof(lqcDeviceConfig_t));
+    S__writeCache(&parser, deviceConfig);
+    return lqcProvisionRefresh_updated;
+}
+
+
+/**
+ *	\brief Request config package from the provisioning service, optionally conditional (If-None-Match).
+ *
+ *  \param [out] httpRslt - Result of the last request, lqcProvision__httpNotModified if conditional and unchanged.
+ *  \return True if a complete, validated package was received into deviceConfig.
+ */
+static bool S__requestConfig(const char *hostUrl, const char *deviceId, const char *validation, const char *ifNoneMatch, lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig, resultCode_t *httpRslt)
+{
+    /* This uses a local (stack) control\buffer for HTTP, response body is parsed as it arrives (no page buffer), fields
+     * are written directly into deviceConfig.
 
     /* 00^CMDevl^SharedAccessSignature sr=iothub-dev-pelogical.azure-devices.net%2Fdevices%2F864508030074113&sig=aEPPyLTUKMj29HBGfrwZ20uPzGOxDlW1XwnmtEKaLvc%3D&se=1788816293^088410a1
        f^kkk^CMDevl^SharedAccessSignature sr=iothub-dev-pelogical.azure-devices.net%2Fdevices%2F864508030074113&sig=aEPPyLTUKMj29HBGfrwZ20uPzGOxDlW1XwnmtEKaLvc%3D&se=1788816293^088410a1
@@ -64,12 +159,8 @@ bool lqcProvision_readLQCCnfig(const char *hostUrl, const char *deviceId, const
         Packages are limited to 253 bytes in length
      */
     httpCtrl_t httpCtrl;
-    char httpCtrlBffr[512];
-    char provBffr[512];
-    char cstmHeaders[80];
-    char packageKey[4] = {0};
-    char lqcToken[200] = {0};
-    pProvBffr = &provBffr;
+    char httpCtrlBffr[lqcProvision__recvBufferSz];
+    char cstmHeaders[112];
 
     http_initControl(&httpCtrl, dataCntxt_5, httpCtrlBffr, sizeof(httpCtrlBffr), httpRecvCB);
     http_setConnection(&httpCtrl, hostUrl, 0);
@@ -77,128 +168,185 @@ bool lqcProvision_readLQCCnfig(const char *hostUrl, const char *deviceId, const
 
     // Get LQC connection configs from provisioning service
     // HARD CODED for LQC provisioning (WebAPI)
-    memset(provBffr, 0, sizeof(provBffr));
-    snprintf(cstmHeaders, sizeof(cstmHeaders), "lqc-dvc-val: %s\r\n", validation);             // add req'd validation header
+    uint8_t hdrsLen = snprintf(cstmHeaders, sizeof(cstmHeaders), "lqc-dvc-val: %s\r\n", validation);     // add req'd validation header
+    if (ifNoneMatch != NULL && hdrsLen < sizeof(cstmHeaders))
+        snprintf(cstmHeaders + hdrsLen, sizeof(cstmHeaders) - hdrsLen, "If-None-Match: %s\r\n", ifNoneMatch);
     //http_addCustomHdr(&httpCtrl, cstmHeaders);
 
-    memset(deviceConfig, 0, sizeof(lqcDeviceConfig_t));
     char relativeUrl[60] = "/provisioning/config/";
-    strcat(relativeUrl, deviceId);
-
-    #define FIELD_SEP '^'
-    #define CHECK_SEP '~'
+    strncat(relativeUrl, deviceId, sizeof(relativeUrl) - strlen(relativeUrl) - 1);
 
     uint8_t tries = 0;
     bool provisioningSuccess = false;
     bool retryFailure = true;
-    char *pNext = NULL;
-    char *pStop = NULL;
 
     do // retry block
     {
-        do // sequence block
-        {
-            tries++;
-            resultCode_t rslt = http_get(&httpCtrl, relativeUrl, false, 20);
-            if (rslt != resultCode__success)
-            {
-                if (rslt != resultCode__timeout)
-                    retryFailure = false;
-                break; // exit sequence block
-            }
-
-            rslt = http_readPage(&httpCtrl, 20);
-            if (rslt != resultCode__success)
-                break;
+        tries++;
+        S__parserInit(parser, deviceConfig);
+        S__provParser = parser;
 
-            if (!STRNCMP(provBffr, LQC_PROVISIONING_MAGICFLAG, 4) ||
-                memchr(provBffr, FIELD_SEP, sizeof(provBffr)) == NULL ||
-                memchr(provBffr, CHECK_SEP, sizeof(provBffr)) == NULL)
-                break;                                                          // exit block with prov success false
+        *httpRslt = http_get(&httpCtrl, relativeUrl, false, 20);
+        if (*httpRslt == resultCode__success)
+            *httpRslt = http_readPage(&httpCtrl, 20);
+        else if (*httpRslt != resultCode__timeout)
+            retryFailure = false;                                               // includes 304 not modified
 
-            memcpy(deviceConfig->magicFlag, provBffr , 4);                      // grab package identification
-            memcpy(deviceConfig->packageId, provBffr + 5, 4);
-            strncpy(deviceConfig->deviceId, deviceId, lqc__identity_deviceIdSz);
+        provisioningSuccess = (*httpRslt == resultCode__success) && S__parserComplete(parser);
+    }
+    while (!provisioningSuccess && retryFailure && tries < 2);
 
-            /* this function only fetches LQC configs */
-            if (!STRCMP(deviceConfig->magicFlag, "LQCP") ||
-                !STRCMP(deviceConfig->packageId, "LQCC"))
-                break;
+    S__provParser = NULL;
+    if (provisioningSuccess)
+        strncpy(deviceConfig->deviceId, deviceId, lqc__identity_deviceIdSz);
+    else
+        memset(deviceConfig, 0, sizeof(lqcDeviceConfig_t));                    // no partial config
+    return provisioningSuccess;
+}
 
-            /* parse provisioning service response into device config
-             */
-            pNext = pProvBffr + 10;                                             // package version (variable width)past package id
-            pNext = strchr(pNext, FIELD_SEP) + 1;                               // device label
-            pStop = strchr(pNext, FIELD_SEP);
-            if (pStop - pNext > lqc__identity_deviceLabelSz) 
-                break;
-            memcpy(deviceConfig->deviceLabel, pNext, pStop - pNext);
 
-            pNext = pStop + 1;                                                  // host URL
-            pStop = strchr(pNext, FIELD_SEP);
-            if (pStop - pNext > lqc__identity_hostUrlSz) 
-                break;
-            memcpy(deviceConfig->hostUrl, pNext, pStop - pNext);
+/**
+ *	\brief Parse a response body chunk: fields are copied to the device config with length limits, CRC is accumulated
+ *  over the package content (everything before CHECK_SEP). Any violation fails the parse, remaining input is ignored.
+ */
+void lqcProvision_parseChunk(lqcProvisionParser_t *parser, const char *chunk, uint16_t chunkSz)
+{
+    lqcDeviceConfig_t *cnfg = parser->deviceConfig;
+    uint16_t crcStart = (parser->state <= lqcProvisionField_signature) ? 0 : chunkSz;     // chunk offset of package content for CRC
+    uint16_t i;
 
-            pStop++;                                                            // host port
-            deviceConfig->hostPort = strtol(pStop, &pNext, 10);
+    for (i = 0; i < chunkSz && parser->state < lqcProvisionField_done; i++)
+    {
+        char c = chunk[i];
 
-            pNext++;                                                            // signature
-            pStop = strchr(pNext, CHECK_SEP);
-            if (pStop - pNext > lqc__identity_signatureSz)
+        if (parser->state == lqcProvisionField_crc)
+        {
+            if (!isxdigit(c) || parser->fieldLen == 8)
+            {
+                parser->state = (parser->fieldLen == 8) ? lqcProvisionField_done : lqcProvisionField_failed;
                 break;
-            memcpy(deviceConfig->signature, pNext, pStop - pNext);
+            }
+            parser->recvCrc = (parser->recvCrc << 4) | (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+            if (++parser->fieldLen == 8)
+                parser->state = lqcProvisionField_done;
+            continue;
+        }
 
-            pStop[0] = '\0';                                                    // remove recv'd CRC from provBuf scope for CRC calc
-            pNext = ++pStop;
-            if (strlen(pNext) >= 8)                                                                
+        if (c == CHECK_SEP || c == FIELD_SEP)
+        {
+            if ((c == CHECK_SEP) != (parser->state == lqcProvisionField_signature))
             {
-                uint32_t provCrc = strtoul(pNext, &pStop, 16);
-                uint32_t crcHash = crc32(provBffr);  
-                provisioningSuccess = (provCrc == crcHash);                     // recv'd CRC matches locally calc'd
-
-                pStop[0] = '\0';
-                PRINTF(dbgColor__dMagenta, "CRC rHex=%s, provCrc=%lu lclCrc=%lu\r", pNext, provCrc, crcHash);
+                parser->state = lqcProvisionField_failed;                               // separator out of sequence
+                break;
+            }
+            if (c == CHECK_SEP)
+            {
+                parser->crc = lqcCrc_update(parser->crc, chunk + crcStart, i - crcStart);
+                crcStart = chunkSz;                                                     // CRC complete
             }
-        } while (!provisioningSuccess);
+            parser->state++;
+            parser->fieldLen = 0;
+            continue;
+        }
+
+        char *field = NULL;
+        uint8_t fieldMax = 0;
+        switch (parser->state)
+        {
+            case lqcProvisionField_magic:       field = cnfg->magicFlag;    fieldMax = lqc__magicFlagSz;              break;
+            case lqcProvisionField_packageId:   field = cnfg->packageId;    fieldMax = lqc__identity_packageIdSz;     break;
+            case lqcProvisionField_version:     field = parser->version;    fieldMax = lqcProvision__versionSz;       break;
+            case lqcProvisionField_label:       field = cnfg->deviceLabel;  fieldMax = lqc__identity_deviceLabelSz;   break;
+            case lqcProvisionField_hostUrl:     field = cnfg->hostUrl;      fieldMax = lqc__identity_hostUrlSz;       break;
+            case lqcProvisionField_port:        fieldMax = 5;                                                          break;
+            case lqcProvisionField_signature:   field = cnfg->signature;    fieldMax = lqc__identity_signatureSz;     break;
+            default:                                                                                            break;
+        }
+
+        if (parser->fieldLen == fieldMax || (parser->state == lqcProvisionField_port && !isdigit(c)))
+        {
+            parser->state = lqcProvisionField_failed;                                   // field too long (or port not numeric)
+            break;
+        }
+        if (field != NULL)
+            field[parser->fieldLen] = c;                                                // deviceConfig zeroed, field stays NULL terminated
+        else if (parser->state == lqcProvisionField_port)
+            cnfg->hostPort = cnfg->hostPort * 10 + (c - '0');
+        parser->fieldLen++;
     }
-    while (!provisioningSuccess && retryFailure && tries < 2);
 
-    return provisioningSuccess;
+    if (crcStart < chunkSz)
+        parser->crc = lqcCrc_update(parser->crc, chunk + crcStart, i - crcStart);      // package content in this chunk
 }
 
 
 static void httpRecvCB(dataCntxt_t dataCntxt, uint16_t httpStatus, char *recvData, uint16_t dataSz)
 {
     PRINTF(dbgColor__dMagenta, "ProvisionCB %d new chars\r", dataSz);
-    uint16_t prevRcvd = strlen(pProvBffr);
-    strncpy(pProvBffr + prevRcvd, recvData, dataSz);
+    if (S__provParser == NULL)
+        return;
+    if (httpStatus != 200)
+        S__provParser->state = lqcProvisionField_failed;
+    lqcProvision_parseChunk(S__provParser, recvData, dataSz);
 }
 
 
-/*  This is the basic CRC-32 calculation with some optimization but no table lookup. The the byte 
- *  reversal is avoided by shifting the crc reg right instead of left and by using a reversed 
- *  32-bit word to represent the polynomial.
- *
- *  http://www.hackersdelight.org/hdcodetxt/crc.c.txt
+static void S__parserInit(lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig)
+{
+    memset(parser, 0, sizeof(lqcProvisionParser_t));
+    memset(deviceConfig, 0, sizeof(lqcDeviceConfig_t));
+    parser->deviceConfig = deviceConfig;
+    parser->state = lqcProvisionField_magic;
+    parser->crc = lqcCrc_init();
+}
+
+
+/**
+ *	\brief Package fully received, identified as an LQC config package and CRC matches.
+ */
+static bool S__parserComplete(lqcProvisionParser_t *parser)
+{
+    lqcDeviceConfig_t *cnfg = parser->deviceConfig;
+    uint32_t crcHash = lqcCrc_final(parser->crc);
+
+    PRINTF(dbgColor__dMagenta, "Provision state=%d, provCrc=%lu lclCrc=%lu\r", parser->state, parser->recvCrc, crcHash);
+    return parser->state == lqcProvisionField_done &&
+           parser->recvCrc == crcHash &&
+           STRNCMP(cnfg->magicFlag, LQC_PROVISIONING_MAGICFLAG, 4) &&
+           STRCMP(cnfg->magicFlag, "LQCP") &&
+           STRCMP(cnfg->packageId, "LQCC");
+}
+
+
+/**
+ *	\brief Read the cache record, valid if its record CRC matches and it holds a config for this device.
  */
+static bool S__readCache(lqcProvisionCache_t *cache, const char *deviceId)
+{
+    if (S__cacheReadCB == NULL || !S__cacheReadCB(cache))
+        return false;
 
-unsigned int crc32(unsigned char *message) {
-   int i, j;
-   unsigned int byte, crc, mask;
-
-   i = 0;
-   crc = 0xFFFFFFFF;
-   while (message[i] != 0) {
-      byte = message[i];            // Get next byte.
-      crc = crc ^ byte;
-      for (j = 7; j >= 0; j--) {    // Do eight times.
-         mask = -(crc & 1);
-         crc = (crc >> 1) ^ (0xEDB88320 & mask);
-      }
-      i = i + 1;
-   }
-   return ~crc;                     // reverse bit order (see above)
+    return cache->cacheMagic == lqcProvision__cacheMagic &&
+           cache->recordCrc == lqcCrc_compute(cache, offsetof(lqcProvisionCache_t, recordCrc)) &&
+           STRNCMP(cache->deviceConfig.deviceId, deviceId, lqc__identity_deviceIdSz);
 }
 
 
+static void S__writeCache(lqcProvisionParser_t *parser, lqcDeviceConfig_t *deviceConfig)
+{
+    lqcProvisionCache_t cache;
+
+    if (S__cacheWriteCB == NULL)
+        return;
+
+    memset(&cache, 0, sizeof(lqcProvisionCache_t));
+    cache.cacheMagic = lqcProvision__cacheMagic;
+    memcpy(cache.version, parser->version, sizeof(cache.version));
+    cache.packageCrc = lqcCrc_final(parser->crc);
+    memcpy(&cache.deviceConfig, deviceConfig, sizeof(lqcDeviceConfig_t));
+    cache.recordCrc = lqcCrc_compute(&cache, offsetof(lqcProvisionCache_t, recordCrc));
+
+    if (!S__cacheWriteCB(&cache))
+        PRINTF(dbgColor__warn, "Provision: cache write failed\r");
+}
+
@@ -33,13 +33,105 @@
 #include <lqcloud.h>
 
 
+enum lqcProvision_constants
+{
+    lqcProvision__recvBufferSz = 256,       /// HTTP receive buffer, response body is parsed by chunk (no page buffer)
+    lqcProvision__versionSz = 8,            /// package version field
+    lqcProvision__cacheMagic = 0x4C515043,  /// "LQPC" provisioning cache record valid
+    lqcProvision__httpNotModified = 304     /// conditional refresh, cached package is current
+};
+
+
+/** 
+ *  \brief Provisioning package fields, in order received: magic^packageId^version^label^hostUrl^port^signature~crc
+*/
+typedef enum lqcProvisionField_tag
+{
+    lqcProvisionField_magic = 0,
+    lqcProvisionField_packageId,
+    lqcProvisionField_version,
+    lqcProvisionField_label,
+    lqcProvisionField_hostUrl,
+    lqcProvisionField_port,
+    lqcProvisionField_signature,
+    lqcProvisionField_crc,                  /// 8 hex digits following CHECK_SEP
+    lqcProvisionField_done,
+    lqcProvisionField_failed
+} lqcProvisionField_t;
+
+
+/** 
+ *  \brief Incremental provisioning response parser state, bounded (no response buffer).
+*/
+typedef struct lqcProvisionParser_tag
+{
+    lqcDeviceConfig_t *deviceConfig;        /// fields written here as received
+    lqcProvisionField_t state;              /// field being received
+    uint8_t fieldLen;                       /// chars received for current field
+    uint32_t crc;                           /// running CRC of package content
+    uint32_t recvCrc;                       /// CRC sent with the package
+    char version[lqcProvision__versionSz + 1];
+} lqcProvisionParser_t;
+
+
+/** 
+ *  \brief Provisioning cache record, persisted by the application (flash, file); opaque, store and return as-is.
+*/
+typedef struct lqcProvisionCache_tag
+{
+    uint32_t cacheMagic;
+    char version[lqcProvision__versionSz + 1];  /// package version
+    uint32_t packageCrc;                        /// package CRC, the entity tag for conditional refresh
+    lqcDeviceConfig_t deviceConfig;
+    uint32_t recordCrc;                         /// CRC of record (fields above), storage integrity
+} lqcProvisionCache_t;
+
+
+/** 
+ *  \brief Application storage functions for the provisioning cache. Return false if no record or storage failed.
+*/
+typedef bool (*lqcProvisionCacheRead_func)(lqcProvisionCache_t *cache);
+typedef bool (*lqcProvisionCacheWrite_func)(const lqcProvisionCache_t *cache);
+
+
+/** 
+ *  \brief Outcome of a conditional provisioning refresh.
+*/
+typedef enum lqcProvisionRefresh_tag
+{
+    lqcProvisionRefresh_notModified = 0,    /// cached config is current (304 or same package CRC)
+    lqcProvisionRefresh_updated = 1,        /// new config received and cached, reconnect with it
+    lqcProvisionRefresh_failed = 2          /// request failed, cached config remains in use
+} lqcProvisionRefresh_t;
+
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 bool lqcProvision_readLQCCnfig(const char *hostUrl, const char *imei, const char *validationKey, lqcDeviceConfig_t *deviceConfig);
-unsigned int crc32(unsigned char *message);
+
+/**
+ *  \brief Enable the provisioning cache: validated configs (with package version and CRC) are persisted by the application.
+ */
+void lqcProvision_enableCache(lqcProvisionCacheRead_func cacheReadCB, lqcProvisionCacheWrite_func cacheWriteCB);
+
+/**
+ *  \brief Boot path: config from the cache (instant, no network) if valid for deviceId, otherwise from the provisioning service.
+ *  \param [out] fromCache Optional, true if from cache; refresh with lqcProvision_refresh() once the device is running.
+ */
+bool lqcProvision_getConfig(const char *hostUrl, const char *imei, const char *validationKey, lqcDeviceConfig_t *deviceConfig, bool *fromCache);
+
+/**
+ *  \brief Background refresh by conditional request (If-None-Match: package CRC), unchanged costs only a 304 response.
+ */
+lqcProvisionRefresh_t lqcProvision_refresh(const char *hostUrl, const char *imei, const char *validationKey, lqcDeviceConfig_t *deviceConfig);
+
+/**
+ *  \brief Feed a provisioning response body chunk to the parser (chunks of any size, in order).
+ */
+void lqcProvision_parseChunk(lqcProvisionParser_t *parser, const char *chunk, uint16_t chunkSz);
 
 
 #ifdef __cplusplus
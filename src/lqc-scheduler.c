@@ -0,0 +1,249 @@
+/******************************************************************************
+ *  \file lqc-scheduler.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client Timer Scheduler
+ *
+ * Application and library periodic/one-shot work as timers held in a binary
+ * min-heap by deadline. lqc_doWork() tests only the earliest deadline, cost
+ * does not grow with the number of timers (start/stop/fire are O(log n)).
+ * Periodic timers due within LQC__scheduler_alignMillis of a firing are fired
+ * with it, so several jobs share one wakeup (see lqc_nextWakeupMs()).
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "SCH"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define DUE_BEFORE(a, b) ((int32_t)((a) - (b)) < 0)     // deadline compare, millis rollover safe
+
+
+#pragma region Static Local Declarations
+static lqcScheduler_t S__scheduler;
+static void S__heapInsert(lqcTimer_t *timer);
+static void S__heapRemove(uint8_t indx);
+static void S__siftUp(uint8_t indx);
+static void S__siftDown(uint8_t indx);
+static void S__heapPlace(lqcTimer_t *timer, uint8_t indx);
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Initialize a timer, not running until lqc_timerStart().
+ *
+ *	\param [in] timer - Application timer object, must remain valid while running.
+ *  \param [in] timerCB - Function invoked from lqc_doWork() when due.
+ *  \param [in] userData - Passed to timerCB.
+ */
+void lqc_timerInit(lqcTimer_t *timer, lqcTimer_func timerCB, void *userData)
+{
+    memset(timer, 0, sizeof(lqcTimer_t));
+    timer->timerCB = timerCB;
+    timer->userData = userData;
+    timer->heapIndx = LQC__schedulerTimerCnt;
+}
+
+
+/**
+ *	\brief Start or restart a timer.
+ *
+ *	\param [in] timer - Initialized timer.
+ *  \param [in] delayMillis - Millis until first firing.
+ *  \param [in] periodMillis - Periodic interval, 0 for one-shot.
+ *  \return False if scheduler is full.
+ */
+bool lqc_timerStart(lqcTimer_t *timer, uint32_t delayMillis, uint32_t periodMillis)
+{
+    if (timer->heapIndx < LQC__schedulerTimerCnt)
+        S__heapRemove(timer->heapIndx);
+    else if (S__scheduler.count == LQC__schedulerTimerCnt)
+        return false;
+
+    timer->dueAt = pMillis() + delayMillis;
+    timer->periodMillis = periodMillis;
+    S__heapInsert(timer);
+    return true;
+}
+
+
+void lqc_timerStop(lqcTimer_t *timer)
+{
+    if (timer->heapIndx < LQC__schedulerTimerCnt)
+        S__heapRemove(timer->heapIndx);
+}
+
+
+bool lqc_timerIsRunning(lqcTimer_t *timer)
+{
+    return timer->heapIndx < LQC__schedulerTimerCnt;
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Fire due timers in deadline order, invoked from lqc_doWork().
+ *
+ *  A timer is removed (periodic re-armed) before its callback, so the callback may stop or restart any timer. Each 
+ *  running timer fires at most once per pass.
+ */
+void LQC_doSchedulerWork()
+{
+    lqcScheduler_t *sched = &S__scheduler;
+    uint32_t now = pMillis();
+
+    for (uint8_t fireCnt = sched->count; fireCnt > 0 && sched->count > 0; fireCnt--)
+    {
+        lqcTimer_t *timer = sched->heap[0];
+        uint32_t fireBy = timer->periodMillis ? now + LQC__scheduler_alignMillis : now + 1;    // periodic: align with this wakeup
+
+        if (!DUE_BEFORE(timer->dueAt, fireBy))
+            break;
+
+        S__heapRemove(0);
+        if (timer->periodMillis)
+        {
+            timer->dueAt += timer->periodMillis;                                // keep cadence
+            if (DUE_BEFORE(timer->dueAt, now + 1))
+                timer->dueAt = now + timer->periodMillis;                       // fell behind (long blocking pass), don't burst
+            S__heapInsert(timer);
+        }
+        timer->timerCB(timer->userData);
+    }
+}
+
+
+/**
+ *	\brief Millis until the earliest timer is due.
+ */
+uint32_t LQC_schedulerNextWakeup()
+{
+    lqcScheduler_t *sched = &S__scheduler;
+
+    if (sched->count == 0)
+        return LQC_WAKEUP_NONE;
+
+    uint32_t dueAt = sched->heap[0]->dueAt;
+    return DUE_BEFORE(dueAt, pMillis()) ? 0 : dueAt - pMillis();
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+static void S__heapInsert(lqcTimer_t *timer)
+{
+    uint8_t indx = S__scheduler.count++;
+
+    S__heapPlace(timer, indx);
+    S__siftUp(indx);
+}
+
+
+/**
+ *	\brief Remove the timer at indx, the last heap entry takes its place and is sifted into position.
+ */
+static void S__heapRemove(uint8_t indx)
+{
+    lqcScheduler_t *sched = &S__scheduler;
+    lqcTimer_t *last = sched->heap[--sched->count];
+
+    sched->heap[indx]->heapIndx = LQC__schedulerTimerCnt;
+    if (indx == sched->count)
+        return;
+
+    S__heapPlace(last, indx);
+    if (indx > 0 && DUE_BEFORE(last->dueAt, sched->heap[(indx - 1) / 2]->dueAt))
+        S__siftUp(indx);
+    else
+        S__siftDown(indx);
+}
+
+
+static void S__siftUp(uint8_t indx)
+{
+    lqcTimer_t **heap = S__scheduler.heap;
+    lqcTimer_t *timer = heap[indx];
+
+    while (indx > 0)
+    {
+        uint8_t parent = (indx - 1) / 2;
+        if (!DUE_BEFORE(timer->dueAt, heap[parent]->dueAt))
+            break;
+        S__heapPlace(heap[parent], indx);
+        indx = parent;
+    }
+    S__heapPlace(timer, indx);
+}
+
+
+static void S__siftDown(uint8_t indx)
+{
+    lqcScheduler_t *sched = &S__scheduler;
+    lqcTimer_t *timer = sched->heap[indx];
+
+    while (true)
+    {
+        uint8_t child = 2 * indx + 1;
+        if (child >= sched->count)
+            break;
+        if (child + 1 < sched->count && DUE_BEFORE(sched->heap[child + 1]->dueAt, sched->heap[child]->dueAt))
+            child++;                                                            // earlier of the two children
+        if (!DUE_BEFORE(sched->heap[child]->dueAt, timer->dueAt))
+            break;
+        S__heapPlace(sched->heap[child], indx);
+        indx = child;
+    }
+    S__heapPlace(timer, indx);
+}
+
+
+static void S__heapPlace(lqcTimer_t *timer, uint8_t indx)
+{
+    S__scheduler.heap[indx] = timer;
+    timer->heapIndx = indx;
+}
+
+#pragma endregion
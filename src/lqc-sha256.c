@@ -0,0 +1,198 @@
+/******************************************************************************
+ *  \file lqc-sha256.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client SHA-256 and HMAC-SHA256
+ *****************************************************************************/
+
+#define SRCFILE "SHA"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include <string.h>
+#include "lqc-sha256.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+
+#pragma region Static Local Declarations
+static void S__transform(uint32_t *state, const uint8_t *block);
+
+static const uint32_t S__roundK[64] = 
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+#pragma endregion
+
+
+/* Public Functions
+------------------------------------------------------------------------------------------------ */
+#pragma region Public Functions
+
+void lqcSha256_init(lqcSha256_t *sha)
+{
+    static const uint32_t initialState[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+    memcpy(sha->state, initialState, sizeof(initialState));
+    sha->totalSz = 0;
+}
+
+
+void lqcSha256_update(lqcSha256_t *sha, const void *data, uint32_t dataSz)
+{
+    const uint8_t *bytes = data;
+    uint8_t blockUsed = sha->totalSz % lqcSha256__blockSz;
+
+    sha->totalSz += dataSz;
+    if (blockUsed > 0)                                                          // fill partial block
+    {
+        uint8_t fill = lqcSha256__blockSz - blockUsed;
+        if (dataSz < fill)
+        {
+            memcpy(sha->block + blockUsed, bytes, dataSz);
+            return;
+        }
+        memcpy(sha->block + blockUsed, bytes, fill);
+        S__transform(sha->state, sha->block);
+        bytes += fill;
+        dataSz -= fill;
+    }
+    for (; dataSz >= lqcSha256__blockSz; dataSz -= lqcSha256__blockSz, bytes += lqcSha256__blockSz)
+        S__transform(sha->state, bytes);                                        // full blocks direct from data
+    memcpy(sha->block, bytes, dataSz);
+}
+
+
+void lqcSha256_final(lqcSha256_t *sha, uint8_t *digest)
+{
+    uint64_t totalBits = sha->totalSz * 8;
+    uint8_t blockUsed = sha->totalSz % lqcSha256__blockSz;
+
+    sha->block[blockUsed++] = 0x80;
+    if (blockUsed > lqcSha256__blockSz - 8)                                     // no room for length, pad out this block
+    {
+        memset(sha->block + blockUsed, 0, lqcSha256__blockSz - blockUsed);
+        S__transform(sha->state, sha->block);
+        blockUsed = 0;
+    }
+    memset(sha->block + blockUsed, 0, lqcSha256__blockSz - 8 - blockUsed);
+    for (uint8_t i = 0; i < 8; i++)
+        sha->block[lqcSha256__blockSz - 1 - i] = (uint8_t)(totalBits >> (8 * i));
+    S__transform(sha->state, sha->block);
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        digest[4 * i] = sha->state[i] >> 24;
+        digest[4 * i + 1] = (sha->state[i] >> 16) & 0xFF;
+        digest[4 * i + 2] = (sha->state[i] >> 8) & 0xFF;
+        digest[4 * i + 3] = sha->state[i] & 0xFF;
+    }
+}
+
+
+void lqcSha256_hmac(const uint8_t *key, uint16_t keySz, const void *data, uint32_t dataSz, uint8_t *mac)
+{
+    lqcSha256_t sha;
+    uint8_t keyBlock[lqcSha256__blockSz] = {0};
+    uint8_t pad[lqcSha256__blockSz];
+
+    if (keySz > lqcSha256__blockSz)                                             // long keys are hashed
+    {
+        lqcSha256_init(&sha);
+        lqcSha256_update(&sha, key, keySz);
+        lqcSha256_final(&sha, keyBlock);
+    }
+    else
+        memcpy(keyBlock, key, keySz);
+
+    for (uint8_t i = 0; i < lqcSha256__blockSz; i++)
+        pad[i] = keyBlock[i] ^ 0x36;
+    lqcSha256_init(&sha);
+    lqcSha256_update(&sha, pad, lqcSha256__blockSz);
+    lqcSha256_update(&sha, data, dataSz);
+    lqcSha256_final(&sha, mac);                                                 // inner hash
+
+    for (uint8_t i = 0; i < lqcSha256__blockSz; i++)
+        pad[i] = keyBlock[i] ^ 0x5c;
+    lqcSha256_init(&sha);
+    lqcSha256_update(&sha, pad, lqcSha256__blockSz);
+    lqcSha256_update(&sha, mac, lqcSha256__digestSz);
+    lqcSha256_final(&sha, mac);
+
+    memset(keyBlock, 0, sizeof(keyBlock));                                      // key material off the stack
+    memset(pad, 0, sizeof(pad));
+}
+
+#pragma endregion
+
+
+/* Static Local Functions
+------------------------------------------------------------------------------------------------ */
+#pragma region Static Local Functions
+
+/**
+ *	\brief Process one 64 byte block, message schedule is computed in a 16 word ring (64 bytes of stack).
+ */
+static void S__transform(uint32_t *state, const uint8_t *block)
+{
+    uint32_t w[16];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        if (i < 16)
+            w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) | ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+        else
+        {
+            uint32_t w15 = w[(i - 15) & 0x0F];
+            uint32_t w2 = w[(i - 2) & 0x0F];
+            w[i & 0x0F] += (ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3)) + w[(i - 7) & 0x0F] + (ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10));
+        }
+
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + S__roundK[i] + w[i & 0x0F];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+#pragma endregion
@@ -0,0 +1,86 @@
+/******************************************************************************
+ *  \file lqc-sha256.h
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ ******************************************************************************
+ * LooUQ LQCloud SHA-256 and HMAC-SHA256 (FIPS 180-4, RFC 2104)
+ *
+ * Used to sign Azure IoT Hub SAS tokens from the device key. Incremental
+ * init/update/final, context is 104 bytes and no tables beyond the 256 byte
+ * round constants (flash).
+ *****************************************************************************/
+#ifndef __LQCLOUD_SHA256_H__
+#define __LQCLOUD_SHA256_H__
+
+#include <stdint.h>
+
+
+enum lqcSha256_constants
+{
+    lqcSha256__digestSz = 32,
+    lqcSha256__blockSz = 64
+};
+
+
+/** 
+ *  \brief SHA-256 computation in progress.
+*/
+typedef struct lqcSha256_tag
+{
+    uint32_t state[8];
+    uint64_t totalSz;                           /// bytes added
+    uint8_t block[lqcSha256__blockSz];          /// partial block awaiting more data
+} lqcSha256_t;
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ *  \brief Start a SHA-256 computation.
+ */
+void lqcSha256_init(lqcSha256_t *sha);
+
+/**
+ *  \brief Add data to a SHA-256 computation, may be invoked any number of times (streamed input).
+ */
+void lqcSha256_update(lqcSha256_t *sha, const void *data, uint32_t dataSz);
+
+/**
+ *  \brief Complete a SHA-256 computation.
+ *  \param [out] digest lqcSha256__digestSz bytes.
+ */
+void lqcSha256_final(lqcSha256_t *sha, uint8_t *digest);
+
+/**
+ *  \brief HMAC-SHA256 of a complete buffer.
+ *  \param [out] mac lqcSha256__digestSz bytes.
+ */
+void lqcSha256_hmac(const uint8_t *key, uint16_t keySz, const void *data, uint32_t dataSz, uint8_t *mac);
+
+
+#ifdef __cplusplus
+}
+#endif // !__cplusplus
+
+#endif  /* !__LQCLOUD_SHA256_H__ */
@@ -57,6 +57,15 @@ extern lqCloudDevice_t g_lqCloud;
  *  \param [in] body - Message body, JSON formatted
  */
 lqcSendResult_t lqc_sendTelemetry(const char *evntName, const char *evntSummary, const char *bodyJson)
+{
+    return lqcInst_sendTelemetry(&g_lqCloud, evntName, evntSummary, bodyJson);
+}
+
+
+/**
+ *	\brief Send telemetry message to LooUQ Cloud from a specific LQCloud instance.
+ */
+lqcSendResult_t lqcInst_sendTelemetry(lqcHandle_t lqc, const char *evntName, const char *evntSummary, const char *bodyJson)
 {
     char msgEvntName[lqc__msg_nameSz] = {0};
     char msgEvntSummary[lqc__msg_summarySz] = {0};
@@ -75,29 +84,32 @@ lqcSendResult_t lqc_sendTelemetry(const char *evntName, const char *evntSummary,
 
     // telemetry options
 
-    LQC_invokeAppEventCBRequest(appEvent_env_getPwr, "");
-    if (g_lqCloud.appEventResponse.requestCode == appEvent_env_getPwr && g_lqCloud.appEventResponse.resultCode == resultCode__success)
+    appEventResponse_t eventRsp;                                            // per request, thread-safe without a shared response slot
+
+    LQC_requestAppEventResponse(lqc, appEvent_env_getPwr, &eventRsp);
+    if (eventRsp.requestCode == appEvent_env_getPwr && eventRsp.resultCode == resultCode__success)
     {
         char optProp[LQC_DEVICESTATUS_PROPSZ];
-        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"pwrmv\": %s,", g_lqCloud.appEventResponse.message);
+        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"pwrmv\": %s,", eventRsp.message);
         strcat(dStatusBuild, optProp);
     }
 
-    LQC_invokeAppEventCBRequest(appEvent_env_getBatt, "");
-    if (g_lqCloud.appEventResponse.requestCode == appEvent_env_getBatt && g_lqCloud.appEventResponse.resultCode == resultCode__success)
+    LQC_requestAppEventResponse(lqc, appEvent_env_getBatt, &eventRsp);
+    if (eventRsp.requestCode == appEvent_env_getBatt && eventRsp.resultCode == resultCode__success)
     {
         char optProp[LQC_DEVICESTATUS_PROPSZ];
-        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"bttmv\":%s,", g_lqCloud.appEventResponse.message);
+        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"bttmv\":%s,", eventRsp.message);
         strcat(dStatusBuild, optProp);
     }
 
-    LQC_invokeAppEventCBRequest(appEvent_env_getMem, "");
-    if (g_lqCloud.appEventResponse.requestCode == appEvent_env_getMem && g_lqCloud.appEventResponse.resultCode == resultCode__success)
+    LQC_requestAppEventResponse(lqc, appEvent_env_getMem, &eventRsp);
+    if (eventRsp.requestCode == appEvent_env_getMem && eventRsp.resultCode == resultCode__success)
     {
         char optProp[LQC_DEVICESTATUS_PROPSZ];
-        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"memb\":%s,", g_lqCloud.appEventResponse.message);
+        snprintf(optProp, LQC_DEVICESTATUS_PROPSZ, "\"memb\":%s,", eventRsp.message);
         strcat(dStatusBuild, optProp);
     }
+
     uint8_t dStatusSz = strlen(dStatusBuild);
     if (dStatusSz > 0) 
     {
@@ -106,9 +118,9 @@ lqcSendResult_t lqc_sendTelemetry(const char *evntName, const char *evntSummary,
     }
 
     // "devices/%s/messages/events/mId=~%d&mV=1.0&evT=tdat&evC=%s&evN=%s"
-    snprintf(msgTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicTelemetry, g_lqCloud.deviceCnfg->deviceId, ++g_lqCloud.lastMsgId, "appl", msgEvntName);
-    snprintf(msgBody, LQMQ_MSG_MAXSZ, "{%s\"telemetry\": %s%s}", msgEvntSummary, bodyJson, deviceStatus);
+    snprintf(msgTopic, LQMQ_TOPIC_PUB_MAXSZ, IotHubTemplate_D2C_topicTelemetry, lqc->deviceCnfg->deviceId, LQC_ATOMIC_INC(lqc->lastMsgId), "appl", msgEvntName);
+    snprintf(msgBody, sizeof(msgBody), "{%s\"telemetry\": %s%s}", msgEvntSummary, bodyJson, deviceStatus);
 
-    return LQC_trySend(msgTopic, msgBody, 0, false);
+    return LQC_trySend(lqc, msgTopic, msgBody, 0, false);
 }
 
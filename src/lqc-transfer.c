@@ -0,0 +1,347 @@
+/******************************************************************************
+ *  \file lqc-transfer.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ * LooUQ LQCloud Client Chunked (large payload) C2D Transfer Services
+ *
+ * The cloud sends a payload larger than the transport receive buffer as a
+ * series of fragments. Each fragment carries properties:
+ *   xId  : transfer ID
+ *   xSeq : fragment sequence, 0 based
+ *   xLen : total payload length (bytes)
+ *   xCrc : CRC-32 of complete payload (hex)
+ *   xWin : fragments sent between device acks (optional)
+ *   evN  : transfer name, passed to application sink
+ *
+ * The device acks (evT=xAck) cumulatively with the next sequence expected,
+ * the cloud resumes sending at xSeq of the last ack.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "XFR"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+#include "lqc-crc.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+#define MIN(x, y) (((x)<(y)) ? (x):(y))
+#define XFER_PROPVALUE_SZ 12
+
+
+#pragma region Static Local Declarations
+static lqcTransfer_t S__transfer;                                      // chunked C2D transfer reassembly
+static bool S__beginTransfer(lqcTransfer_t *xfer, const char *xferId, const char *props);
+static void S__acceptChunk(lqcTransfer_t *xfer, const uint8_t *chunk, uint16_t chunkSz);
+static void S__endTransfer(lqcTransfer_t *xfer, uint16_t resultCode);
+static void S__scheduleAck(lqcTransfer_t *xfer, uint16_t resultCode);
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Enable chunked C2D transfers.
+ *
+ *	\param [in] transferSinkCB - Application function to receive transfer events (and data if streaming).
+ *  \param [in] arena - Optional reassembly buffer, NULL to stream fragments to the sink.
+ *  \param [in] arenaSz - Size of arena.
+ */
+void lqc_registerTransferSink(lqcTransferSink_func transferSinkCB, uint8_t *arena, uint32_t arenaSz)
+{
+    S__transfer.sinkCB = transferSinkCB;
+    S__transfer.arena = arena;
+    S__transfer.arenaSz = (arena == NULL) ? 0 : arenaSz;
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Test for and consume a chunked transfer fragment. Invoked in the transport's receive callback, or in worker mode 
+ *  from lqc_doWork() as the worker queues fragments with action requests: the sink is always invoked on the application thread.
+ *
+ *	\param [in] message - Fragment content.
+ *  \param [in] messageSz - Size of the fragment.
+ *	\param [in] props - Message properties (topic postamble as HTTP query string).
+ *  \return True if message was a transfer fragment (consumed), false for other messages.
+ */
+bool LQC_receiveTransferChunk(const char *message, uint16_t messageSz, const char *props)
+{
+    lqcTransfer_t *xfer = &S__transfer;
+    char xferId[SET_PROPLEN(LQC__transfer_idSz)];
+    char propValue[XFER_PROPVALUE_SZ];
+
+    if (LQC_peekPropValue(props, "xId", xferId, sizeof(xferId)) == 0)
+        return false;
+
+    char keyProp[SET_PROPLEN(lqc__identity_deviceKeySz)];
+    LQC_peekPropValue(props, "aKey", keyProp, sizeof(keyProp));
+    if (strlen(g_lqCloud.deviceKey) > 0 && strcmp(keyProp, g_lqCloud.deviceKey) != 0)
+    {
+        PRINTF(dbgColor__warn, "Xfer %s: invalid key, ignored\r", xferId);
+        return true;
+    }
+
+    LQC_peekPropValue(props, "xSeq", propValue, sizeof(propValue));
+    uint16_t seq = strtoul(propValue, NULL, 10);
+
+    if (strcmp(xferId, xfer->completedId) == 0 && seq < xfer->completedSeqCnt)  // redelivery from completed transfer, cloud missed final ack
+    {
+        PRINTF(dbgColor__dMagenta, "Xfer %s: completed, dup seq=%d\r", xferId, seq);
+        if (!xfer->active)                                                      // if a newer transfer is active, cloud has moved on
+        {
+            strcpy(xfer->xferId, xfer->completedId);
+            xfer->nextSeq = xfer->completedSeqCnt;
+            S__scheduleAck(xfer, resultCode__success);
+        }
+        return true;
+    }
+
+    if (!xfer->active || strcmp(xferId, xfer->xferId) != 0)
+    {
+        if (xfer->active)                                                       // superseded by new transfer, cloud abandoned it: no ack
+        {
+            xfer->active = false;
+            xfer->sinkCB(lqcTransferEvent_abort, xfer->name, xfer->offset, NULL, 0);
+        }
+
+        if (seq != 0)                                                           // unknown (expired) transfer, cloud restarts it
+        {
+            memset(xfer->xferId, 0, sizeof(xfer->xferId));
+            strncpy(xfer->xferId, xferId, LQC__transfer_idSz);
+            xfer->nextSeq = 0;
+            S__scheduleAck(xfer, resultCode__gone);
+            return true;
+        }
+        if (!S__beginTransfer(xfer, xferId, props))
+        {
+            S__scheduleAck(xfer, xfer->ackResult);                              // refused
+            return true;
+        }
+    }
+
+    if (seq == xfer->nextSeq)
+        S__acceptChunk(xfer, (const uint8_t *)message, messageSz);
+    else if (seq < xfer->nextSeq)
+    {
+        PRINTF(dbgColor__dMagenta, "Xfer %s: dup seq=%d\r", xferId, seq);
+        S__scheduleAck(xfer, resultCode__success);                              // redelivery, cloud missed ack
+    }
+    else
+    {
+        PRINTF(dbgColor__warn, "Xfer %s: gap seq=%d, expected=%d\r", xferId, seq, xfer->nextSeq);
+        S__scheduleAck(xfer, resultCode__success);                              // cloud resends from nextSeq
+    }
+    return true;
+}
+
+
+/**
+ *	\brief Message properties carry a transfer ID, the message is a chunked transfer fragment.
+ */
+bool LQC_isTransferChunk(const char *props)
+{
+    char xferId[SET_PROPLEN(LQC__transfer_idSz)];
+    return LQC_peekPropValue(props, "xId", xferId, sizeof(xferId)) > 0;
+}
+
+
+/**
+ *	\brief Send pending transfer ack and expire a stalled transfer, invoked from lqc_doWork() on the application thread.
+ */
+void LQC_doTransferWork()
+{
+    lqcTransfer_t *xfer = &S__transfer;
+
+    if (xfer->active && wrkTime_isElapsed(xfer->lastRecvAt, PERIOD_FROM_SECONDS(LQC__transfer_timeoutSecs)))
+    {
+        PRINTF(dbgColor__warn, "Xfer %s: timeout at seq=%d\r", xfer->xferId, xfer->nextSeq);
+        S__endTransfer(xfer, resultCode__timeout);
+    }
+
+    if (xfer->ackPending)
+    {
+        char topic[LQMQ_TOPIC_PUB_MAXSZ];
+
+        // "devices/%s/messages/events/mId=~%d&mV=1.0&evT=xAck&xId=%s&xSeq=%d&xRslt=%d"
+        snprintf(topic, sizeof(topic), IotHubTemplate_D2C_topicTransferAck, g_lqCloud.deviceCnfg->deviceId, LQC_ATOMIC_INC(g_lqCloud.lastMsgId), xfer->xferId, xfer->nextSeq, xfer->ackResult);
+        if (LQC_trySend(&g_lqCloud, topic, "{}", false, LQC__publishDefaultTimeoutS) != lqcSendResult_dropped)
+            xfer->ackPending = false;                                           // sent or queued (send queue, batch, ring); retry next pass if dropped
+    }
+}
+
+/**
+ *	\brief Transfer in progress or its ack not yet sent, the connection manager keeps an on-demand window open.
+ */
+bool LQC_transferPending()
+{
+    return S__transfer.active || S__transfer.ackPending;
+}
+
+
+/**
+ *	\brief Millis until a pending ack can be sent or an active transfer stalls.
+ */
+uint32_t LQC_transferNextWakeup()
+{
+    lqcTransfer_t *xfer = &S__transfer;
+
+    if (xfer->ackPending && g_lqCloud.isOnline)
+        return 0;
+    if (!xfer->active)
+        return LQC_WAKEUP_NONE;
+    return LQC_millisUntil(xfer->lastRecvAt, PERIOD_FROM_SECONDS(LQC__transfer_timeoutSecs));
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+/**
+ *	\brief Start a new transfer from the first fragment's properties.
+ *  \return True if transfer started; false if refused, xfer->ackResult is set to reason.
+ */
+static bool S__beginTransfer(lqcTransfer_t *xfer, const char *xferId, const char *props)
+{
+    char propValue[XFER_PROPVALUE_SZ];
+
+    memset(xfer->xferId, 0, sizeof(xfer->xferId));
+    strncpy(xfer->xferId, xferId, LQC__transfer_idSz);
+    LQC_peekPropValue(props, "evN", xfer->name, sizeof(xfer->name));
+
+    LQC_peekPropValue(props, "xLen", propValue, sizeof(propValue));
+    xfer->totalLen = strtoul(propValue, NULL, 10);
+    LQC_peekPropValue(props, "xCrc", propValue, sizeof(propValue));
+    xfer->expectedCrc = strtoul(propValue, NULL, 16);
+    LQC_peekPropValue(props, "xWin", propValue, sizeof(propValue));
+    xfer->window = strtoul(propValue, NULL, 10);
+    if (xfer->window == 0)
+        xfer->window = LQC__transfer_windowDefault;
+
+    xfer->offset = 0;
+    xfer->nextSeq = 0;
+    xfer->sinceAck = 0;
+    xfer->crc = lqcCrc_init();
+    xfer->lastRecvAt = pMillis();
+    xfer->ackResult = resultCode__success;
+
+    if (xfer->sinkCB == NULL)
+        xfer->ackResult = resultCode__unavailable;                              // transfers not enabled by application
+    else if (xfer->totalLen == 0 || (xfer->arena != NULL && xfer->totalLen > xfer->arenaSz))
+        xfer->ackResult = resultCode__badRequest;
+    else if (!xfer->sinkCB(lqcTransferEvent_begin, xfer->name, 0, NULL, MIN(xfer->totalLen, UINT16_MAX)))
+        xfer->ackResult = resultCode__forbidden;                                // application refused
+
+    if (xfer->ackResult != resultCode__success)
+    {
+        PRINTF(dbgColor__warn, "Xfer %s: refused, rslt=%d\r", xferId, xfer->ackResult);
+        return false;
+    }
+
+    PRINTF(dbgColor__info, "Xfer %s: begin %s, len=%d win=%d\r", xferId, xfer->name, xfer->totalLen, xfer->window);
+    xfer->active = true;
+    return true;
+}
+
+
+/**
+ *	\brief Accept the next in-order fragment: CRC, deliver to arena/sink, ack at window end or completion.
+ */
+static void S__acceptChunk(lqcTransfer_t *xfer, const uint8_t *chunk, uint16_t chunkSz)
+{
+    if (xfer->offset + chunkSz > xfer->totalLen)
+    {
+        S__endTransfer(xfer, resultCode__badRequest);
+        return;
+    }
+
+    xfer->crc = lqcCrc_update(xfer->crc, chunk, chunkSz);
+    if (xfer->arena != NULL)
+        memcpy(xfer->arena + xfer->offset, chunk, chunkSz);
+    else if (!xfer->sinkCB(lqcTransferEvent_data, xfer->name, xfer->offset, chunk, chunkSz))
+    {
+        S__endTransfer(xfer, resultCode__internalError);
+        return;
+    }
+
+    xfer->offset += chunkSz;
+    xfer->nextSeq++;
+    xfer->lastRecvAt = pMillis();
+
+    if (xfer->offset == xfer->totalLen)
+    {
+        if (lqcCrc_final(xfer->crc) != xfer->expectedCrc)
+        {
+            PRINTF(dbgColor__warn, "Xfer %s: CRC mismatch\r", xfer->xferId);
+            xfer->nextSeq = 0;                                                  // cloud restarts transfer
+            S__endTransfer(xfer, resultCode__conflict);
+            return;
+        }
+        PRINTF(dbgColor__info, "Xfer %s: complete, len=%d\r", xfer->xferId, xfer->totalLen);
+        xfer->active = false;
+        strcpy(xfer->completedId, xfer->xferId);
+        xfer->completedSeqCnt = xfer->nextSeq;
+        xfer->sinkCB(lqcTransferEvent_complete, xfer->name, 0, xfer->arena, (xfer->arena != NULL) ? xfer->totalLen : 0);
+        S__scheduleAck(xfer, resultCode__success);
+    }
+    else if (++xfer->sinceAck >= xfer->window)
+        S__scheduleAck(xfer, resultCode__success);
+}
+
+
+/**
+ *	\brief Abort the active transfer, notify application sink and cloud.
+ */
+static void S__endTransfer(lqcTransfer_t *xfer, uint16_t resultCode)
+{
+    xfer->active = false;
+    xfer->sinkCB(lqcTransferEvent_abort, xfer->name, xfer->offset, NULL, 0);
+    S__scheduleAck(xfer, resultCode);
+}
+
+
+static void S__scheduleAck(lqcTransfer_t *xfer, uint16_t resultCode)
+{
+    xfer->ackResult = resultCode;
+    xfer->ackPending = true;
+    xfer->sinceAck = 0;
+}
+
+#pragma endregion
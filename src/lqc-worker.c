@@ -0,0 +1,272 @@
+/******************************************************************************
+ *  \file lqc-worker.c
+ *  \author Greg Terrell
+ *  \license MIT License
+ *
+ *  Copyright (c) 2020-2022 LooUQ Incorporated.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software. THE SOFTWARE IS PROVIDED
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ ******************************************************************************
+ ******************************************************************************
+ * LooUQ LQCloud Client Network Worker Mode
+ *
+ * On Linux and RTOS hosts lqc_start() spawns a network worker (platform 
+ * thread hook) that owns the transport, connection manager and send ring. 
+ * Application threads enqueue sends (lock-free send ring) and lqc_doWork() on 
+ * the application thread performs actions and delivers the event notifications 
+ * the worker raised (completion queue), neither waits on the network.
+ *****************************************************************************/
+
+#define _DEBUG 2                        // set to non-zero value for PRINTF debugging output,
+// debugging output options             // LTEm1c will satisfy PRINTF references with empty definition if not already resolved
+#if defined(_DEBUG)
+    asm(".global _printf_float");       // forces build to link in float support for printf
+    #if _DEBUG == 2
+    #include <jlinkRtt.h>               // output debug PRINTF macros to J-Link RTT channel
+    #define PRINTF(c_,f_,__VA_ARGS__...) do { rtt_printf(c_, (f_), ## __VA_ARGS__); } while(0)
+    #else
+    #define SERIAL_DBG _DEBUG           // enable serial port output using devl host platform serial, _DEBUG 0=start immediately, 1=wait for port
+    #endif
+#else
+#define PRINTF(c_, f_, ...) ;
+#endif
+
+#define SRCFILE "WRK"                           // create SRCFILE (3 char) MACRO for lq-diagnostics ASSERT
+#include "lqc-internal.h"
+#include "lqc-azure.h"
+
+extern lqCloudDevice_t g_lqCloud;
+
+
+#pragma region Static Local Declarations
+static lqcWorker_t S__worker;
+static void S__networkWorker(void *arg);
+#pragma endregion
+
+
+#pragma region Public Functions
+
+/**
+ *	\brief Enable worker mode, the network worker is started by lqc_start().
+ *
+ *	\param [in] platformHooks - Host thread, mutex and sleep functions (application static, not copied).
+ *  \param [in] sendSlots - Application slot array for the send ring.
+ *  \param [in] slotCnt - Number of slots, power of 2.
+ *  \return False if parameters invalid, mutex not created or not built with LQC_THREADSAFE.
+ */
+bool lqc_enableWorkerThread(lqcPlatformHooks_t *platformHooks, lqcSendSlot_t *sendSlots, uint16_t slotCnt)
+{
+    #ifdef LQC_THREADSAFE
+    lqcWorker_t *worker = &S__worker;
+
+    if (platformHooks == NULL || platformHooks->createThread == NULL || platformHooks->currentThread == NULL || platformHooks->sleepMillis == NULL || worker->running)
+        return false;
+    if (!lqc_enableThreadSafeSend(sendSlots, slotCnt))
+        return false;
+
+    worker->mutex = (platformHooks->createMutex != NULL) ? platformHooks->createMutex() : NULL;
+    if (worker->mutex == NULL)
+        return false;
+
+    worker->completionHead = 0;
+    worker->completionTail = 0;
+    worker->completionCnt = 0;
+    worker->completionDroppedCnt = 0;
+    worker->connectRequested = false;
+    worker->thread = NULL;
+    worker->hooks = platformHooks;
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+
+/**
+ *	\brief Signal the network worker to exit, it completes the current pass first.
+ */
+void lqc_stopWorkerThread()
+{
+    LQC_ATOMIC_STORE(S__worker.running, false);
+}
+
+#pragma endregion
+
+
+#pragma region LQ Cloud Internal Functions LQC_
+
+/**
+ *	\brief Start the network worker if worker mode is enabled, invoked from lqc_start().
+ */
+void LQC_startWorker()
+{
+    #ifdef LQC_THREADSAFE
+    lqcWorker_t *worker = &S__worker;
+
+    if (worker->hooks == NULL || worker->running)
+        return;
+
+    LQC_ATOMIC_STORE(worker->running, true);
+    if (!worker->hooks->createThread(S__networkWorker, NULL))
+    {
+        LQC_ATOMIC_STORE(worker->running, false);                           // lqc_doWork() continues to perform network work
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_warn, "Worker not started");
+    }
+    #endif
+}
+
+
+bool LQC_workerRunning()
+{
+    #ifdef LQC_THREADSAFE
+    return __atomic_load_n(&S__worker.running, __ATOMIC_ACQUIRE);
+    #else
+    return false;
+    #endif
+}
+
+
+/**
+ *	\brief On-demand connect requested by an application thread, performed by the worker on its next pass.
+ */
+void LQC_workerRequestConnect()
+{
+    LQC_ATOMIC_STORE(S__worker.connectRequested, true);
+}
+
+
+bool LQC_workerCompletionsPending()
+{
+    return S__worker.completionCnt > 0;
+}
+
+
+/**
+ *	\brief Caller is the network worker, compared by thread/task handle (no thread-local storage on RTOS/newlib targets).
+ */
+bool LQC_onWorkerThread()
+{
+    #ifdef LQC_THREADSAFE
+    void *workerThread = __atomic_load_n(&S__worker.thread, __ATOMIC_ACQUIRE);
+    return workerThread != NULL && workerThread == S__worker.hooks->currentThread();
+    #else
+    return false;
+    #endif
+}
+
+
+/**
+ *	\brief Hold an event notification raised on the network worker for delivery on the application thread.
+ */
+void LQC_postCompletion(lqCloudDevice_t *lqc, const char *eventTag, const char *eventMsg)
+{
+    lqcWorker_t *worker = &S__worker;
+
+    LQC_LOCK();
+    if (worker->completionCnt == LQC__worker_completionCnt)
+        worker->completionDroppedCnt++;
+    else
+    {
+        lqcCompletion_t *completion = &worker->completions[worker->completionHead];
+        completion->lqc = lqc;
+        completion->eventTag = eventTag;
+        strncpy(completion->eventMsg, eventMsg, LQC__worker_eventMsgSz - 1);
+        completion->eventMsg[LQC__worker_eventMsgSz - 1] = '\0';
+
+        worker->completionHead = (worker->completionHead + 1) % LQC__worker_completionCnt;
+        worker->completionCnt++;
+    }
+    LQC_UNLOCK();
+    LQC_signalWakeup();
+}
+
+
+/**
+ *	\brief Deliver notifications raised on the network worker, invoked from lqc_doWork() on the application thread.
+ */
+void LQC_deliverCompletions()
+{
+    lqcWorker_t *worker = &S__worker;
+    lqcCompletion_t completion;
+    uint16_t droppedCnt = 0;
+
+    while (worker->completionCnt > 0)
+    {
+        LQC_LOCK();
+        memcpy(&completion, &worker->completions[worker->completionTail], sizeof(lqcCompletion_t));
+        worker->completionTail = (worker->completionTail + 1) % LQC__worker_completionCnt;
+        worker->completionCnt--;
+        droppedCnt += worker->completionDroppedCnt;
+        worker->completionDroppedCnt = 0;
+        LQC_UNLOCK();
+
+        LQC_invokeAppEventCBRequest(completion.lqc, completion.eventTag, completion.eventMsg);     // outside lock, app may call back into LQCloud
+    }
+
+    if (droppedCnt > 0)
+    {
+        char dropMsg[LQC__worker_eventMsgSz];
+        snprintf(dropMsg, sizeof(dropMsg), "Notifications dropped:%d", droppedCnt);
+        LQC_invokeAppEventCBRequest(&g_lqCloud, appEvent_warn, dropMsg);
+    }
+}
+
+
+void LQC_workerLock()
+{
+    if (S__worker.mutex != NULL)
+        S__worker.hooks->lockMutex(S__worker.mutex);
+}
+
+
+void LQC_workerUnlock()
+{
+    if (S__worker.mutex != NULL)
+        S__worker.hooks->unlockMutex(S__worker.mutex);
+}
+
+#pragma endregion
+
+
+#pragma region Static Local Functions
+
+/**
+ *	\brief Network worker thread: transport, connection manager and send ring serviced here until lqc_stopWorkerThread().
+ */
+static void S__networkWorker(void *arg)
+{
+    (void)arg;
+    #ifdef LQC_THREADSAFE
+    lqcWorker_t *worker = &S__worker;
+
+    __atomic_store_n(&worker->thread, worker->hooks->currentThread(), __ATOMIC_RELEASE);
+    PRINTF(dbgColor__info, "NtwkWorker started\r");
+
+    while (__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE))
+    {
+        if (__atomic_exchange_n(&worker->connectRequested, false, __ATOMIC_ACQ_REL))
+            LQC_requestConnect();                                           // on-demand connect requested by an application thread
+        LQC_doNetworkWork();
+        worker->hooks->sleepMillis(LQC__worker_passIntervalMillis);
+    }
+    __atomic_store_n(&worker->thread, NULL, __ATOMIC_RELEASE);
+    PRINTF(dbgColor__info, "NtwkWorker exited\r");
+    #endif
+}
+
+#pragma endregion